@@ -11,6 +11,8 @@
 // 全局变量：当前扫描位置（行号、列号）
 // ===========================================================
 int line = 1, col = 0; // 初始位置：第1行，第0列
+int last_col = 0;      // 上一行的最后一列，回退换行符时恢复
+int tok_line = 1, tok_col = 0; // 当前单词首字符的位置，随单词一起输出
 FILE *fin, *fout;
 
 // ===========================================================
@@ -30,6 +32,7 @@ int getc_track(FILE *fp) {
 
     if (c == '\n') {   // 遇到换行：行+1，列归零
         line++;
+        last_col = col;
         col = 0;
     } else {
         col++;         // 普通字符：列+1
@@ -48,7 +51,7 @@ void ungetc_track(int c, FILE *fp) {
 
     if (c == '\n') {
         line--;   // 回到上一行
-        col = 0;
+        col = last_col;
     } else col--; // 回到前一列
 }
 
@@ -99,13 +102,14 @@ int is_keyword(const char *s) {
 // ===========================================================
 // 输出格式化（输出到结果文件）
 // 所有 token 都按对齐格式输出
+// 行尾的 (行,列) 是单词首字符的位置，列从1起
 // ===========================================================
-void out_keyword(const char *s) { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", s, s, line, col); }
-void out_op(const char *s)      { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", s, s, line, col); }
-void out_id(const char *s)      { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", "ID", s, line, col); }
-void out_num(const char *s)     { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", "NUM", s, line, col); }
-void out_char(const char *s)    { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", s, s, line, col); }
-void out_error_file(const char *s) { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", "ERROR", s, line, col); }
+void out_keyword(const char *s) { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", s, s, tok_line, tok_col); }
+void out_op(const char *s)      { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", s, s, tok_line, tok_col); }
+void out_id(const char *s)      { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", "ID", s, tok_line, tok_col); }
+void out_num(const char *s)     { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", "NUM", s, tok_line, tok_col); }
+void out_char(const char *s)    { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", s, s, tok_line, tok_col); }
+void out_error_file(const char *s) { fprintf(fout,"%-8s %-15s (%3d,%-3d)\n", "ERROR", s, tok_line, tok_col); }
 
 // ===========================================================
 // 判断是否为操作符起始字符
@@ -147,6 +151,8 @@ void lexer() {
         // 获取下一个有效字符
         c = getc_track(fin);
         if (c == EOF) break;
+        tok_line = line;
+        tok_col = col;
 
         if (isspace(c)) continue; // 冗余保护
 
@@ -0,0 +1,498 @@
+// ===========================================================
+// cj：编译器驱动程序
+// 词法分析和语法语义分析在同一进程内完成，文件名和要输出的产物都由
+// 命令行给出，不再交互输入。虚拟机仍是单独的程序，装载这里输出的 .cjm 模块。
+//
+// 用法: cj [选项] <源程序>
+//       cj --server <套接字>                   常驻编译服务，见"编译服务"
+//       cj --connect <套接字> [选项] <源程序>  交给编译服务编译，选项与直接编译相同
+//       cj --connect <套接字> --server-stats|--shutdown
+//   源程序为 - 时从标准输入读入，这时必须用 -o 给出产物前缀
+//   -o <前缀>          产物文件名前缀，默认与源程序同名
+//   --emit=<列表>      要输出的产物，逗号分隔：tokens,ast,symbols,codes,module，
+//                      all 表示全部。默认只输出 module。不要的产物不会构造
+//   -v                 输出分析过程跟踪（读入的单词、生成的代码、符号表）
+//   --no-cache         不使用编译缓存
+//   --stats=<文件>     各阶段用时、计数和内存峰值写成JSON
+//   --profile-use=<文件>  按虚拟机 --profile 写出的剖析文件（*.cjprof）优化：
+//                      热路径顺序执行，按实际迭代次数选展开因子，
+//                      按调用次数调整内联预算
+//
+// 产物: <前缀>.tok  <前缀>.ast.txt  <前缀>.symbols.txt  <前缀>.codes.txt  <前缀>.cjm
+//
+// 构建: g++ -o cj cj.cpp      （cifafenxi.cpp 和 yuyifenxi.cpp 须在同一目录）
+// ===========================================================
+
+#define main lexer_main
+#include "cifafenxi.cpp"
+#undef main
+
+#define main compiler_main
+#include "yuyifenxi.cpp"
+#undef main
+
+// 解析 --emit= 后面的列表，返回产物位集合，有不认识的名字返回 -1
+int parse_emit(const char *list) {
+    static const struct { const char *name; int bit; } kinds[] = {
+        { "tokens", EMIT_TOKENS }, { "ast", EMIT_AST }, { "symbols", EMIT_SYMBOLS },
+        { "codes", EMIT_CODES }, { "module", EMIT_MODULE }, { "all", EMIT_TOKENS | EMIT_ALL }
+    };
+    int mask = 0;
+    while (*list) {
+        int len = strcspn(list, ",");
+        int i, n = sizeof(kinds) / sizeof(kinds[0]);
+        for (i = 0; i < n; i++) {
+            if ((int)strlen(kinds[i].name) == len && strncmp(list, kinds[i].name, len) == 0) break;
+        }
+        if (i == n) {
+            printf("未知的产物 %.*s，可选: tokens,ast,symbols,codes,module,all\n", len, list);
+            return -1;
+        }
+        mask |= kinds[i].bit;
+        list += len;
+        if (*list == ',') list++;
+    }
+    return mask;
+}
+
+// 词法分析：源程序 → 单词流。单词流不输出时写到临时文件，编译完即删除
+FILE *lex_source(FILE *src) {
+    FILE *tok;
+    if (emit_mask & EMIT_TOKENS) {
+        char tokfile[512];
+        snprintf(tokfile, sizeof(tokfile), "%s.tok", outbase);
+        tok = fopen(tokfile, "w+");
+        if (tok) printf("单词流已输出到 %s\n", tokfile);
+    } else {
+        tok = tmpfile();
+    }
+    if (!tok) {
+        printf("创建单词流文件失败！\n");
+        return NULL;
+    }
+
+    fin = src;
+    fout = tok;
+    line = 1;
+    col = 0;
+    lexer();
+    rewind(tok);
+    return tok;
+}
+
+// 源程序从标准输入读入时先存进临时文件，缓存计算键后还要从头再读一遍
+FILE *read_stdin_source() {
+    char buf[4096];
+    size_t n;
+    FILE *src = tmpfile();
+    if (!src) return NULL;
+    while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0) {
+        if (fwrite(buf, 1, n, src) != n) {
+            fclose(src);
+            return NULL;
+        }
+    }
+    rewind(src);
+    return src;
+}
+
+// 按命令行选项编译一个源程序，返回退出码。编译服务的每个请求也走这里
+int cj_compile(int argc, char *argv[]) {
+    const char *source = NULL, *output = NULL;
+    int use_cache = 1;
+
+    emit_mask = EMIT_MODULE;
+    trace_enabled = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--emit=", 7) == 0) {
+            emit_mask = parse_emit(argv[i] + 7);
+            if (emit_mask < 0) return 1;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            trace_enabled = 1;
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+            if (stats_open(argv[i] + 8)) return 1;
+        } else if (strncmp(argv[i], "--profile-use=", 14) == 0) {
+            if (pgo_load(argv[i] + 14)) return 1;
+        } else if ((argv[i][0] != '-' || strcmp(argv[i], "-") == 0) && !source) {
+            source = argv[i];
+        } else {
+            printf("未知选项 %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!source) {
+        printf("用法: %s [-o 前缀] [--emit=tokens,ast,symbols,codes,module|all] [-v] [--no-cache] [--stats=文件]\n"
+               "          [--profile-use=剖析文件] 源程序\n",
+               argv[0]);
+        return 1;
+    }
+
+    int from_stdin = strcmp(source, "-") == 0;
+    if (from_stdin && !output) {
+        printf("从标准输入读源程序时要用 -o 给出产物前缀\n");
+        return 1;
+    }
+    snprintf(tokenfile, sizeof(tokenfile), "%s", from_stdin ? "(标准输入)" : source);
+    snprintf(outbase, sizeof(outbase), "%s", output ? output : source);
+    FILE *src = from_stdin ? read_stdin_source() : fopen(source, "r");
+    if (!src) {
+        printf("打开输入文件失败！\n");
+        return 1;
+    }
+
+    // 源程序没变时连词法分析也跳过
+    stats_reset();
+    cache_init(use_cache);
+    PHASE_BEGIN(PHASE_CACHE);
+    int hit = cache_enabled && cache_make_key(src) == 0 && cache_restore();
+    PHASE_END(PHASE_CACHE);
+    if (hit) {
+        fclose(src);
+        stats_finish(1, 0);
+        return 0;
+    }
+
+    PHASE_BEGIN(PHASE_LEX);
+    fpTokenin = lex_source(src);
+    fclose(src);
+    PHASE_END(PHASE_LEX);
+    if (!fpTokenin) return 2;
+    int es = compile_tokens();
+    stats_finish(0, es);
+    return es;
+}
+
+// ===================== 编译服务 =====================
+// 常驻进程在Unix域套接字上接受编译请求，省去每次编译的进程启动和缓存目录
+// 的初始化。每个连接一条请求，以空行结束：
+//   COMPILE\n<客户端工作目录>\n<参数>\n...\n\n[源程序字节]
+//   STATS\n\n
+//   SHUTDOWN\n\n
+// COMPILE的参数就是直接运行cj时的命令行参数，每行一个。源程序为 - 时，空行
+// 之后直到客户端关闭写方向的字节就是源程序。
+//
+// 并发：编译器的全局状态只有一份，服务进程自己从不编译，每个COMPILE请求
+// fork一个子进程：子进程切换到客户端的工作目录（相对路径和直接运行时一样
+// 解释），标准输出接到连接上，用cj_compile按请求的选项编译，全局状态是它
+// 自己的写时复制副本，请求之间互不影响，编译器出错崩溃也只结束这一个请求。
+// 同时编译的请求最多SERVER_MAX_JOBS个，满了就等最早结束的一个。多个子进程
+// 共用编译缓存目录，缓存条目先写临时文件再rename、统计文件加锁读改写，
+// 并发访问是安全的。请求头由服务进程读，连接设了收发超时，连上不发请求的
+// 客户端最多占住服务SERVER_TIMEOUT_MS；源程序字节由子进程读。
+// 客户端收到的是直接运行cj时的全部诊断输出，最后一行是以 @@ 开头的结果行：
+// 状态、编译用时和二进制模块路径。
+
+#ifdef HAVE_COMPILE_CACHE
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <limits.h>
+
+#define SERVER_REQUEST_MAX 4096     // 请求头（到空行为止）的最大字节数
+#define SERVER_MAX_ARGS 32
+#define SERVER_MAX_JOBS 8
+#define SERVER_TIMEOUT_MS 5000
+
+double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int unix_socket_addr(struct sockaddr_un *addr, const char *path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        printf("套接字路径过长: %s\n", path);
+        return 1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+// 连接的收发超时，超时后read/write失败返回
+void set_socket_timeout(int fd, int ms) {
+    struct timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = ms % 1000 * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// 读请求头到空行为止，空行换成'\0'，返回请求头长度。按块读可能多读进
+// 源程序的开头，读到的总字节数放在*got。超时、断开或超长时返回-1
+int read_request(int fd, char *buf, int size, int *got) {
+    int n = 0;
+    while (n < size - 1) {
+        ssize_t r = read(fd, buf + n, size - 1 - n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        n += r;
+        buf[n] = '\0';
+        char *end = strstr(buf, "\n\n");
+        if (end) {
+            *end = '\0';
+            *got = n;
+            return end - buf;
+        }
+    }
+    buf[n] = '\0';
+    return -1;
+}
+
+// 请求头按行拆开，第一行是请求名，返回行数
+int split_request(char *req, char *lines[], int max) {
+    int n = 0;
+    char *p = req;
+    while (n < max) {
+        lines[n++] = p;
+        p = strchr(p, '\n');
+        if (!p) break;
+        *p++ = '\0';
+    }
+    return n;
+}
+
+// 子进程：按请求编译，结果写到连接上。rest是请求头之后已读进来的字节
+void serve_compile(int c, char *lines[], int nlines, const char *rest, int rest_len) {
+    char *argv[SERVER_MAX_ARGS + 2];
+    int argc = 0;
+    argv[argc++] = (char *)"cj";
+    for (int i = 2; i < nlines; i++) argv[argc++] = lines[i];
+    argv[argc] = NULL;
+
+    if (nlines < 2 || chdir(lines[1]) != 0) {
+        dprintf(c, "@@status=1 无法进入工作目录 %s\n", nlines < 2 ? "" : lines[1]);
+        _exit(1);
+    }
+    // 源程序字节：已读进来的部分加上连接上剩下的，接到标准输入
+    FILE *in = tmpfile();
+    if (!in || fwrite(rest, 1, rest_len, in) != (size_t)rest_len) _exit(1);
+    char buf[4096];
+    ssize_t r;
+    while ((r = read(c, buf, sizeof(buf))) > 0) {
+        if (fwrite(buf, 1, r, in) != (size_t)r) _exit(1);
+    }
+    fflush(in);
+    lseek(fileno(in), 0, SEEK_SET);
+    dup2(fileno(in), 0);
+    dup2(c, 1);
+
+    double start = now_us();
+    int status = cj_compile(argc, argv);
+    printf("\n@@status=%d latency_us=%.0f module=%s.cjm\n", status, now_us() - start, outbase);
+    fflush(stdout);
+    exit(status);      // 要冲洗统计文件等还开着的输出
+}
+
+typedef struct {
+    pid_t pid;
+    double start;
+} ServerJob;
+
+ServerJob server_jobs[SERVER_MAX_JOBS];
+int server_running = 0;
+long server_requests = 0;
+double server_total_us = 0, server_max_us = 0;
+
+// 收回结束的子进程，记下用时。block为1时至少等到一个
+void reap_jobs(int block) {
+    int wstatus;
+    pid_t pid;
+    while (server_running > 0 && (pid = waitpid(-1, &wstatus, block ? 0 : WNOHANG)) > 0) {
+        block = 0;
+        for (int i = 0; i < server_running; i++) {
+            if (server_jobs[i].pid != pid) continue;
+            double us = now_us() - server_jobs[i].start;
+            server_requests++;
+            server_total_us += us;
+            if (us > server_max_us) server_max_us = us;
+            printf("请求 %ld: 进程 %d 状态 %d 用时 %.3f ms\n", server_requests, (int)pid,
+                   WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1, us / 1000);
+            server_jobs[i] = server_jobs[--server_running];
+            break;
+        }
+    }
+    fflush(stdout);
+}
+
+// 子进程结束时打断accept，及时收回并记下用时
+void on_child_exit(int sig) {}
+
+int run_server(const char *sock_path) {
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    char req[SERVER_REQUEST_MAX];
+    char *lines[SERVER_MAX_ARGS + 2];
+
+    if (unix_socket_addr(&addr, sock_path)) return 1;
+    signal(SIGPIPE, SIG_IGN);       // 客户端中途断开时写失败即可，不能让服务退出
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_child_exit;  // 不设SA_RESTART
+    sigaction(SIGCHLD, &sa, NULL);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return 1;
+    unlink(sock_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        printf("无法监听 %s: %s\n", sock_path, strerror(errno));
+        close(fd);
+        return 1;
+    }
+    printf("编译服务已启动，监听 %s，最多同时编译 %d 个请求\n", sock_path, SERVER_MAX_JOBS);
+    fflush(stdout);
+
+    int running = 1;
+    while (running) {
+        reap_jobs(server_running == SERVER_MAX_JOBS);
+        int c = accept(fd, NULL, NULL);
+        if (c < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        set_socket_timeout(c, SERVER_TIMEOUT_MS);
+        int got = 0, len = read_request(c, req, sizeof(req), &got);
+        if (len < 0) {
+            dprintf(c, "@@status=1 请求不完整、超长或超时\n");
+            close(c);
+            printf("丢弃不完整或超时的请求\n");
+            fflush(stdout);
+            continue;
+        }
+        int nlines = split_request(req, lines, SERVER_MAX_ARGS + 2);
+
+        if (strcmp(lines[0], "COMPILE") == 0) {
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0) {
+                signal(SIGCHLD, SIG_DFL);
+                close(fd);
+                serve_compile(c, lines, nlines, req + len + 2, got - len - 2);
+            }
+            if (pid < 0) {
+                dprintf(c, "@@status=1 无法创建编译进程: %s\n", strerror(errno));
+            } else {
+                server_jobs[server_running].pid = pid;
+                server_jobs[server_running].start = now_us();
+                server_running++;
+            }
+        } else if (strcmp(lines[0], "STATS") == 0) {
+            reap_jobs(0);
+            dprintf(c, "请求 %ld 个，平均用时 %.3f ms，最长 %.3f ms，正在编译 %d 个\n",
+                    server_requests, server_requests ? server_total_us / server_requests / 1000 : 0.0,
+                    server_max_us / 1000, server_running);
+        } else if (strcmp(lines[0], "SHUTDOWN") == 0) {
+            dprintf(c, "编译服务已停止\n");
+            running = 0;
+        } else {
+            dprintf(c, "@@status=1 未知请求: %s\n", lines[0]);
+        }
+        close(c);
+    }
+    while (server_running > 0) reap_jobs(1);    // 已接受的请求编译完再退出
+    close(fd);
+    unlink(sock_path);
+    return 0;
+}
+
+// 瘦客户端：把请求发给编译服务，原样输出回复，退出码取结果行的状态。
+// args为空时request是STATS或SHUTDOWN，否则是COMPILE的参数
+int run_client(const char *sock_path, const char *request, int argc, char *argv[]) {
+    struct sockaddr_un addr;
+    char cwd[PATH_MAX], buf[4096];
+    int status = 0, from_stdin = 0, len = 0;
+    char head[SERVER_REQUEST_MAX];
+
+    if (unix_socket_addr(&addr, sock_path)) return 1;
+    if (argc > SERVER_MAX_ARGS) {
+        printf("参数过多\n");
+        return 1;
+    }
+    if (argc > 0) {
+        if (!getcwd(cwd, sizeof(cwd))) return 1;
+        len = snprintf(head, sizeof(head), "COMPILE\n%s\n", cwd);
+        for (int i = 0; i < argc && len < (int)sizeof(head); i++) {
+            if (strchr(argv[i], '\n')) {
+                printf("参数不能含换行符\n");
+                return 1;
+            }
+            if (strcmp(argv[i], "-") == 0) from_stdin = 1;
+            len += snprintf(head + len, sizeof(head) - len, "%s\n", argv[i]);
+        }
+    } else {
+        len = snprintf(head, sizeof(head), "%s\n", request);
+    }
+    if (len + 1 >= (int)sizeof(head)) {
+        printf("请求过长\n");
+        return 1;
+    }
+    head[len++] = '\n';
+
+    double start = now_us();
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        printf("无法连接编译服务 %s: %s\n", sock_path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    if (write(fd, head, len) != len) {
+        close(fd);
+        return 1;
+    }
+    // 源程序从标准输入读时原样转发，关闭写方向表示源程序结束
+    ssize_t n;
+    while (from_stdin && (n = read(0, buf, sizeof(buf))) > 0) {
+        if (write(fd, buf, n) != n) break;
+    }
+    shutdown(fd, SHUT_WR);
+
+    // 结果行在回复末尾，只保留最后一段用来找它
+    char tail[256];
+    size_t tail_len = 0;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        fwrite(buf, 1, n, stdout);
+        size_t room = sizeof(tail) - 1;
+        if ((size_t)n >= room) {
+            memcpy(tail, buf + n - room, room);
+            tail_len = room;
+        } else {
+            size_t drop = tail_len + n > room ? tail_len + n - room : 0;
+            memmove(tail, tail + drop, tail_len - drop);
+            tail_len -= drop;
+            memcpy(tail + tail_len, buf, n);
+            tail_len += n;
+        }
+    }
+    tail[tail_len] = '\0';
+    char *res = strstr(tail, "@@status=");
+    if (res) status = atoi(res + 9);
+    close(fd);
+    fprintf(stderr, "请求往返用时 %.3f ms\n", (now_us() - start) / 1000);
+    return status;
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+    if (argc >= 3 && (strcmp(argv[1], "--server") == 0 || strcmp(argv[1], "--connect") == 0)) {
+#ifdef HAVE_COMPILE_CACHE
+        if (strcmp(argv[1], "--server") == 0) return run_server(argv[2]);
+        if (argc == 4 && strcmp(argv[3], "--server-stats") == 0) return run_client(argv[2], "STATS", 0, NULL);
+        if (argc == 4 && strcmp(argv[3], "--shutdown") == 0) return run_client(argv[2], "SHUTDOWN", 0, NULL);
+        if (argc == 3) {
+            printf("缺少源程序\n");
+            return 1;
+        }
+        return run_client(argv[2], "COMPILE", argc - 3, argv + 3);
+#else
+        printf("此平台不支持编译服务\n");
+        return 1;
+#endif
+    }
+    return cj_compile(argc, argv);
+}
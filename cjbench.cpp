@@ -0,0 +1,406 @@
+// ===========================================================
+// cjbench：编译器吞吐量基准
+// 用固定种子的随机程序生成器造输入，分阶段测量词法分析、语法语义分析
+// （含代码生成，三者在同一遍里交错进行）、中间代码优化以及端到端的
+// 每秒行数和每秒字节数，结果可写成JSON供回归对比。
+//
+// 编译器的代码表、符号表都是定长的（MAX_CODES、maxsymbolIndex），单个main
+// 程序只能有几KB。所以生成的输入是一串各自完整的程序单元，每个单元都在
+// 这些上限之内；大输入就是更多的单元，逐个单元词法分析、编译，时间累加。
+//
+// 用法: cjbench [--seed N] [--sizes 1K,64K,1M] [--json 文件]    运行基准
+//       cjbench --gen 大小 [--seed N] -o 文件                   只生成输入
+//   大小可带 K、M、G 后缀，范围 1K～1G
+//
+// 构建: g++ -O2 -o cjbench cjbench.cpp   （cifafenxi.cpp 和 yuyifenxi.cpp 须在同一目录）
+// ===========================================================
+
+#define main lexer_main
+#include "cifafenxi.cpp"
+#undef main
+
+#define main compiler_main
+#include "yuyifenxi.cpp"
+#undef main
+
+#if !COMPILE_STATS || !defined(HAVE_COMPILE_CACHE)
+#error "cjbench需要编译统计（COMPILE_STATS）和POSIX环境"
+#endif
+
+#define BENCH_MAX_SIZES 16
+#define UNIT_MAX_BYTES (256 * 1024)
+#define UNIT_CODE_BUDGET 300        // 估算的中间代码条数，留足余量给循环展开
+#define GEN_MAX_VARS 24
+#define GEN_MAX_DEPTH 3             // 语句嵌套层数，每层循环占两级作用域
+#define GEN_MAX_EXPR_DEPTH 6
+
+// ===================== 随机程序生成 =====================
+// xorshift64*，不依赖库函数rand()，同一种子在任何平台上生成相同的程序
+
+unsigned long long gen_state;
+
+unsigned int gen_rand() {
+    gen_state ^= gen_state >> 12;
+    gen_state ^= gen_state << 25;
+    gen_state ^= gen_state >> 27;
+    return (unsigned int)((gen_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+int gen_range(int lo, int hi) {
+    return lo + (int)(gen_rand() % (unsigned int)(hi - lo + 1));
+}
+
+char unit_buf[UNIT_MAX_BYTES];
+int unit_len;
+int unit_vars;
+int unit_codes;     // 已生成语句的中间代码估算
+
+void emit_text(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(unit_buf + unit_len, sizeof(unit_buf) - unit_len, fmt, ap);
+    va_end(ap);
+    if (n > 0) unit_len += n;
+    if (unit_len > (int)sizeof(unit_buf) - 1) unit_len = sizeof(unit_buf) - 1;
+}
+
+void emit_indent(int depth) {
+    for (int i = 0; i <= depth; i++) emit_text("    ");
+}
+
+const char *comment_words[] = {
+    "计算", "循环", "累加", "结果", "临时", "变量", "检查", "边界",
+    "the", "value", "loop", "counter", "index", "sum", "note", "todo"
+};
+
+void gen_comment(int depth) {
+    int n = sizeof(comment_words) / sizeof(comment_words[0]);
+    if (gen_range(0, 3) == 0) {
+        // 长块注释，跨多行
+        int lines = gen_range(1, 12);
+        emit_indent(depth);
+        emit_text("/*");
+        for (int l = 0; l < lines; l++) {
+            int words = gen_range(4, 16);
+            for (int w = 0; w < words; w++) emit_text(" %s", comment_words[gen_rand() % n]);
+            emit_text("\n");
+            emit_indent(depth);
+        }
+        emit_text(" */\n");
+    } else {
+        int words = gen_range(2, 10);
+        emit_indent(depth);
+        emit_text("//");
+        for (int w = 0; w < words; w++) emit_text(" %s", comment_words[gen_rand() % n]);
+        emit_text("\n");
+    }
+}
+
+// 算术表达式，返回估算的指令条数。除数只用非零常量
+int gen_expr(int depth) {
+    if (depth <= 0 || gen_range(0, 3) == 0) {
+        if (gen_range(0, 2) == 0) {
+            emit_text("%d", gen_range(1, 99));
+        } else {
+            emit_text("v%d", gen_range(0, unit_vars - 1));
+        }
+        return 1;
+    }
+    static const char *ops[] = { "+", "-", "*", "+", "-" };
+    int paren = gen_range(0, 2) == 0;
+    int codes = 1;
+    if (paren) emit_text("(");
+    codes += gen_expr(depth - 1);
+    if (gen_range(0, 5) == 0) {
+        emit_text(" / %d", gen_range(1, 9));
+        codes++;
+    } else {
+        emit_text(" %s ", ops[gen_rand() % 5]);
+        codes += gen_expr(depth - 1);
+    }
+    if (paren) emit_text(")");
+    return codes;
+}
+
+int gen_cond() {
+    static const char *rel[] = { "<", "<=", ">", ">=", "==", "!=" };
+    int codes = 1;
+    emit_text("v%d %s ", gen_range(0, unit_vars - 1), rel[gen_rand() % 6]);
+    codes += gen_expr(2) + 1;
+    if (gen_range(0, 3) == 0) {
+        emit_text(gen_range(0, 1) ? " && " : " || ");
+        emit_text("v%d %s %d", gen_range(0, unit_vars - 1), rel[gen_rand() % 6], gen_range(0, 50));
+        codes += 4;
+    }
+    return codes;
+}
+
+void gen_block(int depth);
+
+void gen_stat(int depth) {
+    int kind = gen_range(0, 9);
+    if (depth >= GEN_MAX_DEPTH && kind >= 6) kind = gen_range(0, 5);
+
+    if (gen_range(0, 4) == 0) gen_comment(depth);
+    emit_indent(depth);
+    if (kind <= 4) {
+        emit_text("v%d = ", gen_range(0, unit_vars - 1));
+        unit_codes += gen_expr(gen_range(1, GEN_MAX_EXPR_DEPTH)) + 1;
+        emit_text("\n");
+    } else if (kind == 5) {
+        emit_text("write v%d\n", gen_range(0, unit_vars - 1));
+        unit_codes += 2;
+    } else if (kind <= 7) {
+        emit_text("if (");
+        unit_codes += gen_cond() + 1;
+        emit_text(") {\n");
+        gen_block(depth + 1);
+        emit_indent(depth);
+        if (gen_range(0, 1)) {
+            emit_text("} else {\n");
+            unit_codes++;
+            gen_block(depth + 1);
+            emit_indent(depth);
+        }
+        emit_text("}\n");
+    } else if (kind == 8) {
+        int v = gen_range(0, unit_vars - 1);
+        emit_text("while (v%d < %d) {\n", v, gen_range(5, 100));
+        unit_codes += 5;
+        gen_block(depth + 1);
+        emit_indent(depth + 1);
+        emit_text("v%d = v%d + 1\n", v, v);
+        unit_codes += 4;
+        emit_indent(depth);
+        emit_text("}\n");
+    } else {
+        int v = gen_range(0, unit_vars - 1);
+        emit_text("for (v%d = 0; v%d < %d; v%d++) {\n", v, v, gen_range(2, 50), v);
+        unit_codes += 10;
+        gen_block(depth + 1);
+        emit_indent(depth);
+        emit_text("}\n");
+    }
+}
+
+void gen_block(int depth) {
+    int n = gen_range(1, 4);
+    for (int i = 0; i < n && unit_codes < UNIT_CODE_BUDGET; i++) gen_stat(depth);
+}
+
+// 生成一个完整的main程序单元
+void gen_unit() {
+    unit_len = 0;
+    unit_codes = 0;
+    unit_vars = gen_range(4, GEN_MAX_VARS);
+
+    gen_comment(-1);
+    emit_text("main() {\n");
+    for (int i = 0; i < unit_vars; i++) emit_text("    var v%d:int\n", i);
+    for (int i = 0; i < unit_vars; i++) emit_text("    v%d = %d\n", i, gen_range(0, 9));
+    unit_codes = unit_vars * 2 + 1;
+    while (unit_codes < UNIT_CODE_BUDGET) gen_stat(0);
+    emit_text("}\n\n");
+}
+
+long count_lines(const char *s, int len) {
+    long n = 0;
+    for (int i = 0; i < len; i++) {
+        if (s[i] == '\n') n++;
+    }
+    return n;
+}
+
+// "64K" → 65536
+long long parse_size(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (*end == 'K' || *end == 'k') v *= 1024;
+    else if (*end == 'M' || *end == 'm') v *= 1024 * 1024;
+    else if (*end == 'G' || *end == 'g') v *= 1024.0 * 1024 * 1024;
+    return (long long)v;
+}
+
+int gen_file(long long size, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        printf("创建输出文件失败！\n");
+        return 1;
+    }
+    long long total = 0;
+    int units = 0;
+    while (total < size) {
+        gen_unit();
+        fwrite(unit_buf, 1, unit_len, f);
+        total += unit_len;
+        units++;
+    }
+    fclose(f);
+    printf("已生成 %s：%lld 字节，%d 个程序单元\n", path, total, units);
+    return 0;
+}
+
+// ===================== 基准测量 =====================
+
+enum BenchStage { BENCH_LEX, BENCH_PARSE, BENCH_OPTIMIZE, BENCH_TOTAL, BENCH_STAGES };
+const char *bench_stage_names[] = { "lex", "parse_sema_codegen", "optimize", "end_to_end" };
+
+typedef struct {
+    long long size;             // 要求的输入大小
+    long long bytes;            // 实际生成的字节数
+    long lines;
+    int units;
+    int failed_units;           // 编译出错的单元，正常应为0
+    long tokens, codes;
+    double ms[BENCH_STAGES];
+} BenchResult;
+
+// 词法分析加编译一个单元，阶段用时累加到r
+void bench_unit(BenchResult *r) {
+    char *tokbuf = NULL;
+    size_t toklen = 0;
+
+    double t0 = stat_wall_ms();
+    fin = fmemopen(unit_buf, unit_len, "r");
+    fout = open_memstream(&tokbuf, &toklen);
+    line = 1;
+    col = 0;
+    lexer();
+    fclose(fin);
+    fclose(fout);
+    double t1 = stat_wall_ms();
+
+    stats_reset();
+    fpTokenin = fmemopen(tokbuf, toklen, "r");
+    int es = compile_tokens();
+    double t2 = stat_wall_ms();
+    free(tokbuf);
+
+    r->ms[BENCH_LEX] += t1 - t0;
+    r->ms[BENCH_PARSE] += phase_stats[PHASE_PARSE].wall_ms;
+    r->ms[BENCH_OPTIMIZE] += phase_stats[PHASE_OPTIMIZE].wall_ms;
+    r->ms[BENCH_TOTAL] += t2 - t0;
+    r->tokens += stat_counters[STAT_TOKENS];
+    r->codes += codesIndex;
+    if (es != 0 || error_count > 0) r->failed_units++;
+}
+
+void bench_size(long long size, BenchResult *r) {
+    memset(r, 0, sizeof(*r));
+    r->size = size;
+    while (r->bytes < size) {
+        gen_unit();
+        r->bytes += unit_len;
+        r->lines += count_lines(unit_buf, unit_len);
+        r->units++;
+        bench_unit(r);
+    }
+}
+
+double per_sec(double amount, double ms) {
+    return ms > 0 ? amount / (ms / 1000.0) : 0;
+}
+
+void print_results(BenchResult *res, int n) {
+    printf("\n%-10s %-20s %12s %12s %12s\n", "输入", "阶段", "用时(ms)", "MB/s", "千行/s");
+    printf("--------------------------------------------------------------------------\n");
+    for (int i = 0; i < n; i++) {
+        BenchResult *r = &res[i];
+        char size[32];
+        snprintf(size, sizeof(size), "%lldK", r->size / 1024);
+        for (int s = 0; s < BENCH_STAGES; s++) {
+            printf("%-10s %-20s %12.2f %12.2f %12.1f\n", s == 0 ? size : "", bench_stage_names[s],
+                   r->ms[s], per_sec(r->bytes, r->ms[s]) / 1e6, per_sec(r->lines, r->ms[s]) / 1e3);
+        }
+        printf("%-10s %d 个单元，%lld 字节，%ld 行，%ld 个单词，%ld 条中间代码",
+               "", r->units, r->bytes, r->lines, r->tokens, r->codes);
+        if (r->failed_units) printf("，%d 个单元编译出错", r->failed_units);
+        printf("\n");
+    }
+}
+
+int write_results_json(const char *path, unsigned long long seed, BenchResult *res, int n) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        printf("无法写入结果文件 %s\n", path);
+        return 1;
+    }
+    fprintf(f, "{\n  \"compiler\": \"%s\",\n  \"opt_level\": %d,\n  \"seed\": %llu,\n  \"runs\": [",
+            COMPILER_VERSION, OPT_LEVEL, seed);
+    for (int i = 0; i < n; i++) {
+        BenchResult *r = &res[i];
+        fprintf(f, "%s\n    {\n      \"size\": %lld, \"bytes\": %lld, \"lines\": %ld, \"units\": %d,\n"
+                   "      \"tokens\": %ld, \"codes\": %ld, \"failed_units\": %d,\n      \"stages\": {",
+                i ? "," : "", r->size, r->bytes, r->lines, r->units, r->tokens, r->codes, r->failed_units);
+        for (int s = 0; s < BENCH_STAGES; s++) {
+            fprintf(f, "%s\n        \"%s\": { \"wall_ms\": %.3f, \"bytes_per_sec\": %.0f, \"lines_per_sec\": %.0f }",
+                    s ? "," : "", bench_stage_names[s], r->ms[s],
+                    per_sec(r->bytes, r->ms[s]), per_sec(r->lines, r->ms[s]));
+        }
+        fprintf(f, "\n      }\n    }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+    printf("\n结果已输出到 %s\n", path);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long long seed = 1;
+    const char *sizes = "1K,16K,256K,4M", *json = NULL, *output = NULL;
+    long long gen_size = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            sizes = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json = argv[++i];
+        } else if (strcmp(argv[i], "--gen") == 0 && i + 1 < argc) {
+            gen_size = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            printf("未知选项 %s\n", argv[i]);
+            return 1;
+        }
+    }
+    gen_state = seed * 2654435761ULL + 1;      // 种子为0时状态也不能为0
+
+    if (gen_size > 0) {
+        if (!output || gen_size > (1LL << 30)) {
+            printf("用法: %s --gen 大小(不超过1G) [--seed N] -o 文件\n", argv[0]);
+            return 1;
+        }
+        return gen_file(gen_size, output);
+    }
+
+    // 只测编译本身：不输出任何产物、不跟踪、不用缓存
+    emit_mask = 0;
+    trace_enabled = 0;
+    cache_enabled = 0;
+    stats_enabled = 1;
+    snprintf(tokenfile, sizeof(tokenfile), "bench");
+    snprintf(outbase, sizeof(outbase), "bench");
+
+    static BenchResult res[BENCH_MAX_SIZES];
+    int n = 0;
+    for (const char *p = sizes; *p && n < BENCH_MAX_SIZES; ) {
+        long long size = parse_size(p);
+        if (size < 1024 || size > (1LL << 30)) {
+            printf("输入大小须在1K～1G之间: %.*s\n", (int)strcspn(p, ","), p);
+            return 1;
+        }
+        bench_size(size, &res[n++]);
+        p += strcspn(p, ",");
+        if (*p == ',') p++;
+    }
+
+    print_results(res, n);
+    if (json && write_results_json(json, seed, res, n)) return 1;
+    for (int i = 0; i < n; i++) {
+        if (res[i].failed_units) return 2;
+    }
+    return 0;
+}
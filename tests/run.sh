@@ -0,0 +1,110 @@
+#!/bin/sh
+# ===========================================================
+# 回归测试：从源程序构建编译器和虚拟机，逐个运行 tests/*.cj
+#   1. 分别用 OPT_LEVEL=0 和默认优化级别编译，在虚拟机上运行（输入取
+#      同名 .in），两次的输出都与同名 .out 相同；
+#   2. 两次执行的指令条数与 counts.txt 记录的相同（优化前后的动态指令数）；
+#   3. 优化后的文本代码表（.codes.txt）装入虚拟机，输出和指令条数与
+#      二进制模块相同（浮点常量池、行号表、函数表都要能读回）；
+#   4. --check 对比解释器、快速解释器、分层执行、JIT和寄存器虚拟机，没有不一致；
+#   5. 虚拟机 --profile 写出的剖析文件能由编译器 --profile-use 读入，
+#      按剖析数据编译的程序输出不变。
+# 用法: sh tests/run.sh [--update]    --update 按当前结果重写 .out 和 counts.txt
+# ===========================================================
+cd "$(dirname "$0")/.." || exit 2
+update=0
+[ "$1" = "--update" ] && update=1
+
+bin=$(mktemp -d) || exit 2
+trap 'rm -rf "$bin"' EXIT
+g++ -Wall -o "$bin/cj" cj.cpp &&
+g++ -Wall -DOPT_LEVEL=0 -o "$bin/cj0" cj.cpp &&
+g++ -O2 -Wall -o "$bin/vm" xunijiqi.cpp || { echo "构建失败"; exit 2; }
+
+fail=0
+counts="$bin/counts.txt"
+printf '# 程序 O0 O1（虚拟机执行的指令条数）\n' > "$counts"
+
+# run_vm 模块 输入 → 输出写到 $bin/run.txt，指令条数写到 $bin/n.txt
+run_vm() {
+    "$bin/vm" "$1" < "$2" > "$bin/raw.txt" 2>&1
+    # 运行错误的指令序号随优化级别不同，只比较源程序位置和原因
+    grep -v '^程序运行结束' "$bin/raw.txt" | sed 's/^运行错误 \[[0-9]*\]/运行错误/' > "$bin/run.txt"
+    n=$(sed -n 's/^程序运行结束，共执行 \([0-9]*\) 条指令$/\1/p' "$bin/raw.txt")
+    echo "${n:--}" > "$bin/n.txt"
+}
+
+for src in tests/*.cj; do
+    name=$(basename "$src" .cj)
+    input=tests/$name.in
+    [ -f "$input" ] || input=/dev/null
+    n0=- n1=-
+    for level in 1 0; do
+        cc="$bin/cj"
+        [ $level = 0 ] && cc="$bin/cj0"
+        if ! "$cc" --no-cache --emit=codes,module -o "$bin/$name.O$level" "$src" > "$bin/compile.txt" 2>&1; then
+            echo "失败 $name: O$level 编译出错"
+            cat "$bin/compile.txt"
+            fail=1
+            continue
+        fi
+        run_vm "$bin/$name.O$level.cjm" "$input"
+        eval n$level='$(cat "$bin/n.txt")'
+        if [ $update = 1 ] && [ $level = 1 ]; then
+            cp "$bin/run.txt" "tests/$name.out"
+        elif ! cmp -s "$bin/run.txt" "tests/$name.out"; then
+            echo "失败 $name: O$level 输出与 $name.out 不同"
+            diff "tests/$name.out" "$bin/run.txt" | head -10
+            fail=1
+        fi
+    done
+    echo "$name $n0 $n1" >> "$counts"
+
+    run_vm "$bin/$name.O1.codes.txt" "$input"
+    if ! cmp -s "$bin/run.txt" "tests/$name.out" || [ "$(cat "$bin/n.txt")" != "$n1" ]; then
+        echo "失败 $name: 从文本代码表装入后结果不同"
+        diff "tests/$name.out" "$bin/run.txt" | head -10
+        fail=1
+    fi
+
+    "$bin/vm" --check "$bin/$name.O1.cjm" < "$input" > "$bin/check.txt" 2>&1
+    if grep -q '不一致（' "$bin/check.txt"; then
+        echo "失败 $name: --check 不一致"
+        cat "$bin/check.txt"
+        fail=1
+    fi
+done
+
+# 剖析反馈往返：带循环的程序和带函数调用的程序各一个
+for name in unroll func; do
+    input=tests/$name.in
+    [ -f "$input" ] || input=/dev/null
+    "$bin/vm" --profile "$bin/$name.O1.cjm" "$bin/$name.prof" < "$input" > /dev/null 2>&1
+    if ! "$bin/cj" -v --no-cache --profile-use="$bin/$name.prof.cjprof" -o "$bin/$name.pgo" \
+            "tests/$name.cj" > "$bin/pgo.txt" 2>&1 ||
+       ! grep -q '^读入剖析数据 [1-9][0-9]* 个位置' "$bin/pgo.txt"; then
+        echo "失败 $name: --profile-use 读不进 --profile 写出的剖析文件"
+        grep -i '剖析' "$bin/pgo.txt" | head -5
+        fail=1
+        continue
+    fi
+    run_vm "$bin/$name.pgo.cjm" "$input"
+    if ! cmp -s "$bin/run.txt" "tests/$name.out"; then
+        echo "失败 $name: 按剖析数据编译后输出不同"
+        diff "tests/$name.out" "$bin/run.txt" | head -10
+        fail=1
+    fi
+done
+
+if [ $update = 1 ]; then
+    cp "$counts" tests/counts.txt
+elif ! cmp -s "$counts" tests/counts.txt; then
+    echo "失败: 指令条数与 counts.txt 不同"
+    diff tests/counts.txt "$counts"
+    fail=1
+fi
+
+if [ $fail = 0 ]; then
+    echo "全部通过"
+fi
+exit $fail
@@ -0,0 +1,3559 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+#include <stdarg.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define HAVE_JIT 1
+#include <pthread.h>
+#else
+#define HAVE_JIT 0
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define HAVE_MMAP 0
+#endif
+
+#define MAX_CODES 1000
+#define MAX_STACK 1000
+#define MAX_MEM 1000
+#define MAX_IO 10000
+#define MAX_CONSTS 256
+
+// ===========================================================
+// 栈式虚拟机：执行语义分析程序输出的中间代码（二进制模块 *.cjm 或文本 *.codes.txt）
+// 装载时把操作码字符串预先译成枚举，执行时按枚举分派
+// 浮点指令只由解释器执行，AOT和寄存器虚拟机遇到时退回解释器，JIT在该指令处退回解释器
+// 用法：xunijiqi [--jit|--reg|--no-verify] [文件]
+//                                           校验后快速解释执行 / JIT执行 /
+//                                           寄存器虚拟机执行 / 不校验、逐条检查执行
+//       xunijiqi --tier=auto|interp|jit [--tier-threshold=进入次数,回边次数] 文件
+//                                           分层执行：先解释，变热后换用后台JIT编译的
+//                                           机器码，长循环在回边处栈上替换进机器码；
+//                                           interp/jit 固定只用一层
+//       xunijiqi --check 文件...            解释器与JIT、寄存器虚拟机对比测试
+//       xunijiqi --dump 文件                以文本代码表列出中间代码（含二进制模块）
+//       xunijiqi --aot 文件 [可执行文件]    经C编译器生成本机可执行文件
+//       xunijiqi --bench 次数 文件 [对照]   解释器、JIT与AOT基准测试，可与对照文件
+//                                           （如未用剖析数据编译的版本）比较
+//       xunijiqi --profile 文件 [前缀]      性能剖析：逐条计数，输出折叠栈
+//                                           <前缀>.folded、带计数的代码表 <前缀>.prof.txt
+//                                           和供编译器 --profile-use 的 <前缀>.cjprof
+// ===========================================================
+
+enum OpCode {
+    OP_LOAD, OP_LOADI, OP_STO,
+    OP_ADD, OP_SUB, OP_MULT, OP_DIV,
+    OP_GT, OP_GE, OP_LES, OP_LE, OP_EQ, OP_NOTEQ,
+    OP_AND, OP_OR, OP_NOT,
+    OP_BR, OP_BRF,
+    OP_READ, OP_WRITE,
+    OP_ENTER, OP_ALLOC, OP_CALL, OP_STOP,
+    // 浮点指令：操作数是值单元里的double
+    OP_LOADF, OP_ADDF, OP_SUBF, OP_MULTF, OP_DIVF,
+    OP_GTF, OP_GEF, OP_LESF, OP_LEF, OP_EQF, OP_NOTEQF,
+    OP_I2F, OP_F2I, OP_READF, OP_WRITEF,
+    // 函数返回（操作数为返回值个数0/1）、尾调用（释放本帧后转到被调函数）
+    OP_RET, OP_TAILCALL,
+    OP_COUNT
+};
+
+const char *op_names[OP_COUNT] = {
+    "LOAD", "LOADI", "STO",
+    "ADD", "SUB", "MULT", "DIV",
+    "GT", "GE", "LES", "LE", "EQ", "NOTEQ",
+    "AND", "OR", "NOT",
+    "BR", "BRF",
+    "READ", "WRITE",
+    "ENTER", "ALLOC", "CALL", "STOP",
+    "LOADF", "ADDF", "SUBF", "MULTF", "DIVF",
+    "GTF", "GEF", "LESF", "LEF", "EQF", "NOTEQF",
+    "I2F", "F2I", "READF", "WRITEF",
+    "RET", "TAILCALL"
+};
+
+typedef struct {
+    int op;         // enum OpCode
+    int operand;
+    int fused;      // 比较指令后紧跟BRF：解释器一次分派完成比较和跳转
+} Instr;
+
+// 文本代码表装入下面的缓冲区；二进制模块则直接指向映射区
+Instr code_buf[MAX_CODES];
+Instr *codes = code_buf;
+int codesIndex = 0;
+int codes_verified = 0;         // 已通过字节码校验，校验结果在重新装载前不变
+
+double const_buf[MAX_CONSTS];
+double *const_pool = const_buf; // 浮点常量池，LOADF的操作数是下标
+int constCount = 0;
+
+// ===========================================================
+// 值单元：操作数栈和变量存储区的每个单元是8字节的NaN装箱值。
+// 浮点数就是double本身；整数（bool、char也编译成整数）装在一个运算
+// 不会产生的NaN里：高16位为VAL_INT，低32位为值（小端下就是单元的
+// 前4个字节，JIT按32位读写）。运算得到的NaN一律换成规范的正NaN，
+// 不会与标记混淆。校验过的代码按指令的类型直接取值，不查标记；
+// 逐条检查的解释器 run 才检查标记。清零的单元是0.0，低32位也是整数0，
+// 所以未赋值的变量当整数或浮点读都是0
+// ===========================================================
+typedef unsigned long long Value;
+
+#define VAL_TAG_MASK 0xFFFF000000000000ULL
+#define VAL_INT      0xFFF9000000000000ULL
+#define VAL_INT_HI   0xFFF90000             // VAL_INT的高32位
+#define VAL_NAN      0x7FF8000000000000ULL
+
+int as_int(Value v) {
+    return (int)(unsigned int)v;
+}
+
+Value from_int(int i) {
+    return VAL_INT | (unsigned int)i;
+}
+
+int is_int(Value v) {
+    return (v & VAL_TAG_MASK) == VAL_INT;
+}
+
+double as_float(Value v) {
+    double d;
+    memcpy(&d, &v, sizeof(d));
+    return d;
+}
+
+Value from_float(double d) {
+    Value v;
+    if (d != d) return VAL_NAN;
+    memcpy(&v, &d, sizeof(v));
+    return v;
+}
+
+Value stack[MAX_STACK];
+int top = 0;            // 栈顶指针（指向第一个空位）
+Value mem[MAX_MEM];     // 变量存储区，按帧划分
+int fp = 0;             // 当前帧基址，操作数是相对帧基址的槽位
+int sp = 0;             // 帧栈顶（指向第一个未分配单元）
+
+// 调用栈：CALL记下返回地址和调用者的帧基址。被调函数的ENTER把帧开在
+// 调用者的帧之后，RET退回帧栈顶、恢复调用者的帧；TAILCALL先退回本帧
+// 再转到被调函数，调用栈不增长。实参和返回值经操作数栈传递
+#define MAX_CALL_DEPTH MAX_MEM      // 每帧至少一个单元，帧空间先于调用栈用完
+
+typedef struct {
+    int ret_pc;
+    int fp;
+} CallFrame;
+
+CallFrame call_stack[MAX_CALL_DEPTH];
+int call_depth = 0;
+
+long long exec_count = 0;
+
+// 对比测试时运行错误不退出，记下出错位置后跳回测试程序
+jmp_buf *error_guard = NULL;
+int error_pc = -1;
+
+// ===========================================================
+// 运行错误：输出出错位置后终止，有行号表时同时给出源程序位置
+// ===========================================================
+void print_src_pos(int pc);
+
+void runtime_error(int pc, const char *msg) {
+    if (error_guard) {
+        error_pc = pc;
+        longjmp(*error_guard, 1);
+    }
+    printf("运行错误 [%d]", pc);
+    print_src_pos(pc);
+    printf(": %s\n", msg);
+    exit(3);
+}
+
+int lookup_op(const char *name) {
+    for (int i = 0; i < OP_COUNT; i++)
+        if (strcmp(name, op_names[i]) == 0) return i;
+    return -1;
+}
+
+int is_compare_op(int op) {
+    return (op >= OP_GT && op <= OP_NOTEQ) || (op >= OP_GTF && op <= OP_NOTEQF);
+}
+
+// 标记"比较 + BRF"对：BRF不是跳转目标时，比较结果只供这条BRF使用，
+// 解释器不必压栈再弹出，直接按比较结果跳转
+void fuse_compare_branches() {
+    static char target[MAX_CODES];
+    memset(target, 0, sizeof(target));
+    for (int i = 0; i < codesIndex; i++) {
+        codes[i].fused = 0;
+        if ((codes[i].op == OP_BR || codes[i].op == OP_BRF) &&
+            codes[i].operand >= 0 && codes[i].operand < codesIndex) target[codes[i].operand] = 1;
+    }
+    for (int i = 0; i + 1 < codesIndex; i++) {
+        if (is_compare_op(codes[i].op) && codes[i + 1].op == OP_BRF && !target[i + 1]) codes[i].fused = 1;
+    }
+}
+
+// ===========================================================
+// 二进制模块（*.cjm）：语义分析程序输出的紧凑格式，整个文件映射进
+// 内存后直接在映射区上执行，不复制也不逐行解析。布局（本机字节序，
+// 各段按4字节对齐，常量段按8字节对齐）：
+//   文件头   ModuleHeader
+//   指令段   code_count 条 Instr（操作码、操作数、融合标记）
+//   常量段   const_count 个 double
+//   符号段   symbol_count 个 ModuleSymbol，名字存在字符串段
+//   行号段   line_count 个 ModuleLine（可选，游程编码：每项是源程序位置
+//            相同的一段指令的起点）
+//   字符串段 str_size 字节
+// 操作码编号就是 enum OpCode 的顺序，改动指令集时必须增加版本号
+// ===========================================================
+#define MODULE_MAGIC "CJBC"
+#define MODULE_VERSION 4
+#define MODULE_PREFUSED 1       // 融合标记已由编译器算好，装载时不必改写
+
+typedef struct {
+    char magic[4];
+    unsigned short version;
+    unsigned short flags;
+    unsigned int code_count, const_count, symbol_count, line_count;
+    unsigned int frame_size;
+    unsigned int code_off, const_off, symbol_off, line_off, str_off, str_size;
+    unsigned int file_size;
+} ModuleHeader;
+
+typedef struct {
+    unsigned int name;          // 字符串段内偏移
+    int type;                   // 编译器的 enum DataType
+    int kind;                   // 变量/函数/参数
+    int address;                // 帧内槽位；函数为入口指令序号，未链接为-1
+    int scope_level;
+    int params;                 // 函数的形参个数，形参符号紧跟在函数符号之后
+} ModuleSymbol;
+
+typedef struct {
+    unsigned int pc;
+    unsigned int line;
+    unsigned int col;
+} ModuleLine;
+
+const ModuleHeader *module = NULL;     // 当前装载的模块，文本代码表时为NULL
+size_t module_size = 0;
+
+// 行号表：每项是一段指令的起点和它对应的源程序行、列，按指令序号递增。
+// 文本代码表的 "行号 序号 = 行:列" 装入line_buf，二进制模块则指向行号段
+ModuleLine line_buf[MAX_CODES];
+const ModuleLine *line_table = line_buf;
+int lineCount = 0;
+
+int line_table_ok() {
+    for (int i = 0; i < lineCount; i++) {
+        if ((int)line_table[i].pc >= codesIndex || (i > 0 && line_table[i].pc <= line_table[i - 1].pc))
+            return 0;
+    }
+    return 1;
+}
+
+// 第pc条指令所在的行号表项，没有行号表时为NULL
+const ModuleLine *pos_of(int pc) {
+    int lo = 0, hi = lineCount - 1;
+    const ModuleLine *found = NULL;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if ((int)line_table[mid].pc <= pc) {
+            found = &line_table[mid];
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+void print_src_pos(int pc) {
+    const ModuleLine *p = pos_of(pc);
+    if (p && p->line) printf("（第%u行第%u列）", p->line, p->col);
+}
+
+// 第pc条指令对应的源程序行，没有行号表时为0
+int line_of(int pc) {
+    const ModuleLine *p = pos_of(pc);
+    return p ? p->line : 0;
+}
+
+// 函数表：各函数的入口、形参和返回值类型，校验时按入口把代码划分成函数。
+// 二进制模块取自符号段中已链接的函数，文本代码表取自
+// "函数 名字 = 入口 (形参类型, ...) 返回 类型" 行。程序入口0是main，不在表中
+#define MAX_FUNCS 64
+#define MAX_PARAMS 8
+
+typedef struct {
+    char name[64];
+    int entry;
+    int params;
+    char param_float[MAX_PARAMS];   // 形参是否为浮点
+    int rets;                       // 返回值个数0/1
+    int ret_float;
+} FuncSig;
+
+FuncSig func_sigs[MAX_FUNCS];
+int funcCount = 0;
+
+FuncSig *func_at(int entry) {
+    for (int i = 0; i < funcCount; i++) {
+        if (func_sigs[i].entry == entry) return &func_sigs[i];
+    }
+    return NULL;
+}
+
+int type_name_float(const char *name) {
+    return strcmp(name, "float") == 0 || strcmp(name, "double") == 0;
+}
+
+// 文本代码表的函数行，不是函数行返回0，格式不对返回-1
+int parse_func_line(const char *line) {
+    FuncSig g;
+    char ret[16];
+    int n = 0;
+
+    memset(&g, 0, sizeof(g));
+    if (sscanf(line, "函数 %63s = %d %n", g.name, &g.entry, &n) < 2 || n == 0) return 0;
+    const char *p = line + n, *close = strchr(p, ')');
+    if (*p != '(' || !close || sscanf(close + 1, " 返回 %15s", ret) != 1) return -1;
+    for (p++; p < close; ) {
+        char type[16];
+        int len;
+        while (*p == ' ' || *p == ',') p++;
+        if (p >= close) break;
+        if (g.params >= MAX_PARAMS || sscanf(p, "%15[^,) ]%n", type, &len) != 1) return -1;
+        g.param_float[g.params++] = type_name_float(type);
+        p += len;
+    }
+    g.rets = strcmp(ret, "void") != 0;
+    g.ret_float = type_name_float(ret);
+    if (funcCount >= MAX_FUNCS) return -1;
+    func_sigs[funcCount++] = g;
+    return 1;
+}
+
+void print_func_table(FILE *out) {
+    if (funcCount == 0) return;
+    fprintf(out, "\n函数表: %d 个\n", funcCount);
+    for (int i = 0; i < funcCount; i++) {
+        const FuncSig *g = &func_sigs[i];
+        fprintf(out, "函数 %s = %d (", g->name, g->entry);
+        for (int k = 0; k < g->params; k++) fprintf(out, "%s%s", k ? ", " : "", g->param_float[k] ? "float" : "int");
+        fprintf(out, ") 返回 %s\n", !g->rets ? "void" : g->ret_float ? "float" : "int");
+    }
+}
+
+void unload_module() {
+    funcCount = 0;
+    codes_verified = 0;
+    if (!module) return;
+#if HAVE_MMAP
+    munmap((void *)module, module_size);
+#else
+    free((void *)module);
+#endif
+    module = NULL;
+    codes = code_buf;
+    const_pool = const_buf;
+    line_table = line_buf;
+    lineCount = 0;
+}
+
+int module_section_ok(unsigned int off, unsigned int count, size_t size) {
+    return off % 4 == 0 && off <= module_size && count <= (module_size - off) / size;
+}
+
+int load_module_funcs();
+
+int load_module(const char *file) {
+    void *base;
+    size_t size;
+
+#if HAVE_MMAP
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        printf("打开%s错误!\n", file);
+        return 1;
+    }
+    size = st.st_size;
+    // 私有可写映射：只读的页与页缓存共享，融合标记需要补算时才按页复制
+    base = size >= sizeof(ModuleHeader) ?
+           mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("%s: 无法映射模块文件\n", file);
+        return 2;
+    }
+#else
+    FILE *fp = fopen(file, "rb");
+    if (!fp) {
+        printf("打开%s错误!\n", file);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    base = malloc(size ? size : 1);
+    if (!base || fread(base, 1, size, fp) != size || size < sizeof(ModuleHeader)) {
+        fclose(fp);
+        free(base);
+        printf("%s: 读取模块失败\n", file);
+        return 2;
+    }
+    fclose(fp);
+#endif
+
+    module = (const ModuleHeader *)base;
+    module_size = size;
+
+    const char *err = NULL;
+    if (memcmp(module->magic, MODULE_MAGIC, 4) != 0) err = "不是模块文件";
+    else if (module->version != MODULE_VERSION) err = "模块版本不符，请重新编译";
+    else if (module->file_size != size) err = "文件长度与文件头不符（文件被截断？）";
+    else if (module->code_count > MAX_CODES) err = "指令过多";
+    else if (module->const_count > MAX_CONSTS) err = "浮点常量过多";
+    else if (!module_section_ok(module->code_off, module->code_count, sizeof(Instr)) ||
+             !module_section_ok(module->const_off, module->const_count, sizeof(double)) ||
+             module->const_off % sizeof(double) != 0 ||
+             !module_section_ok(module->symbol_off, module->symbol_count, sizeof(ModuleSymbol)) ||
+             !module_section_ok(module->line_off, module->line_count, sizeof(ModuleLine)) ||
+             module->str_off > size || module->str_size > size - module->str_off)
+        err = "段超出文件范围";
+    if (err) {
+        printf("%s: %s\n", file, err);
+        unload_module();
+        return 2;
+    }
+
+    codes = (Instr *)((char *)base + module->code_off);
+    codesIndex = module->code_count;
+    const_pool = (double *)((char *)base + module->const_off);
+    constCount = module->const_count;
+    line_table = (const ModuleLine *)((char *)base + module->line_off);
+    lineCount = module->line_count;
+    if (!line_table_ok()) {
+        printf("%s: 行号表无效\n", file);
+        unload_module();
+        return 2;
+    }
+
+    for (int i = 0; i < codesIndex; i++) {
+        if (codes[i].op < 0 || codes[i].op >= OP_COUNT) {
+            printf("第%d条中间代码: 未知操作码编号 %d\n", i, codes[i].op);
+            unload_module();
+            return 2;
+        }
+    }
+    if (load_module_funcs()) {
+        printf("%s: 函数符号无效\n", file);
+        unload_module();
+        return 2;
+    }
+    if (!(module->flags & MODULE_PREFUSED)) fuse_compare_branches();
+    return 0;
+}
+
+const char *module_string(unsigned int off) {
+    if (!module || off >= module->str_size) return "?";
+    const char *str = (const char *)module + module->str_off + off;
+    return memchr(str, '\0', module->str_size - off) ? str : "?";
+}
+
+// 符号段中已链接的函数（入口大于0）登记到函数表，形参类型取紧随其后的
+// 形参符号。类型是编译器的 enum DataType：1、2为float、double，6为void
+int load_module_funcs() {
+    const ModuleSymbol *sym = (const ModuleSymbol *)((const char *)module + module->symbol_off);
+    unsigned int n = module->symbol_count;
+
+    for (unsigned int i = 0; i < n; i++) {
+        if (sym[i].kind != 1 || sym[i].address <= 0) continue;
+        if (funcCount >= MAX_FUNCS || sym[i].params < 0 || sym[i].params > MAX_PARAMS ||
+            sym[i].params >= (int)(n - i)) return 1;
+        FuncSig *g = &func_sigs[funcCount++];
+        memset(g, 0, sizeof(*g));
+        snprintf(g->name, sizeof(g->name), "%s", module_string(sym[i].name));
+        g->entry = sym[i].address;
+        g->params = sym[i].params;
+        for (int k = 0; k < g->params; k++) {
+            const ModuleSymbol *p = &sym[i + 1 + k];
+            if (p->kind != 2) return 1;
+            g->param_float[k] = p->type == 1 || p->type == 2;
+        }
+        g->rets = sym[i].type != 6;
+        g->ret_float = sym[i].type == 1 || sym[i].type == 2;
+    }
+    return 0;
+}
+
+// ===========================================================
+// 装载中间代码：以MODULE_MAGIC开头的是二进制模块，否则按文本代码表
+// 装载（每行 "序号 操作码 操作数"，浮点常量池每行 "常量 下标 = 值"，
+// 其余行如表头、总计跳过）
+// ===========================================================
+// 文本代码表中不含数据的行：各表的标题、表头、分隔线、空行，以及 --dump 附带的模块信息
+int is_code_heading(const char *line) {
+    static const char *heads[] = { "中间代码列表", "序号", "-", "总计", "浮点常量池", "行号表", "函数表",
+                                   "模块版本", "符号", " " };
+    if (line[strspn(line, " \t\r\n")] == '\0') return 1;
+    for (int i = 0; i < (int)(sizeof(heads) / sizeof(heads[0])); i++) {
+        if (strncmp(line, heads[i], strlen(heads[i])) == 0) return 1;
+    }
+    return 0;
+}
+
+int load_codes(const char *file) {
+    unload_module();
+
+    FILE *fp = fopen(file, "r");
+    if (!fp) {
+        printf("打开%s错误!\n", file);
+        return 1;
+    }
+
+    char line[512], opt[32];
+    int index, operand;
+    double value;
+    if (fread(line, 1, 4, fp) == 4 && memcmp(line, MODULE_MAGIC, 4) == 0) {
+        fclose(fp);
+        return load_module(file);
+    }
+    rewind(fp);
+
+    codesIndex = 0;
+    constCount = 0;
+    lineCount = 0;
+    int lineno = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        int is_func = parse_func_line(line);
+        if (is_func < 0) {
+            printf("函数行格式不对或函数过多: %s", line);
+            fclose(fp);
+            return 2;
+        }
+        if (is_func) continue;
+        if (sscanf(line, "常量 %d = %lf", &index, &value) == 2) {
+            if (index != constCount || constCount >= MAX_CONSTS) {
+                printf("浮点常量 %d 序号不连续或超过上限\n", index);
+                fclose(fp);
+                return 2;
+            }
+            const_pool[constCount++] = value;
+            continue;
+        }
+        int col = 0;
+        if (sscanf(line, "行号 %d = %d:%d", &index, &operand, &col) >= 2) {
+            if (lineCount >= MAX_CODES) {
+                printf("行号表过长\n");
+                fclose(fp);
+                return 2;
+            }
+            line_buf[lineCount].pc = index;
+            line_buf[lineCount].line = operand;
+            line_buf[lineCount].col = col;
+            lineCount++;
+            continue;
+        }
+        if (sscanf(line, "%d %31s %d", &index, opt, &operand) != 3) {
+            if (is_code_heading(line)) continue;
+            // 认不出的行不能悄悄跳过：文件编码与虚拟机不同时常量行、行号行都会这样丢掉
+            printf("%s 第%d行无法识别（文件编码与虚拟机不同？）: %s", file, lineno, line);
+            fclose(fp);
+            return 2;
+        }
+        if (index != codesIndex) {
+            printf("第%d条中间代码序号不连续\n", index);
+            fclose(fp);
+            return 2;
+        }
+        if (codesIndex >= MAX_CODES) {
+            printf("中间代码过多（上限%d条）\n", MAX_CODES);
+            fclose(fp);
+            return 2;
+        }
+        int op = lookup_op(opt);
+        if (op < 0) {
+            printf("第%d条中间代码: 未知操作码 %s\n", index, opt);
+            fclose(fp);
+            return 2;
+        }
+        codes[codesIndex].op = op;
+        codes[codesIndex].operand = operand;
+        codes[codesIndex].fused = 0;
+        codesIndex++;
+    }
+    fclose(fp);
+    if (!line_table_ok()) {
+        printf("行号表的指令序号不递增或越界\n");
+        return 2;
+    }
+    fuse_compare_branches();
+    for (int i = 0; i < codesIndex; i++) {
+        if (codes[i].op == OP_LOADF && (codes[i].operand < 0 || codes[i].operand >= constCount)) {
+            printf("第%d条中间代码: 浮点常量下标 %d 越界\n", i, codes[i].operand);
+            return 2;
+        }
+    }
+    return 0;
+}
+
+// 以文本代码表的格式输出已装载的代码和行号表（可再次装载），模块另附符号
+void dump_codes(FILE *out) {
+    static const char *type_str[] = { "int", "float", "double", "char", "string", "bool", "void", "array" };
+
+    fprintf(out, "中间代码列表:\n");
+    fprintf(out, "%-6s %-10s %-10s\n", "序号", "操作码", "操作数");
+    fprintf(out, "--------------------------\n");
+    for (int i = 0; i < codesIndex; i++) {
+        fprintf(out, "%-6d %-10s %-10d\n", i, op_names[codes[i].op], codes[i].operand);
+    }
+    fprintf(out, "\n总计: %d 条中间代码\n", codesIndex);
+    if (constCount > 0) {
+        fprintf(out, "\n浮点常量池: %d 个\n", constCount);
+        for (int i = 0; i < constCount; i++) fprintf(out, "常量 %d = %.17g\n", i, const_pool[i]);
+    }
+    if (lineCount > 0) {
+        fprintf(out, "\n行号表: %d 项\n", lineCount);
+        for (int i = 0; i < lineCount; i++)
+            fprintf(out, "行号 %u = %u:%u\n", line_table[i].pc, line_table[i].line, line_table[i].col);
+    }
+    print_func_table(out);
+    if (!module) return;
+
+    fprintf(out, "\n模块版本 %d，帧大小 %u\n", module->version, module->frame_size);
+    if (module->symbol_count > 0) {
+        const ModuleSymbol *sym = (const ModuleSymbol *)((const char *)module + module->symbol_off);
+        fprintf(out, "符号: %u 个\n", module->symbol_count);
+        for (unsigned int i = 0; i < module->symbol_count; i++) {
+            int t = sym[i].type;
+            fprintf(out, "  %-16s %-8s %s %-4d 作用域 %d\n", module_string(sym[i].name),
+                    t >= 0 && t < 8 ? type_str[t] : "unknown", sym[i].kind == 1 ? "入口" : "槽位",
+                    sym[i].address, sym[i].scope_level);
+        }
+    }
+}
+
+// ===========================================================
+// 输入输出：平时直接读写终端；对比测试和基准测试时
+// 第一遍运行记录输入，之后回放，输出只记录不打印
+// ===========================================================
+int io_record = 0, io_replay = 0, io_quiet = 0;
+// 记录和回放的是值单元，对比时按位比较
+Value in_buf[MAX_IO], out_buf[MAX_IO];
+int in_count = 0, in_pos = 0, out_count = 0;
+
+void vm_read(int pc, Value *dst) {
+    int v;
+    if (io_replay) {
+        if (in_pos >= in_count) runtime_error(pc, "回放输入不足");
+        *dst = in_buf[in_pos++];
+        return;
+    }
+    if (!io_quiet) printf("请输入: ");
+    if (scanf("%d", &v) != 1)
+        runtime_error(pc, "输入不是整数");
+    *dst = from_int(v);
+    if (io_record && in_count < MAX_IO) in_buf[in_count++] = *dst;
+}
+
+// 输出按指令的类型记录：未赋值的变量是清零的单元，各执行方式写出的都是整数0
+void vm_write(Value v) {
+    if (out_count < MAX_IO) out_buf[out_count] = from_int(as_int(v));
+    out_count++;
+    if (!io_quiet) printf("%d\n", as_int(v));
+}
+
+void vm_read_float(int pc, Value *dst) {
+    double d;
+    if (io_replay) {
+        if (in_pos >= in_count) runtime_error(pc, "回放输入不足");
+        *dst = in_buf[in_pos++];
+        return;
+    }
+    if (!io_quiet) printf("请输入: ");
+    if (scanf("%lf", &d) != 1)
+        runtime_error(pc, "输入不是数值");
+    *dst = from_float(d);
+    if (io_record && in_count < MAX_IO) in_buf[in_count++] = *dst;
+}
+
+void vm_write_float(Value v) {
+    if (out_count < MAX_IO) out_buf[out_count] = v;
+    out_count++;
+    if (!io_quiet) printf("%g\n", as_float(v));
+}
+
+// 每次运行前恢复初始状态（变量存储区清零）
+void vm_reset() {
+    top = 0;
+    fp = sp = 0;
+    call_depth = 0;
+    memset(mem, 0, sizeof(mem));
+    exec_count = 0;
+    in_pos = 0;
+    out_count = 0;
+    error_pc = -1;
+}
+
+void push(int pc, Value v) {
+    if (top >= MAX_STACK) runtime_error(pc, "栈溢出");
+    stack[top++] = v;
+}
+
+Value pop(int pc) {
+    if (top <= 0) runtime_error(pc, "栈下溢");
+    return stack[--top];
+}
+
+// 按指令的类型弹出并检查标记（清零的单元两种都算）
+int pop_int(int pc) {
+    Value v = pop(pc);
+    if (!is_int(v) && v != 0) runtime_error(pc, "操作数不是整数");
+    return as_int(v);
+}
+
+double pop_float(int pc) {
+    Value v = pop(pc);
+    if (is_int(v)) runtime_error(pc, "操作数不是浮点数");
+    return as_float(v);
+}
+
+Value *slot(int pc, int addr) {
+    if (addr < 0 || fp + addr >= sp) runtime_error(pc, "变量地址越界");
+    return &mem[fp + addr];
+}
+
+// 开辟n个单元的帧空间并清零。帧在连续的栈上，先前调用留下的值还在，
+// 不清零的话函数里没赋值的局部变量会读到上一次调用的值
+void alloc_frame(int pc, int n) {
+    if (n < 0 || sp + n > MAX_MEM) runtime_error(pc, "帧空间不足");
+    memset(&mem[sp], 0, sizeof(Value) * n);
+    sp += n;
+}
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ===========================================================
+// 性能剖析（--profile）：由逐条检查的解释器 run 执行，每分派一条
+// 指令计数一次，BRF另记跳转（条件不成立）的次数。函数按入口划分
+// 指令范围（程序入口和各CALL/TAILCALL目标），执行流进入另一个函数的范围时
+// 才读一次时钟，把这段用时记到前一个函数上。
+// 折叠栈按调用上下文计数：CALL/RET/TAILCALL跟着调用栈在调用上下文树上
+// 移动，每个结点是从main起的一条调用链，指令计数按(结点, 行)汇总，输出时
+// 沿父结点拼出 main;f;g;L12。结点表满了以后更深的调用记在调用者的结点上
+// ===========================================================
+#define MAX_PROF_FUNCS 64
+#define MAX_PROF_NODES 4096
+#define PROF_CELLS 65536            // (结点, 行)计数的散列表大小，2的幂
+
+int profiling = 0;
+long long prof_hits[MAX_CODES];     // 每条指令的执行次数
+long long prof_taken[MAX_CODES];    // BRF发生跳转的次数
+int prof_func[MAX_CODES];           // 指令所属函数
+int prof_entry[MAX_PROF_FUNCS];     // 函数入口指令序号，递增
+double prof_time[MAX_PROF_FUNCS];   // 函数内累计用时（秒）
+int prof_funcs = 0, prof_cur = 0;
+double prof_mark = 0;
+
+int prof_line[MAX_CODES];           // 指令所在行
+int prof_parent[MAX_PROF_NODES], prof_node_func[MAX_PROF_NODES];
+int prof_first[MAX_PROF_NODES], prof_next[MAX_PROF_NODES];     // 子结点链表
+int prof_nodes = 0, prof_node = 0;  // 当前调用链的结点
+int prof_saved[MAX_CALL_DEPTH];     // 各层调用前的结点，RET时恢复
+
+typedef struct {
+    int node, line;                 // node为-1是空位
+    long long count;
+} ProfCell;
+
+ProfCell prof_cells[PROF_CELLS];
+int prof_ncells = 0;
+long long prof_dropped = 0;         // 散列表满后没能计入折叠栈的指令数
+
+// parent调用函数f的结点，没有就新建
+int prof_child(int parent, int f) {
+    for (int c = prof_first[parent]; c >= 0; c = prof_next[c]) {
+        if (prof_node_func[c] == f) return c;
+    }
+    if (prof_nodes >= MAX_PROF_NODES) return parent;
+    int c = prof_nodes++;
+    prof_parent[c] = parent;
+    prof_node_func[c] = f;
+    prof_first[c] = -1;
+    prof_next[c] = prof_first[parent];
+    prof_first[parent] = c;
+    return c;
+}
+
+// 当前调用链上第pc条指令所在行计数一次
+void prof_count(int pc) {
+    int line = prof_line[pc];
+    unsigned h = ((unsigned)prof_node * 31u + (unsigned)line) * 2654435761u & (PROF_CELLS - 1);
+    while (prof_cells[h].node >= 0) {
+        if (prof_cells[h].node == prof_node && prof_cells[h].line == line) {
+            prof_cells[h].count++;
+            return;
+        }
+        h = (h + 1) & (PROF_CELLS - 1);
+    }
+    if (prof_ncells >= PROF_CELLS * 3 / 4) {
+        prof_dropped++;
+        return;
+    }
+    prof_ncells++;
+    prof_cells[h].node = prof_node;
+    prof_cells[h].line = line;
+    prof_cells[h].count = 1;
+}
+
+// CALL之后（call_depth已加1）、RET之后（已减1）、TAILCALL之后调用
+void profile_call(int entry) {
+    prof_saved[call_depth - 1] = prof_node;
+    prof_node = prof_child(prof_node, prof_func[entry]);
+}
+
+void profile_return() { prof_node = prof_saved[call_depth]; }
+
+void profile_tailcall(int entry) {
+    if (prof_node > 0) prof_node = prof_child(prof_parent[prof_node], prof_func[entry]);
+}
+
+void profile_step(int pc) {
+    prof_hits[pc]++;
+    prof_count(pc);
+    if (prof_func[pc] != prof_cur) {
+        double t = now_seconds();
+        prof_time[prof_cur] += t - prof_mark;
+        prof_mark = t;
+        prof_cur = prof_func[pc];
+    }
+}
+
+// ===========================================================
+// 解释执行
+// ===========================================================
+// 融合的比较：条件成立时跳过后面的BRF，不成立时直接转到BRF的目标
+#define COMPARE(cond) \
+    if (ins->fused) pc = fused_branch(pc, (cond)); \
+    else push(pc - 1, from_int(cond))
+
+// 融合的BRF不单独分派，剖析时在这里替它计数
+int fused_branch(int pc, int cond) {
+    if (profiling) {
+        prof_hits[pc]++;
+        prof_count(pc);
+        if (!cond) prof_taken[pc]++;
+    }
+    return cond ? pc + 1 : codes[pc].operand;
+}
+
+void run() {
+    int pc = 0, a, b;
+    double fa, fb;
+
+    while (1) {
+        if (pc < 0 || pc >= codesIndex) runtime_error(pc, "指令地址越界");
+        Instr *ins = &codes[pc++];
+        exec_count++;
+        if (profiling) profile_step(pc - 1);
+
+        switch (ins->op) {
+            case OP_LOAD:  push(pc - 1, *slot(pc - 1, ins->operand)); break;
+            case OP_LOADI: push(pc - 1, from_int(ins->operand)); break;
+            case OP_STO:   *slot(pc - 1, ins->operand) = pop(pc - 1); break;
+
+            // 整数运算按无符号进行，溢出时回绕（JIT、AOT和编译器的常量折叠相同）
+            case OP_ADD:   b = pop_int(pc - 1); a = pop_int(pc - 1); push(pc - 1, from_int((unsigned)a + (unsigned)b)); break;
+            case OP_SUB:   b = pop_int(pc - 1); a = pop_int(pc - 1); push(pc - 1, from_int((unsigned)a - (unsigned)b)); break;
+            case OP_MULT:  b = pop_int(pc - 1); a = pop_int(pc - 1); push(pc - 1, from_int((unsigned)a * (unsigned)b)); break;
+            case OP_DIV:
+                b = pop_int(pc - 1); a = pop_int(pc - 1);
+                if (b == 0) runtime_error(pc - 1, "除数为0");
+                // INT_MIN / -1 商溢出，硬件除法会触发SIGFPE，按取负回绕
+                push(pc - 1, from_int(b == -1 ? (int)(0u - (unsigned)a) : a / b));
+                break;
+
+            case OP_GT:    b = pop_int(pc - 1); a = pop_int(pc - 1); COMPARE(a > b); break;
+            case OP_GE:    b = pop_int(pc - 1); a = pop_int(pc - 1); COMPARE(a >= b); break;
+            case OP_LES:   b = pop_int(pc - 1); a = pop_int(pc - 1); COMPARE(a < b); break;
+            case OP_LE:    b = pop_int(pc - 1); a = pop_int(pc - 1); COMPARE(a <= b); break;
+            case OP_EQ:    b = pop_int(pc - 1); a = pop_int(pc - 1); COMPARE(a == b); break;
+            case OP_NOTEQ: b = pop_int(pc - 1); a = pop_int(pc - 1); COMPARE(a != b); break;
+            case OP_AND:   b = pop_int(pc - 1); a = pop_int(pc - 1); push(pc - 1, from_int(a && b)); break;
+            case OP_OR:    b = pop_int(pc - 1); a = pop_int(pc - 1); push(pc - 1, from_int(a || b)); break;
+            case OP_NOT:   push(pc - 1, from_int(!pop_int(pc - 1))); break;
+
+            case OP_BR:    pc = ins->operand; break;
+            case OP_BRF:
+                if (!pop_int(pc - 1)) {
+                    if (profiling) prof_taken[pc - 1]++;
+                    pc = ins->operand;
+                }
+                break;
+
+            case OP_READ:  vm_read(pc - 1, slot(pc - 1, ins->operand)); break;
+            case OP_WRITE: vm_write(*slot(pc - 1, ins->operand)); break;
+
+            case OP_ENTER:
+                fp = sp;
+                alloc_frame(pc - 1, ins->operand);
+                break;
+            case OP_ALLOC:
+                alloc_frame(pc - 1, ins->operand);     // 兼容逐个分配的旧代码
+                break;
+            case OP_CALL:
+                if (call_depth >= MAX_CALL_DEPTH) runtime_error(pc - 1, "调用层数过多");
+                call_stack[call_depth].ret_pc = pc;
+                call_stack[call_depth].fp = fp;
+                call_depth++;
+                pc = ins->operand;
+                if (profiling) profile_call(pc);
+                break;
+            case OP_RET:
+                if (call_depth <= 0) runtime_error(pc - 1, "RET不在函数中");
+                sp = fp;
+                call_depth--;
+                fp = call_stack[call_depth].fp;
+                pc = call_stack[call_depth].ret_pc;
+                if (profiling) profile_return();
+                break;
+            case OP_TAILCALL:
+                if (call_depth <= 0) runtime_error(pc - 1, "TAILCALL不在函数中");
+                sp = fp;
+                pc = ins->operand;
+                if (profiling) profile_tailcall(pc);
+                break;
+            case OP_STOP:
+                return;
+
+            case OP_LOADF: push(pc - 1, from_float(const_pool[ins->operand])); break;
+            case OP_ADDF:  fb = pop_float(pc - 1); fa = pop_float(pc - 1); push(pc - 1, from_float(fa + fb)); break;
+            case OP_SUBF:  fb = pop_float(pc - 1); fa = pop_float(pc - 1); push(pc - 1, from_float(fa - fb)); break;
+            case OP_MULTF: fb = pop_float(pc - 1); fa = pop_float(pc - 1); push(pc - 1, from_float(fa * fb)); break;
+            case OP_DIVF:
+                fb = pop_float(pc - 1); fa = pop_float(pc - 1);
+                if (fb == 0) runtime_error(pc - 1, "除数为0");
+                push(pc - 1, from_float(fa / fb));
+                break;
+
+            case OP_GTF:    fb = pop_float(pc - 1); fa = pop_float(pc - 1); COMPARE(fa > fb); break;
+            case OP_GEF:    fb = pop_float(pc - 1); fa = pop_float(pc - 1); COMPARE(fa >= fb); break;
+            case OP_LESF:   fb = pop_float(pc - 1); fa = pop_float(pc - 1); COMPARE(fa < fb); break;
+            case OP_LEF:    fb = pop_float(pc - 1); fa = pop_float(pc - 1); COMPARE(fa <= fb); break;
+            case OP_EQF:    fb = pop_float(pc - 1); fa = pop_float(pc - 1); COMPARE(fa == fb); break;
+            case OP_NOTEQF: fb = pop_float(pc - 1); fa = pop_float(pc - 1); COMPARE(fa != fb); break;
+
+            // I2F n：把距栈顶第n个值（0为栈顶）转成浮点，混合运算时转换左操作数用
+            case OP_I2F:
+                if (ins->operand < 0 || ins->operand >= top) runtime_error(pc - 1, "栈下溢");
+                a = top - 1 - ins->operand;
+                if (!is_int(stack[a]) && stack[a] != 0) runtime_error(pc - 1, "操作数不是整数");
+                stack[a] = from_float(as_int(stack[a]));
+                break;
+            case OP_F2I:   push(pc - 1, from_int((int)pop_float(pc - 1))); break;
+
+            case OP_READF:  vm_read_float(pc - 1, slot(pc - 1, ins->operand)); break;
+            case OP_WRITEF: vm_write_float(*slot(pc - 1, ins->operand)); break;
+        }
+    }
+}
+
+// ===========================================================
+// 字节码校验：装载后对整个程序做一次抽象解释，证明
+//   1. 跳转目标都在所在函数内，执行不会越过函数末尾；
+//   2. 每条指令处的操作数栈深度唯一（合流处一致）、不下溢、不超过上限；
+//   3. LOAD/STO/READ/WRITE 的操作数都是所在函数ENTER开辟的帧内槽位；
+//   4. 操作数类型匹配：整数指令只用整数，浮点指令只用浮点。
+// 代码按函数表的入口划分成函数，各函数从入口单独分析：入口处栈上是
+// 各实参，CALL按被调函数的形参弹出实参、压入返回值，RET时栈上只剩
+// 返回值，TAILCALL时栈上只有实参。栈深度都相对于函数入口。
+// 槽位类型随控制流变化（不同作用域的变量可复用同一槽位），合流处
+// 一个是整数一个是浮点的槽位标记为冲突，之后先写后读才合法。
+// 通过校验的程序由 run_fast 执行，运行时不再逐条检查。
+// JIT、AOT和寄存器虚拟机也以校验结果为前提。
+// ===========================================================
+int code_depth[MAX_CODES];      // 每条指令执行前的操作数栈深度，-1为不可达
+char code_target[MAX_CODES];    // 是否为跳转目标（基本块入口）
+int code_max_depth = 0;         // 操作数栈最大深度
+int code_frame = 0;             // ENTER开辟的帧大小，有函数时取各函数中最大的
+int code_func[MAX_CODES];       // 指令所属的函数，下标见sect_*，0为main
+
+// 函数划分：按入口递增，main的签名为NULL
+int sect_entry[MAX_FUNCS + 1], sect_frame[MAX_FUNCS + 1];
+const FuncSig *sect_sig[MAX_FUNCS + 1];
+int sectCount = 0;
+char verify_msg[256] = "";      // 校验失败的原因
+
+// 值类型：T_ANY是未写过的槽位（全0，作整数、浮点都是0）
+enum { T_ANY, T_INT, T_FLOAT, T_CONFLICT };
+
+const char *type_names[] = { "任意", "整数", "浮点", "冲突" };
+
+unsigned char vstack[MAX_CODES][MAX_STACK];    // 每条指令执行前的栈中各值类型
+unsigned char vslot[MAX_CODES][MAX_MEM];       // 每条指令执行前各槽位的类型
+
+int verify_fail(int pc, const char *fmt, ...) {
+    char detail[200];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(detail, sizeof(detail), fmt, ap);
+    va_end(ap);
+    if (pc >= 0 && pc < codesIndex)
+        snprintf(verify_msg, sizeof(verify_msg), "第%d条 %s %d: %s",
+                 pc, op_names[codes[pc].op], codes[pc].operand, detail);
+    else
+        snprintf(verify_msg, sizeof(verify_msg), "%s", detail);
+    return 0;
+}
+
+int is_slot_op(int op) {
+    return op == OP_LOAD || op == OP_STO || op == OP_READ || op == OP_WRITE ||
+           op == OP_READF || op == OP_WRITEF;
+}
+
+// 按函数表划分函数，每个函数以ENTER开头
+int split_functions() {
+    sectCount = 1;
+    sect_entry[0] = 0;
+    sect_sig[0] = NULL;
+    for (int i = 0; i < funcCount; i++) {
+        int e = func_sigs[i].entry, j;
+        if (e <= 0 || e >= codesIndex)
+            return verify_fail(-1, "函数 %s 的入口 %d 越界", func_sigs[i].name, e);
+        for (j = sectCount; j > 0 && sect_entry[j - 1] > e; j--) {
+            sect_entry[j] = sect_entry[j - 1];
+            sect_sig[j] = sect_sig[j - 1];
+        }
+        if (sect_entry[j - 1] == e) return verify_fail(-1, "函数 %s 的入口 %d 重复", func_sigs[i].name, e);
+        sect_entry[j] = e;
+        sect_sig[j] = &func_sigs[i];
+        sectCount++;
+    }
+    for (int i = 0, f = 0; i < codesIndex; i++) {
+        while (f + 1 < sectCount && sect_entry[f + 1] <= i) f++;
+        code_func[i] = f;
+    }
+
+    code_frame = 0;
+    for (int f = 0; f < sectCount; f++) {
+        int e = sect_entry[f], x = codes[e].operand;
+        if (codes[e].op != OP_ENTER)
+            return f == 0 ? verify_fail(-1, "入口缺少ENTER") : verify_fail(e, "函数 %s 的入口不是ENTER", sect_sig[f]->name);
+        if (x < 0 || x > MAX_MEM) return verify_fail(e, "帧大小超出范围（0..%d）", MAX_MEM);
+        sect_frame[f] = x;
+        if (x > code_frame) code_frame = x;
+    }
+    return 1;
+}
+
+// 逐条静态检查：操作数范围、ENTER位置、调用目标和返回值个数
+int verify_operands() {
+    if (!split_functions()) return 0;
+
+    for (int i = 0; i < codesIndex; i++) {
+        int op = codes[i].op, x = codes[i].operand, f = code_func[i];
+        switch (op) {
+            case OP_ENTER:
+                if (i != sect_entry[f]) return verify_fail(i, "ENTER只能出现在函数入口");
+                break;
+            case OP_ALLOC: return verify_fail(i, "逐个ALLOC的旧代码不能校验");
+            case OP_BR: case OP_BRF:
+                if (x < 0 || x >= codesIndex) return verify_fail(i, "跳转目标越界（共%d条）", codesIndex);
+                if (code_func[x] != f) return verify_fail(i, "跳转目标在另一个函数中");
+                code_target[x] = 1;
+                break;
+            case OP_CALL: case OP_TAILCALL:
+                if (!func_at(x)) return verify_fail(i, "调用目标不是函数入口");
+                if (op == OP_TAILCALL && f == 0) return verify_fail(i, "main中不能尾调用");
+                break;
+            case OP_RET:
+                if (f == 0) return verify_fail(i, "main中不能RET，应为STOP");
+                if (x != sect_sig[f]->rets)
+                    return verify_fail(i, "函数 %s 的返回值个数是%d", sect_sig[f]->name, sect_sig[f]->rets);
+                break;
+            case OP_LOADF:
+                if (x < 0 || x >= constCount) return verify_fail(i, "浮点常量下标越界（共%d个）", constCount);
+                break;
+            default:
+                if (is_slot_op(op) && (x < 0 || x >= sect_frame[f]))
+                    return verify_fail(i, "槽位越界（帧大小%d）", sect_frame[f]);
+                break;
+        }
+    }
+    // run_fast直接按融合标记跳转，模块里的标记也要核对
+    for (int i = 0; i < codesIndex; i++) {
+        if (codes[i].fused && !(codes[i].fused == 1 && is_compare_op(codes[i].op) && i + 1 < codesIndex &&
+                                codes[i + 1].op == OP_BRF && !code_target[i + 1]))
+            return verify_fail(i, "融合标记不合法");
+    }
+    return 1;
+}
+
+// 把pc处的出口状态合并进后继t，状态有变化返回1，出错返回-1
+int verify_merge(int pc, int t, int d, const unsigned char *stk, const unsigned char *slots) {
+    if (code_depth[t] < 0) {
+        code_depth[t] = d;
+        memcpy(vstack[t], stk, d);
+        memcpy(vslot[t], slots, code_frame);
+        return 1;
+    }
+    if (code_depth[t] != d) {
+        verify_fail(pc, "到第%d条的栈深度为%d，与已有的%d不一致", t, d, code_depth[t]);
+        return -1;
+    }
+
+    int changed = 0;
+    for (int i = 0; i < d; i++) {
+        if (vstack[t][i] == stk[i] || stk[i] == T_ANY) continue;
+        if (vstack[t][i] != T_ANY) {
+            verify_fail(pc, "到第%d条时栈中第%d个值一边是%s一边是%s", t, i,
+                        type_names[vstack[t][i]], type_names[stk[i]]);
+            return -1;
+        }
+        vstack[t][i] = stk[i];
+        changed = 1;
+    }
+    for (int i = 0; i < code_frame; i++) {
+        unsigned char old = vslot[t][i], now = slots[i];
+        if (old == now || now == T_ANY || old == T_CONFLICT) continue;
+        vslot[t][i] = old == T_ANY ? now : (unsigned char)T_CONFLICT;
+        changed = 1;
+    }
+    return changed;
+}
+
+// 检查栈顶第k个值（0为栈顶）的类型
+int verify_expect(int pc, const unsigned char *stk, int d, int k, int type) {
+    int t = stk[d - 1 - k];
+    if (t == type || t == T_ANY) return 1;
+    return verify_fail(pc, "需要%s操作数，栈中是%s", type_names[type], type_names[t]);
+}
+
+int verify_codes() {
+    static int work[MAX_CODES];
+    static unsigned char stk[MAX_STACK], slots[MAX_MEM];
+    static char queued[MAX_CODES];
+    int nwork = 0;
+
+    verify_msg[0] = '\0';
+    codes_verified = 0;
+    code_max_depth = 0;
+    for (int i = 0; i < codesIndex; i++) {
+        code_depth[i] = -1;
+        code_target[i] = 0;
+        queued[i] = 0;
+    }
+    if (codesIndex == 0) return verify_fail(-1, "没有中间代码");
+    if (!verify_operands()) return 0;
+
+    // 各函数从入口分析，入口处栈上是按形参类型的实参
+    for (int f = 0; f < sectCount; f++) {
+        int e = sect_entry[f], n = sect_sig[f] ? sect_sig[f]->params : 0;
+        code_depth[e] = n;
+        for (int k = 0; k < n; k++) vstack[e][k] = sect_sig[f]->param_float[k] ? T_FLOAT : T_INT;
+        memset(vslot[e], T_ANY, code_frame);
+        work[nwork++] = e;
+        queued[e] = 1;
+    }
+
+    while (nwork > 0) {
+        int pc = work[--nwork], d = code_depth[pc], op = codes[pc].op, x = codes[pc].operand;
+        queued[pc] = 0;
+        memcpy(stk, vstack[pc], d);
+        memcpy(slots, vslot[pc], code_frame);
+
+        // 各指令的栈效果：need为需要的操作数个数，in/out为操作数、结果类型
+        int need = 0, in = T_INT, out = -1;
+        switch (op) {
+            case OP_LOAD:
+                if (slots[x] == T_CONFLICT)
+                    return verify_fail(pc, "槽位%d在合流处一边是整数一边是浮点", x);
+                out = slots[x];
+                break;
+            case OP_LOADI: out = T_INT; break;
+            case OP_LOADF: out = T_FLOAT; break;
+            case OP_STO:
+                if (d < 1) return verify_fail(pc, "操作数栈下溢");
+                slots[x] = stk[--d];
+                break;
+            case OP_ADD: case OP_SUB: case OP_MULT: case OP_DIV:
+            case OP_GT: case OP_GE: case OP_LES: case OP_LE: case OP_EQ: case OP_NOTEQ:
+            case OP_AND: case OP_OR:
+                need = 2; out = T_INT;
+                break;
+            case OP_ADDF: case OP_SUBF: case OP_MULTF: case OP_DIVF:
+                need = 2; in = T_FLOAT; out = T_FLOAT;
+                break;
+            case OP_GTF: case OP_GEF: case OP_LESF: case OP_LEF: case OP_EQF: case OP_NOTEQF:
+                need = 2; in = T_FLOAT; out = T_INT;
+                break;
+            case OP_NOT: need = 1; out = T_INT; break;
+            case OP_F2I: need = 1; in = T_FLOAT; out = T_INT; break;
+            case OP_I2F:
+                if (x < 0 || x >= d) return verify_fail(pc, "栈中只有%d个值", d);
+                if (!verify_expect(pc, stk, d, x, T_INT)) return 0;
+                stk[d - 1 - x] = T_FLOAT;
+                break;
+            case OP_BRF: need = 1; break;
+            case OP_CALL: case OP_TAILCALL: {
+                const FuncSig *g = func_at(x), *cur = sect_sig[code_func[pc]];
+                if (d < g->params) return verify_fail(pc, "%s 需要%d个实参，栈中只有%d个值", g->name, g->params, d);
+                for (int k = 0; k < g->params; k++) {
+                    if (!verify_expect(pc, stk, d, g->params - 1 - k, g->param_float[k] ? T_FLOAT : T_INT)) return 0;
+                }
+                if (op == OP_TAILCALL) {
+                    if (d != g->params) return verify_fail(pc, "尾调用时栈上除实参外还有%d个值", d - g->params);
+                    if (g->rets != cur->rets || (g->rets && g->ret_float != cur->ret_float))
+                        return verify_fail(pc, "尾调用的 %s 与 %s 返回值类型不同", g->name, cur->name);
+                }
+                d -= g->params;
+                if (g->rets) out = g->ret_float ? T_FLOAT : T_INT;
+                break;
+            }
+            case OP_RET:
+                if (d != x) return verify_fail(pc, "返回时栈中有%d个值，应为%d个", d, x);
+                if (x && !verify_expect(pc, stk, d, 0, sect_sig[code_func[pc]]->ret_float ? T_FLOAT : T_INT))
+                    return 0;
+                break;
+            case OP_READ:  slots[x] = T_INT; break;
+            case OP_READF: slots[x] = T_FLOAT; break;
+            case OP_WRITE: case OP_WRITEF: {
+                int want = op == OP_WRITE ? T_INT : T_FLOAT;
+                if (slots[x] == T_CONFLICT)
+                    return verify_fail(pc, "槽位%d在合流处一边是整数一边是浮点", x);
+                if (slots[x] != want && slots[x] != T_ANY)
+                    return verify_fail(pc, "槽位%d是%s，不能按%s输出", x,
+                                       type_names[slots[x]], type_names[want]);
+                break;
+            }
+        }
+        if (d < need) return verify_fail(pc, "操作数栈下溢");
+        for (int k = 0; k < need; k++) {
+            if (!verify_expect(pc, stk, d, k, in)) return 0;
+        }
+        d -= need;
+        if (out >= 0) {
+            if (d >= MAX_STACK) return verify_fail(pc, "操作数栈超过上限%d", MAX_STACK);
+            stk[d++] = out;
+        }
+        if (d > code_max_depth) code_max_depth = d;
+
+        int succ[2], nsucc = 0;
+        if (op == OP_BR) succ[nsucc++] = x;
+        else if (op != OP_STOP && op != OP_RET && op != OP_TAILCALL) {
+            if (pc + 1 >= codesIndex) return verify_fail(pc, "执行越过代码末尾");
+            if (code_func[pc + 1] != code_func[pc]) return verify_fail(pc, "执行越过函数末尾");
+            succ[nsucc++] = pc + 1;
+            if (op == OP_BRF) succ[nsucc++] = x;
+        }
+        for (int k = 0; k < nsucc; k++) {
+            int t = succ[k], r = verify_merge(pc, t, d, stk, slots);
+            if (r < 0) return 0;
+            if (r > 0 && !queued[t]) {
+                work[nwork++] = t;
+                queued[t] = 1;
+            }
+        }
+    }
+    codes_verified = 1;
+    return 1;
+}
+
+// ===========================================================
+// 快速解释执行：只用于通过校验的程序。栈深度、槽位范围和跳转目标
+// 已经证明合法，这里不再检查，只保留除数为0和输入错误等运行时错误
+// ===========================================================
+#define FAST_COMPARE(cond) \
+    if (ins->fused) pc = (cond) ? pc + 1 : codes[pc].operand; \
+    else *s++ = from_int(cond)
+
+// 分层执行时按函数统计进入次数和循环回边（跳回前面的BR），到阈值就请求
+// JIT编译；所在函数的机器码就绪后在下一个回边处让出，由机器码从循环头接着
+// 执行（栈上替换）。被调函数的机器码就绪时CALL直接执行机器码，见"分层执行"
+#define TIER_CALL_THRESHOLD 2           // 进入函数这么多次后编译
+#define TIER_LOOP_THRESHOLD 10000       // 函数里的循环回边累计这么多次后编译
+
+int tier_counting = 0;
+long long tier_loop_threshold = TIER_LOOP_THRESHOLD;
+int osr_pc = -1;                        // 让出后从这里进入机器码
+int tier_backedge(int pc);
+int tier_enter_func(int entry);
+void tier_exec(int pc, int stop_depth);
+
+// 从第pc条指令、当前的操作数栈深度top和帧fp接着执行。执行到STOP，或RET
+// 使调用层数回到stop_depth时返回0（stop_depth为-1时只在STOP返回）；
+// 分层执行时机器码已就绪，在回边或尾调用处保存栈深度后返回1，续点在osr_pc
+int run_fast_until(int pc, int stop_depth) {
+    int a, b;
+    Value *s = stack + top, *r = mem + fp;
+    double fa, fb;
+
+    while (1) {
+        Instr *ins = &codes[pc++];
+        exec_count++;
+
+        switch (ins->op) {
+            case OP_LOAD:  *s++ = r[ins->operand]; break;
+            case OP_LOADI: *s++ = from_int(ins->operand); break;
+            case OP_STO:   r[ins->operand] = *--s; break;
+
+            case OP_ADD:   b = as_int(*--s); s[-1] = from_int((unsigned)as_int(s[-1]) + (unsigned)b); break;
+            case OP_SUB:   b = as_int(*--s); s[-1] = from_int((unsigned)as_int(s[-1]) - (unsigned)b); break;
+            case OP_MULT:  b = as_int(*--s); s[-1] = from_int((unsigned)as_int(s[-1]) * (unsigned)b); break;
+            case OP_DIV:
+                b = as_int(*--s);
+                if (b == 0) runtime_error(pc - 1, "除数为0");
+                s[-1] = from_int(b == -1 ? (int)(0u - (unsigned)as_int(s[-1])) : as_int(s[-1]) / b);
+                break;
+
+            case OP_GT:    b = as_int(*--s); a = as_int(*--s); FAST_COMPARE(a > b); break;
+            case OP_GE:    b = as_int(*--s); a = as_int(*--s); FAST_COMPARE(a >= b); break;
+            case OP_LES:   b = as_int(*--s); a = as_int(*--s); FAST_COMPARE(a < b); break;
+            case OP_LE:    b = as_int(*--s); a = as_int(*--s); FAST_COMPARE(a <= b); break;
+            case OP_EQ:    b = as_int(*--s); a = as_int(*--s); FAST_COMPARE(a == b); break;
+            case OP_NOTEQ: b = as_int(*--s); a = as_int(*--s); FAST_COMPARE(a != b); break;
+            case OP_AND:   b = as_int(*--s); s[-1] = from_int(as_int(s[-1]) && b); break;
+            case OP_OR:    b = as_int(*--s); s[-1] = from_int(as_int(s[-1]) || b); break;
+            case OP_NOT:   s[-1] = from_int(!as_int(s[-1])); break;
+
+            case OP_BR:
+                if (tier_counting && ins->operand < pc && tier_backedge(pc - 1)) {
+                    top = s - stack;
+                    osr_pc = ins->operand;
+                    return 1;
+                }
+                pc = ins->operand;
+                break;
+            case OP_BRF:   if (!as_int(*--s)) pc = ins->operand; break;
+
+            case OP_READ:  vm_read(pc - 1, &r[ins->operand]); break;
+            case OP_WRITE: vm_write(r[ins->operand]); break;
+
+            case OP_ENTER:
+                fp = sp;
+                alloc_frame(pc - 1, ins->operand);
+                r = mem + fp;
+                break;
+            // 校验只保证每个函数内的栈深度，递归时栈上还压着各层调用者的值
+            case OP_CALL:
+                if (call_depth >= MAX_CALL_DEPTH || s + code_max_depth > stack + MAX_STACK)
+                    runtime_error(pc - 1, "调用层数过多，栈溢出");
+                call_stack[call_depth].ret_pc = pc;
+                call_stack[call_depth].fp = fp;
+                call_depth++;
+                if (tier_counting && tier_enter_func(ins->operand)) {
+                    top = s - stack;
+                    tier_exec(ins->operand, call_depth - 1);
+                    s = stack + top;
+                    r = mem + fp;
+                    break;
+                }
+                pc = ins->operand;
+                break;
+            case OP_RET:
+                sp = fp;
+                call_depth--;
+                fp = call_stack[call_depth].fp;
+                pc = call_stack[call_depth].ret_pc;
+                r = mem + fp;
+                if (call_depth == stop_depth) {
+                    top = s - stack;
+                    return 0;
+                }
+                break;
+            case OP_TAILCALL:
+                sp = fp;
+                pc = ins->operand;
+                if (tier_counting && tier_enter_func(pc)) {
+                    top = s - stack;
+                    osr_pc = pc;
+                    return 1;
+                }
+                break;
+            case OP_STOP:
+                top = s - stack;
+                return 0;
+
+            case OP_LOADF: *s++ = from_float(const_pool[ins->operand]); break;
+            case OP_ADDF:  fb = as_float(*--s); s[-1] = from_float(as_float(s[-1]) + fb); break;
+            case OP_SUBF:  fb = as_float(*--s); s[-1] = from_float(as_float(s[-1]) - fb); break;
+            case OP_MULTF: fb = as_float(*--s); s[-1] = from_float(as_float(s[-1]) * fb); break;
+            case OP_DIVF:
+                fb = as_float(*--s);
+                if (fb == 0) runtime_error(pc - 1, "除数为0");
+                s[-1] = from_float(as_float(s[-1]) / fb);
+                break;
+
+            case OP_GTF:    fb = as_float(*--s); fa = as_float(*--s); FAST_COMPARE(fa > fb); break;
+            case OP_GEF:    fb = as_float(*--s); fa = as_float(*--s); FAST_COMPARE(fa >= fb); break;
+            case OP_LESF:   fb = as_float(*--s); fa = as_float(*--s); FAST_COMPARE(fa < fb); break;
+            case OP_LEF:    fb = as_float(*--s); fa = as_float(*--s); FAST_COMPARE(fa <= fb); break;
+            case OP_EQF:    fb = as_float(*--s); fa = as_float(*--s); FAST_COMPARE(fa == fb); break;
+            case OP_NOTEQF: fb = as_float(*--s); fa = as_float(*--s); FAST_COMPARE(fa != fb); break;
+
+            case OP_I2F:   s[-1 - ins->operand] = from_float(as_int(s[-1 - ins->operand])); break;
+            case OP_F2I:   s[-1] = from_int((int)as_float(s[-1])); break;
+
+            case OP_READF:  vm_read_float(pc - 1, &r[ins->operand]); break;
+            case OP_WRITEF: vm_write_float(r[ins->operand]); break;
+        }
+    }
+}
+
+int run_fast_from(int pc) { return run_fast_until(pc, -1); }
+
+void run_fast() { run_fast_from(0); }
+
+// ===========================================================
+// 翻译前检查（JIT和AOT共用）：在校验的基础上检查第from到to-1条指令。
+// 整个程序一起翻译时函数调用不翻译；分层执行按函数翻译（allow_call非0），
+// 调用经运行时辅助函数进行。浮点指令AOT不翻译；JIT翻译成退回解释器的
+// 出口（allow_float非0）
+// ===========================================================
+int analyze_codes(int from, int to, const char **why, int allow_float, int allow_call) {
+    for (int i = from; i < to; i++) {
+        switch (codes[i].op) {
+            case OP_CALL: case OP_RET: case OP_TAILCALL:
+                if (allow_call) break;
+                *why = "含函数调用";
+                return 0;
+            case OP_LOADF: case OP_ADDF: case OP_SUBF: case OP_MULTF: case OP_DIVF:
+            case OP_GTF: case OP_GEF: case OP_LESF: case OP_LEF: case OP_EQF: case OP_NOTEQF:
+            case OP_I2F: case OP_F2I: case OP_READF: case OP_WRITEF:
+                if (allow_float) break;
+                *why = "含浮点指令";
+                return 0;
+            case OP_ALLOC: *why = "含ALLOC"; return 0;
+        }
+    }
+    // 已校验过就直接用结果：后台编译线程不能重写解释器正在读的code_depth等
+    if (!codes_verified && !verify_codes()) {
+        *why = verify_msg;
+        return 0;
+    }
+    return 1;
+}
+
+// ===========================================================
+// x86-64 模板JIT：把中间代码逐条翻译成机器码
+// 翻译时维护一个虚拟操作数栈：LOADI/LOAD先不生成代码，等参与运算时
+// 直接折叠成立即数或内存操作数；中间结果留在寄存器里，比较结果留在
+// 标志位里供紧跟的BRF直接条件跳转。寄存器不够或到达基本块边界时
+// 才写回操作数栈内存（每条指令处的栈深度在翻译前静态算出）。
+// 寄存器约定：rbx = JitRuntime，r12 = 当前帧基址，r13 = 操作数栈基址，
+// eax/edx 作临时寄存器，ecx/esi/edi/r8d-r11d 缓存栈顶的中间结果。
+// 翻译的都是整数指令：读值单元只读低32位，写时连同高32位的整数标记一起写。
+// 代码先写入可读写页，写完改成只读可执行（W^X）。
+// 基本块入口处栈上各项都在内存里，与解释器的状态相同，所以：
+// 解释器可以在循环回边处经第二个入口跳进任一跳转目标（栈上替换）；
+// 浮点指令不翻译，翻译成出口：写回栈上各项、记下续点后返回JIT_DEOPT，
+// 由解释器从该指令接着执行（退回解释器）。
+// 按函数翻译时r13是本次调用的操作数栈基址（实参之下），各指令处的栈深度
+// 相对它计算。CALL写回栈上各项后经jit_call执行被调函数，返回后栈上各项
+// 都在内存里，所以CALL之后的指令也能作入口；RET和TAILCALL写回后返回
+// JIT_RET / JIT_TAILCALL，由分层执行完成退帧或转到被调函数。
+// ===========================================================
+
+typedef struct {
+    int error_pc;       // 运行错误的指令序号
+    int resume_pc;      // 退回解释器时的续点
+} JitRuntime;
+
+typedef int (*JitFn)(JitRuntime *rt, Value *opstack, Value *frame);
+typedef int (*JitOsrFn)(JitRuntime *rt, Value *opstack, Value *frame, void *target);
+
+enum { JIT_OK = 0, JIT_DIV_ZERO = 1, JIT_DEOPT = 2, JIT_RET = 3, JIT_TAILCALL = 4 };
+
+// 一段翻译好的机器码：整个程序，或分层执行时的一个函数
+typedef struct {
+    void *code;             // mmap得到的可执行页
+    size_t size;
+    int len;                // 机器码字节数
+    JitFn fn;               // 从头执行
+    JitOsrFn osr;           // 栈上替换入口，target为要进入的机器码地址
+} JitUnit;
+
+int jit_len = 0;            // 正在翻译的机器码字节数
+JitUnit jit_prog;           // --jit / --check / 基准测试用的整个程序
+void tier_call(Value *s, int pc);
+
+#if HAVE_JIT
+
+enum { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+       R8 = 8, R9, R10, R11, R12, R13, R14, R15 };
+
+// 虚拟操作数栈上的一项
+enum { VS_MEM, VS_CONST, VS_LOCAL, VS_REG, VS_FLAGS };
+typedef struct {
+    int kind;
+    int val;            // 常量值 / 帧内槽位 / 寄存器号 / 条件码
+} VSlot;
+
+// x86条件码（jcc/setcc的低4位），取反只需异或1
+enum { CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+const int jit_pool[] = { RCX, RSI, RDI, R8, R9, R10, R11 };
+#define JIT_POOL_SIZE ((int)(sizeof(jit_pool) / sizeof(jit_pool[0])))
+
+unsigned char *jit_buf = NULL;
+int jit_cap = 0;
+int jit_native[MAX_CODES];      // 每条指令对应的机器码偏移（相对所在那段机器码的开头）
+int jit_fix_at[MAX_CODES * 2], jit_fix_pc[MAX_CODES * 2], jit_nfix = 0;
+VSlot jit_vs[MAX_STACK];
+int jit_vtop = 0;
+char jit_reg_busy[16];
+
+// ---------------- 机器码发射 ----------------
+void jb(int b) {
+    if (jit_len >= jit_cap) {
+        jit_cap = jit_cap ? jit_cap * 2 : 4096;
+        jit_buf = (unsigned char *)realloc(jit_buf, jit_cap);
+        if (!jit_buf) {
+            printf("JIT内存不足\n");
+            exit(4);
+        }
+    }
+    jit_buf[jit_len++] = (unsigned char)b;
+}
+
+void jd(int d) {
+    for (int i = 0; i < 4; i++) jb((unsigned)d >> (8 * i));
+}
+
+void jq(unsigned long long q) {
+    for (int i = 0; i < 8; i++) jb((int)(q >> (8 * i)));
+}
+
+void j_patch32(int at, int v) {
+    for (int i = 0; i < 4; i++) jit_buf[at + i] = (unsigned char)((unsigned)v >> (8 * i));
+}
+
+// REX前缀：w=64位操作，reg/rm为8号以上寄存器时置R/B位
+void j_rex(int w, int reg, int rm) {
+    int rex = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0);
+    if (rex != 0x40) jb(rex);
+}
+
+void j_ops(const char *op, int oplen) {
+    for (int i = 0; i < oplen; i++) jb((unsigned char)op[i]);
+}
+
+// op reg, [base + disp32]
+void j_mem(int w, const char *op, int oplen, int reg, int base, int disp) {
+    j_rex(w, reg, base);
+    j_ops(op, oplen);
+    jb(0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == RSP) jb(0x24);            // r12/rsp作基址必须带SIB
+    jd(disp);
+}
+
+// op reg, rm（寄存器直接寻址）
+void j_rr(int w, const char *op, int oplen, int reg, int rm) {
+    j_rex(w, reg, rm);
+    j_ops(op, oplen);
+    jb(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void j_mov_imm(int r, int v) {
+    j_rex(0, 0, r);
+    jb(0xB8 + (r & 7));
+    jd(v);
+}
+
+// setcc al; movzx r, al
+void j_setcc(int cc, int r) {
+    jb(0x0F); jb(0x90 + cc); jb(0xC0);
+    j_rr(0, "\x0F\xB6", 2, r, RAX);
+}
+
+int local_disp(int slot) { return slot * (int)sizeof(Value); }
+int stack_disp(int i) { return i * (int)sizeof(Value); }
+
+// 整数写进值单元：mov [base + disp], r32; mov dword [base + disp + 4], 标记
+void j_store_int(int r, int base, int disp) {
+    j_mem(0, "\x89", 1, r, base, disp);
+    j_mem(0, "\xC7", 1, 0, base, disp + 4);
+    jd(VAL_INT_HI);
+}
+
+void j_store_imm(int v, int base, int disp) {
+    j_mem(0, "\xC7", 1, 0, base, disp);
+    jd(v);
+    j_mem(0, "\xC7", 1, 0, base, disp + 4);
+    jd(VAL_INT_HI);
+}
+
+// 整个值单元原样复制（经rax）
+void j_copy_value(int from_base, int from_disp, int to_base, int to_disp) {
+    j_mem(1, "\x8B", 1, RAX, from_base, from_disp);
+    j_mem(1, "\x89", 1, RAX, to_base, to_disp);
+}
+
+// 跳转到某条中间代码（或pc=-1表示出口），目标偏移最后统一回填
+void j_jump_fix(int pc) {
+    jit_fix_at[jit_nfix] = jit_len - 4;
+    jit_fix_pc[jit_nfix] = pc;
+    jit_nfix++;
+}
+
+void j_jmp(int pc) {
+    jb(0xE9); jd(0);
+    j_jump_fix(pc);
+}
+
+void j_jcc(int cc, int pc) {
+    jb(0x0F); jb(0x80 + cc); jd(0);
+    j_jump_fix(pc);
+}
+
+void j_call(void *fn) {
+    jb(0x48); jb(0xB8); jq((unsigned long long)(size_t)fn);    // mov rax, imm64
+    jb(0xFF); jb(0xD0);                                         // call rax
+}
+
+// ---------------- 运行时辅助函数 ----------------
+void jit_read(Value *dst, int pc) { vm_read(pc, dst); }
+void jit_write(int v) { vm_write(from_int(v)); }
+
+void jit_call(Value *s, int pc) { tier_call(s, pc); }
+
+Value *jit_enter(int n, int pc) {
+    fp = sp;
+    alloc_frame(pc, n);
+    return &mem[fp];
+}
+
+// ---------------- 虚拟操作数栈 ----------------
+int jit_alloc_reg() {
+    for (int k = 0; k < JIT_POOL_SIZE; k++) {
+        if (!jit_reg_busy[jit_pool[k]]) {
+            jit_reg_busy[jit_pool[k]] = 1;
+            return jit_pool[k];
+        }
+    }
+    // 寄存器用完：把最靠栈底的寄存器项写回操作数栈内存
+    // （池中有多个寄存器，最靠栈底的一项不会是正在参与运算的操作数）
+    for (int i = 0; i < jit_vtop; i++) {
+        if (jit_vs[i].kind == VS_REG) {
+            int r = jit_vs[i].val;
+            j_store_int(r, R13, stack_disp(i));
+            jit_vs[i].kind = VS_MEM;
+            return r;
+        }
+    }
+    return -1;      // 池中寄存器总在栈上，不会到这里
+}
+
+void jit_free_reg(int r) { jit_reg_busy[r] = 0; }
+
+// 把第i项装进寄存器（mov不影响标志位，可以在比较和BRF之间进行）
+int jit_to_reg(int i) {
+    VSlot *v = &jit_vs[i];
+    if (v->kind == VS_REG) return v->val;
+
+    int r = jit_alloc_reg();
+    switch (v->kind) {
+        case VS_CONST: j_mov_imm(r, v->val); break;
+        case VS_LOCAL: j_mem(0, "\x8B", 1, r, R12, local_disp(v->val)); break;
+        case VS_MEM:   j_mem(0, "\x8B", 1, r, R13, stack_disp(i)); break;
+        case VS_FLAGS: j_setcc(v->val, r); break;
+    }
+    v->kind = VS_REG;
+    v->val = r;
+    return r;
+}
+
+// 标志位里的比较结果在下一条会改写标志位的指令之前必须落地
+void jit_settle_flags() {
+    for (int i = 0; i < jit_vtop; i++) {
+        if (jit_vs[i].kind == VS_FLAGS) jit_to_reg(i);
+    }
+}
+
+// 基本块边界：所有项写回操作数栈内存
+void jit_flush() {
+    for (int i = 0; i < jit_vtop; i++) {
+        VSlot *v = &jit_vs[i];
+        switch (v->kind) {
+            case VS_CONST:
+                j_store_imm(v->val, R13, stack_disp(i));
+                break;
+            case VS_LOCAL:
+                j_copy_value(R12, local_disp(v->val), R13, stack_disp(i));
+                break;
+            case VS_FLAGS:
+                j_setcc(v->val, RAX);
+                j_store_int(RAX, R13, stack_disp(i));
+                break;
+            case VS_REG:
+                j_store_int(v->val, R13, stack_disp(i));
+                jit_free_reg(v->val);
+                break;
+        }
+        v->kind = VS_MEM;
+    }
+}
+
+void jit_reset_vs(int depth) {
+    memset(jit_reg_busy, 0, sizeof(jit_reg_busy));
+    jit_vtop = depth;
+    for (int i = 0; i < depth; i++) jit_vs[i].kind = VS_MEM;
+}
+
+void jit_push(int kind, int val) {
+    jit_vs[jit_vtop].kind = kind;
+    jit_vs[jit_vtop].val = val;
+    jit_vtop++;
+}
+
+// r op= b，b可以是立即数、帧内变量、操作数栈内存或寄存器
+// rm_op 为 "op r32, r/m32" 的操作码，ext 为 81 /ext 立即数形式的扩展码
+void jit_alu(const char *rm_op, int rm_len, int ext, int r, VSlot b, int b_index) {
+    switch (b.kind) {
+        case VS_CONST:
+            j_rr(0, "\x81", 1, ext, r);
+            jd(b.val);
+            break;
+        case VS_LOCAL: j_mem(0, rm_op, rm_len, r, R12, local_disp(b.val)); break;
+        case VS_MEM:   j_mem(0, rm_op, rm_len, r, R13, stack_disp(b_index)); break;
+        case VS_REG:   j_rr(0, rm_op, rm_len, r, b.val); break;
+    }
+}
+
+int jit_cmp_cc(int op) {
+    switch (op) {
+        case OP_GT:  return CC_G;
+        case OP_GE:  return CC_GE;
+        case OP_LES: return CC_L;
+        case OP_LE:  return CC_LE;
+        case OP_EQ:  return CC_E;
+        default:     return CC_NE;
+    }
+}
+
+// 两个常量的运算在翻译时折叠；除数为0留到运行时报错
+int jit_fold(int op, int a, int b, int *out) {
+    switch (op) {
+        case OP_ADD:   *out = (int)((unsigned)a + (unsigned)b); return 1;
+        case OP_SUB:   *out = (int)((unsigned)a - (unsigned)b); return 1;
+        case OP_MULT:  *out = (int)((unsigned)a * (unsigned)b); return 1;
+        case OP_DIV:
+            if (b == 0) return 0;
+            *out = b == -1 ? (int)(0u - (unsigned)a) : a / b;
+            return 1;
+        case OP_GT:    *out = a > b;  return 1;
+        case OP_GE:    *out = a >= b; return 1;
+        case OP_LES:   *out = a < b;  return 1;
+        case OP_LE:    *out = a <= b; return 1;
+        case OP_EQ:    *out = a == b; return 1;
+        case OP_NOTEQ: *out = a != b; return 1;
+        case OP_AND:   *out = a && b; return 1;
+        case OP_OR:    *out = a || b; return 1;
+    }
+    return 0;
+}
+
+void jit_binary(int op, int pc) {
+    VSlot a = jit_vs[jit_vtop - 2], b = jit_vs[jit_vtop - 1];
+    int folded, rb;
+
+    if (a.kind == VS_CONST && b.kind == VS_CONST && jit_fold(op, a.val, b.val, &folded)) {
+        jit_vtop -= 2;
+        jit_push(VS_CONST, folded);
+        return;
+    }
+
+    jit_settle_flags();
+
+    // 可交换运算把常量换到右边，以便使用立即数形式
+    if ((op == OP_ADD || op == OP_MULT) && jit_vs[jit_vtop - 2].kind == VS_CONST &&
+        jit_vs[jit_vtop - 1].kind != VS_CONST) {
+        VSlot t = jit_vs[jit_vtop - 2];
+        jit_vs[jit_vtop - 2] = jit_vs[jit_vtop - 1];
+        jit_vs[jit_vtop - 1] = t;
+    }
+
+    int ra = jit_to_reg(jit_vtop - 2);
+    b = jit_vs[jit_vtop - 1];
+
+    switch (op) {
+        case OP_ADD: jit_alu("\x03", 1, 0, ra, b, jit_vtop - 1); break;
+        case OP_SUB: jit_alu("\x2B", 1, 5, ra, b, jit_vtop - 1); break;
+        case OP_MULT:
+            if (b.kind == VS_CONST) {
+                j_rr(0, "\x69", 1, ra, ra);
+                jd(b.val);
+            } else {
+                jit_alu("\x0F\xAF", 2, 0, ra, b, jit_vtop - 1);
+            }
+            break;
+        case OP_DIV: {
+            rb = jit_to_reg(jit_vtop - 1);
+            j_rr(0, "\x85", 1, rb, rb);                 // test rb, rb
+            jb(0x75); jb(0);                            // jnz 跳过出错处理
+            int skip = jit_len;
+            jb(0xC7); jb(0x83); jd(0); jd(pc);          // mov [rbx+error_pc], pc
+            j_mov_imm(RAX, JIT_DIV_ZERO);
+            j_jmp(-1);
+            jit_buf[skip - 1] = (unsigned char)(jit_len - skip);
+            j_rr(0, "\x83", 1, 7, rb); jb(0xFF);         // cmp rb, -1
+            jb(0x75); jb(0);                            // jne 做除法
+            int not_m1 = jit_len;
+            j_rr(0, "\xF7", 1, 3, ra);                  // neg ra：INT_MIN / -1 回绕，不能让idiv出#DE
+            jb(0xEB); jb(0);                            // jmp 跳过除法
+            int done = jit_len;
+            jit_buf[not_m1 - 1] = (unsigned char)(jit_len - not_m1);
+            j_rr(0, "\x8B", 1, RAX, ra);                // mov eax, ra
+            jb(0x99);                                   // cdq
+            j_rr(0, "\xF7", 1, 7, rb);                  // idiv rb
+            j_rr(0, "\x8B", 1, ra, RAX);                // mov ra, eax
+            jit_buf[done - 1] = (unsigned char)(jit_len - done);
+            b.kind = VS_REG;
+            b.val = rb;
+            break;
+        }
+        case OP_AND:
+        case OP_OR:
+            rb = jit_to_reg(jit_vtop - 1);
+            j_rr(0, "\x85", 1, ra, ra);
+            jb(0x0F); jb(0x95); jb(0xC0);               // setne al
+            j_rr(0, "\x85", 1, rb, rb);
+            jb(0x0F); jb(0x95); jb(0xC2);               // setne dl
+            jb(op == OP_AND ? 0x20 : 0x08); jb(0xD0);   // and/or al, dl
+            j_rr(0, "\x0F\xB6", 2, ra, RAX);            // movzx ra, al
+            b.kind = VS_REG;
+            b.val = rb;
+            break;
+        default:    // 比较：结果留在标志位
+            jit_alu("\x3B", 1, 7, ra, b, jit_vtop - 1);
+            if (b.kind == VS_REG) jit_free_reg(b.val);
+            jit_free_reg(ra);
+            jit_vtop -= 2;
+            jit_push(VS_FLAGS, jit_cmp_cc(op));
+            return;
+    }
+
+    if (b.kind == VS_REG) jit_free_reg(b.val);
+    jit_vtop -= 2;
+    jit_push(VS_REG, ra);
+}
+
+void jit_store(int addr) {
+    VSlot v = jit_vs[jit_vtop - 1];
+    jit_vtop--;
+
+    // 栈里尚未读出的同一变量要先读出，否则会读到新值。它可能是浮点变量
+    // （LOAD/STO不分类型），所以整个单元复制到它在操作数栈上的位置
+    for (int i = 0; i < jit_vtop; i++) {
+        if (jit_vs[i].kind == VS_LOCAL && jit_vs[i].val == addr) {
+            j_copy_value(R12, local_disp(addr), R13, stack_disp(i));
+            jit_vs[i].kind = VS_MEM;
+        }
+    }
+
+    switch (v.kind) {
+        case VS_CONST:
+            j_store_imm(v.val, R12, local_disp(addr));
+            break;
+        case VS_LOCAL:
+            j_copy_value(R12, local_disp(v.val), R12, local_disp(addr));
+            break;
+        case VS_MEM:
+            j_copy_value(R13, stack_disp(jit_vtop), R12, local_disp(addr));
+            break;
+        case VS_FLAGS:
+            j_setcc(v.val, RAX);
+            j_store_int(RAX, R12, local_disp(addr));
+            break;
+        case VS_REG:
+            j_store_int(v.val, R12, local_disp(addr));
+            jit_free_reg(v.val);
+            break;
+    }
+}
+
+void jit_branch_false(int target) {
+    VSlot c = jit_vs[jit_vtop - 1];
+    jit_vtop--;
+    jit_flush();        // 只有mov，不影响标志位，也不动已弹出的条件寄存器
+
+    switch (c.kind) {
+        case VS_FLAGS:
+            j_jcc(c.val ^ 1, target);
+            break;
+        case VS_CONST:
+            if (!c.val) j_jmp(target);
+            break;
+        case VS_REG:
+            j_rr(0, "\x85", 1, c.val, c.val);
+            jit_free_reg(c.val);
+            j_jcc(CC_E, target);
+            break;
+        case VS_LOCAL:
+            j_mem(0, "\x83", 1, 7, R12, local_disp(c.val));
+            jb(0);
+            j_jcc(CC_E, target);
+            break;
+        case VS_MEM:
+            j_mem(0, "\x83", 1, 7, R13, stack_disp(jit_vtop));
+            jb(0);
+            j_jcc(CC_E, target);
+            break;
+    }
+}
+
+// 退回解释器：栈上各项写回内存，记下续点pc
+void jit_deopt(int pc) {
+    jit_flush();
+    jb(0xC7); jb(0x83); jd(4); jd(pc);          // mov [rbx+resume_pc], pc
+    j_mov_imm(RAX, JIT_DEOPT);
+    j_jmp(-1);
+}
+
+// 序言：保存被调用者保存寄存器，此后rsp按16字节对齐
+void jit_prologue() {
+    jb(0x53);                               // push rbx
+    jb(0x41); jb(0x54);                     // push r12
+    jb(0x41); jb(0x55);                     // push r13
+    j_rr(1, "\x89", 1, RDI, RBX);           // mov rbx, rdi
+    j_rr(1, "\x89", 1, RSI, R13);           // mov r13, rsi
+    j_rr(1, "\x89", 1, RDX, R12);           // mov r12, rdx
+}
+
+// ---------------- 翻译 ----------------
+// 翻译第from到to-1条指令，jit_native[]记下的偏移相对本段机器码的开头
+int jit_translate(int from, int to, JitUnit *u, const char **why) {
+    jit_len = 0;
+    jit_nfix = 0;
+    jit_prologue();
+
+    int fallthrough = 1;
+    jit_reset_vs(code_depth[from]);
+    for (int pc = from; pc < to; pc++) {
+        if (code_depth[pc] < 0) {            // 不可达
+            jit_native[pc] = jit_len;
+            fallthrough = 0;
+            continue;
+        }
+        if (!fallthrough) jit_reset_vs(code_depth[pc]);
+        else if (code_target[pc]) jit_flush();
+        jit_native[pc] = jit_len;
+        fallthrough = 1;
+
+        Instr *ins = &codes[pc];
+        switch (ins->op) {
+            case OP_LOADI: jit_push(VS_CONST, ins->operand); break;
+            case OP_LOAD:  jit_push(VS_LOCAL, ins->operand); break;
+            case OP_STO:   jit_store(ins->operand); break;
+
+            case OP_ADD: case OP_SUB: case OP_MULT: case OP_DIV:
+            case OP_GT: case OP_GE: case OP_LES: case OP_LE: case OP_EQ: case OP_NOTEQ:
+            case OP_AND: case OP_OR:
+                jit_binary(ins->op, pc);
+                break;
+
+            case OP_NOT: {
+                VSlot *v = &jit_vs[jit_vtop - 1];
+                if (v->kind == VS_FLAGS) {
+                    v->val ^= 1;
+                } else if (v->kind == VS_CONST) {
+                    v->val = !v->val;
+                } else {
+                    jit_settle_flags();
+                    int r = jit_to_reg(jit_vtop - 1);
+                    j_rr(0, "\x85", 1, r, r);
+                    jit_free_reg(r);
+                    v->kind = VS_FLAGS;
+                    v->val = CC_E;
+                }
+                break;
+            }
+
+            case OP_BR:
+                jit_flush();
+                j_jmp(ins->operand);
+                fallthrough = 0;
+                break;
+            case OP_BRF:
+                jit_branch_false(ins->operand);
+                break;
+
+            case OP_READ:
+                jit_flush();
+                j_mem(1, "\x8D", 1, RDI, R12, local_disp(ins->operand));   // lea rdi, [r12+disp]
+                j_mov_imm(RSI, pc);
+                j_call((void *)jit_read);
+                break;
+            case OP_WRITE:
+                jit_flush();
+                j_mem(0, "\x8B", 1, RDI, R12, local_disp(ins->operand));   // mov edi, [r12+disp]
+                j_call((void *)jit_write);
+                break;
+            case OP_ENTER:
+                jit_flush();
+                j_mov_imm(RDI, ins->operand);
+                j_mov_imm(RSI, pc);
+                j_call((void *)jit_enter);
+                j_rr(1, "\x89", 1, RAX, R12);   // mov r12, rax
+                break;
+            case OP_STOP:
+                j_mov_imm(RAX, JIT_OK);
+                j_jmp(-1);
+                fallthrough = 0;
+                break;
+
+            case OP_CALL:
+                jit_flush();
+                j_mem(1, "\x8D", 1, RDI, R13, stack_disp(code_depth[pc]));  // lea rdi, [r13+disp]
+                j_mov_imm(RSI, pc);
+                j_call((void *)jit_call);
+                jit_reset_vs(code_depth[pc + 1]);
+                break;
+            case OP_RET: case OP_TAILCALL:
+                jit_flush();
+                jb(0xC7); jb(0x83); jd(4); jd(pc);      // mov [rbx+resume_pc], pc
+                j_mov_imm(RAX, ins->op == OP_RET ? JIT_RET : JIT_TAILCALL);
+                j_jmp(-1);
+                fallthrough = 0;
+                break;
+
+            case OP_LOADF: case OP_ADDF: case OP_SUBF: case OP_MULTF: case OP_DIVF:
+            case OP_GTF: case OP_GEF: case OP_LESF: case OP_LEF: case OP_EQF: case OP_NOTEQF:
+            case OP_I2F: case OP_F2I: case OP_READF: case OP_WRITEF:
+                jit_deopt(pc);
+                fallthrough = 0;
+                break;
+        }
+    }
+
+    // 尾声
+    int epilogue = jit_len;
+    jb(0x41); jb(0x5D);                     // pop r13
+    jb(0x41); jb(0x5C);                     // pop r12
+    jb(0x5B);                               // pop rbx
+    jb(0xC3);                               // ret
+
+    // 栈上替换入口：序言相同，然后跳到第4个参数rcx给出的地址
+    int osr_entry = jit_len;
+    jit_prologue();
+    jb(0xFF); jb(0xE1);                     // jmp rcx
+
+    for (int k = 0; k < jit_nfix; k++) {
+        int dest = jit_fix_pc[k] < 0 ? epilogue : jit_native[jit_fix_pc[k]];
+        j_patch32(jit_fix_at[k], dest - (jit_fix_at[k] + 4));
+    }
+
+    // W^X：先写后改为只读可执行
+    u->size = (jit_len + 4095) & ~(size_t)4095;
+    u->code = mmap(NULL, u->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->code == MAP_FAILED) {
+        u->code = NULL;
+        *why = "mmap失败";
+        return 0;
+    }
+    memcpy(u->code, jit_buf, jit_len);
+    if (mprotect(u->code, u->size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(u->code, u->size);
+        u->code = NULL;
+        *why = "mprotect失败";
+        return 0;
+    }
+    u->len = jit_len;
+    u->fn = (JitFn)u->code;
+    u->osr = (JitOsrFn)((char *)u->code + osr_entry);
+    return 1;
+}
+
+void jit_free(JitUnit *u) {
+    if (u->code) munmap(u->code, u->size);
+    memset(u, 0, sizeof(*u));
+}
+
+// 第pc条指令的机器码地址，只有基本块入口可以作栈上替换的入口
+void *jit_entry_at(JitUnit *u, int pc) {
+    return (char *)u->code + jit_native[pc];
+}
+
+#else
+
+int jit_translate(int from, int to, JitUnit *u, const char **why) {
+    *why = "当前平台不支持JIT";
+    return 0;
+}
+
+void jit_free(JitUnit *u) {}
+void *jit_entry_at(JitUnit *u, int pc) { return NULL; }
+
+#endif
+
+// 整个程序翻译成一段机器码（不含函数调用）
+JitFn jit_compile(const char **why) {
+    jit_free(&jit_prog);
+    if (!analyze_codes(0, codesIndex, why, 1, 0)) return NULL;
+    return jit_translate(0, codesIndex, &jit_prog, why) ? jit_prog.fn : NULL;
+}
+
+
+// 退回解释器后由快速解释器执行到底
+void run_jit(JitFn fn) {
+    JitRuntime rt;
+    rt.error_pc = rt.resume_pc = -1;
+    int r = fn(&rt, stack, mem);
+    if (r == JIT_DIV_ZERO) runtime_error(rt.error_pc, "除数为0");
+    if (r == JIT_DEOPT) {
+        top = code_depth[rt.resume_pc];
+        run_fast_from(rt.resume_pc);
+    }
+}
+
+// ===========================================================
+// 分层执行：每个函数（main也算一个）先由快速解释器执行，按函数统计进入
+// 次数和函数里的循环回边次数，任一超过阈值就在后台线程单独JIT编译这个
+// 函数，解释器照常往下执行。编译线程写好机器码后以release语义发布该函数
+// 的状态，解释器以acquire语义读到TS_READY就换用机器码，全程不加锁也不等待：
+//   调用（CALL/TAILCALL）机器码已就绪的函数时直接执行机器码；
+//   正在执行的循环在下一个回边处栈上替换：帧内变量（insert_Symbol分配的
+//   地址）和操作数栈原地不动，机器码从回边目标（循环头）接着执行。
+//   所以只进入一次的main不必等下一次进入也能换上机器码。
+// 机器码里的CALL经jit_call回到这里，被调函数有机器码就执行机器码，否则
+// 解释执行到它返回。机器码和解释器互相调用时C栈跟着加深，嵌套超过
+// TIER_MAX_NESTING层后只解释执行，深递归不会耗尽C栈。
+// 机器码遇到浮点指令退回解释器，解释器在下一个回边处再进入机器码；
+// 一个函数退回次数超过TIER_MAX_DEOPTS就不再对它栈上替换，免得来回切换。
+// 编译线程同时只有一个，它忙时变热的函数先不管，下次进入或回边时再请求。
+// --tier=interp / --tier=jit 固定只用一层（jit在开始执行前编译全部函数），
+// 便于基准测试对比。
+// ===========================================================
+#define TIER_MAX_DEOPTS 64
+#define TIER_MAX_NESTING 200
+
+enum { TIER_AUTO, TIER_INTERP, TIER_JIT };
+enum { TS_COLD, TS_COMPILING, TS_READY, TS_FAILED };
+
+// 一个函数的分层状态，下标同sect_*
+typedef struct {
+    int state;                  // TS_*，编译线程写、解释器读
+    JitUnit unit;               // state为TS_READY后才可用
+    long long calls;            // 进入次数，main是执行的遍数
+    long long backedges;        // 循环回边次数
+    long long interp_runs, jit_runs;    // 进入时解释执行 / 执行机器码的次数
+    long long promoted_at;      // 第几次进入时开始用机器码，0为未升级
+    long long osr_entries;      // 在回边处进入机器码的次数
+    long long deopts;           // 机器码退回解释器的次数
+    int osr_first_pc;           // 第一次栈上替换进入的循环头
+    int osr_disabled;           // 退回太频繁，不再栈上替换
+    const char *trigger;        // 因进入次数还是循环回边触发编译
+    double compile_ms;
+    const char *why;            // 编译失败的原因
+} TierFunc;
+
+int tier_mode = TIER_AUTO;
+long long tier_call_threshold = TIER_CALL_THRESHOLD;
+TierFunc tier_funcs[MAX_FUNCS + 1];
+int tier_nesting = 0;           // tier_exec的嵌套层数
+int tier_busy = 0;              // 编译线程还没结束，编译线程写、解释器读
+TierFunc *tier_job = NULL;
+#if HAVE_JIT
+pthread_t tier_thread;
+int tier_thread_started = 0;
+#endif
+
+int tier_ready(TierFunc *t) {
+    return __atomic_load_n(&t->state, __ATOMIC_ACQUIRE) == TS_READY;
+}
+
+// 单独翻译一个函数。jit_native[]只写这个函数的区间
+void tier_compile(TierFunc *t) {
+    int f = t - tier_funcs, from = sect_entry[f];
+    int to = f + 1 < sectCount ? sect_entry[f + 1] : codesIndex;
+    const char *why = "";
+    double t0 = now_seconds();
+    int ok = analyze_codes(from, to, &why, 1, 1) && jit_translate(from, to, &t->unit, &why);
+    t->compile_ms = (now_seconds() - t0) * 1000;
+    t->why = why;
+    __atomic_store_n(&t->state, ok ? TS_READY : TS_FAILED, __ATOMIC_RELEASE);
+}
+
+#if HAVE_JIT
+void *tier_thread_main(void *) {
+    tier_compile(tier_job);
+    __atomic_store_n(&tier_busy, 0, __ATOMIC_RELEASE);
+    return NULL;
+}
+#endif
+
+// 等后台编译结束，之后才能卸载代码或重新编译
+void tier_finish() {
+#if HAVE_JIT
+    if (tier_thread_started) {
+        pthread_join(tier_thread, NULL);
+        tier_thread_started = 0;
+    }
+#endif
+}
+
+// 函数变热：还没编译过就交给后台线程，线程建不起来时当场编译。
+// 进入分层执行前代码已校验过，后台线程只读代码和校验结果，
+// 解释器同时读的这些数据在线程结束前都不会改变
+void tier_hot(TierFunc *t, const char *trigger) {
+    if (t->state != TS_COLD || __atomic_load_n(&tier_busy, __ATOMIC_ACQUIRE)) return;
+    tier_finish();          // 上一个编译线程已经结束，收回它
+    t->state = TS_COMPILING;
+    t->trigger = trigger;
+#if HAVE_JIT
+    tier_job = t;
+    tier_busy = 1;
+    if (pthread_create(&tier_thread, NULL, tier_thread_main, NULL) == 0) {
+        tier_thread_started = 1;
+        return;
+    }
+    tier_busy = 0;
+#endif
+    tier_compile(t);
+}
+
+void tier_reset() {
+    tier_finish();
+    for (int f = 0; f <= MAX_FUNCS; f++) jit_free(&tier_funcs[f].unit);
+    memset(tier_funcs, 0, sizeof(tier_funcs));
+    tier_nesting = 0;
+    tier_counting = 0;
+}
+
+// 进入函数entry时计数，返回1表示执行它的机器码
+int tier_enter_func(int entry) {
+    TierFunc *t = &tier_funcs[code_func[entry]];
+    t->calls++;
+    if (tier_mode == TIER_AUTO && t->calls >= tier_call_threshold && t->state == TS_COLD)
+        tier_hot(t, "进入次数");
+    if (tier_mode != TIER_INTERP && tier_nesting < TIER_MAX_NESTING && tier_ready(t)) {
+        if (!t->promoted_at) t->promoted_at = t->calls;
+        t->jit_runs++;
+        return 1;
+    }
+    t->interp_runs++;
+    return 0;
+}
+
+// 解释器执行第pc条BR跳回循环头时计数，返回1表示让出，从循环头进入机器码
+int tier_backedge(int pc) {
+    TierFunc *t = &tier_funcs[code_func[pc]];
+    if (++t->backedges >= tier_loop_threshold && tier_mode == TIER_AUTO && t->state == TS_COLD)
+        tier_hot(t, "循环回边");
+    return !t->osr_disabled && tier_nesting <= TIER_MAX_NESTING && tier_ready(t);
+}
+
+// 从第pc条指令接着执行到STOP，或RET使调用层数回到stop_depth。所在函数
+// 有机器码就执行机器码，否则解释执行，按机器码返回或解释器让出的原因切换。
+// 机器码的操作数栈基址按指令处的静态栈深度从top倒推
+void tier_exec(int pc, int stop_depth) {
+    int counting = tier_counting;
+    tier_nesting++;
+    while (1) {
+        TierFunc *t = &tier_funcs[code_func[pc]];
+        if (tier_mode != TIER_INTERP && tier_nesting <= TIER_MAX_NESTING && tier_ready(t)) {
+            JitRuntime rt;
+            int base = top - code_depth[pc];
+            rt.error_pc = rt.resume_pc = -1;
+            int r = t->unit.osr(&rt, stack + base, mem + fp, jit_entry_at(&t->unit, pc));
+            if (r == JIT_OK) break;
+            if (r == JIT_DIV_ZERO) runtime_error(rt.error_pc, "除数为0");
+            int at = rt.resume_pc;
+            if (r == JIT_RET) {
+                top = base + codes[at].operand;
+                sp = fp;
+                call_depth--;
+                fp = call_stack[call_depth].fp;
+                if (call_depth == stop_depth) break;
+                pc = call_stack[call_depth].ret_pc;
+                continue;
+            }
+            if (r == JIT_TAILCALL) {
+                top = base + code_depth[at];
+                sp = fp;
+                pc = codes[at].operand;
+                tier_enter_func(pc);
+                continue;
+            }
+            if (++t->deopts >= TIER_MAX_DEOPTS) t->osr_disabled = 1;      // JIT_DEOPT
+            pc = at;
+            top = base + code_depth[pc];
+        }
+        tier_counting = tier_mode != TIER_INTERP;
+        int yielded = run_fast_until(pc, stop_depth);
+        tier_counting = counting;
+        if (!yielded) break;
+        pc = osr_pc;
+        t = &tier_funcs[code_func[pc]];
+        if (pc != sect_entry[code_func[pc]] && !t->osr_entries++) t->osr_first_pc = pc;
+    }
+    tier_counting = counting;
+    tier_nesting--;
+}
+
+// 机器码里第pc条CALL，s为实参之上的栈顶：压调用栈，执行被调函数到返回，
+// 返回值留在栈顶
+void tier_call(Value *s, int pc) {
+    int entry = codes[pc].operand;
+    top = s - stack;
+    if (call_depth >= MAX_CALL_DEPTH || top + code_max_depth > MAX_STACK)
+        runtime_error(pc, "调用层数过多，栈溢出");
+    call_stack[call_depth].ret_pc = pc + 1;
+    call_stack[call_depth].fp = fp;
+    call_depth++;
+    tier_enter_func(entry);
+    tier_exec(entry, call_depth - 1);
+}
+
+// 分层执行一遍main：在解释器和各函数的机器码之间切换，直到执行到STOP
+void run_tiered() {
+    if (tier_mode == TIER_JIT) {
+        for (int f = 0; f < sectCount; f++) {
+            if (tier_funcs[f].state != TS_COLD) continue;
+            tier_funcs[f].state = TS_COMPILING;
+            tier_funcs[f].trigger = "强制JIT";
+            tier_compile(&tier_funcs[f]);
+        }
+    }
+    tier_enter_func(0);
+    tier_exec(0, -1);
+}
+
+// 各函数在回边处进入机器码的次数之和
+long long tier_osr_total() {
+    long long n = 0;
+    for (int f = 0; f < sectCount; f++) n += tier_funcs[f].osr_entries;
+    return n;
+}
+
+void print_tier_stats() {
+    static const char *modes[] = { "自动", "只解释", "只JIT" };
+    printf("分层执行（%s，阈值: 进入 %lld 次 / 循环回边 %lld 次）\n",
+           modes[tier_mode], tier_call_threshold, tier_loop_threshold);
+    for (int f = 0; f < sectCount; f++) {
+        TierFunc *t = &tier_funcs[f];
+        if (!t->calls) continue;
+        printf("  %s: 进入 %lld 次，循环回边 %lld 次，解释执行 %lld 次，JIT执行 %lld 次",
+               f ? sect_sig[f]->name : "main", t->calls, t->backedges, t->interp_runs, t->jit_runs);
+        if (t->promoted_at) printf("，第 %lld 次进入起换用机器码", t->promoted_at);
+        printf("\n");
+        if (t->osr_entries || t->deopts) {
+            printf("    栈上替换 %lld 次", t->osr_entries);
+            if (t->osr_entries) {
+                printf("（首次在循环头 %d", t->osr_first_pc);
+                print_src_pos(t->osr_first_pc);
+                printf("）");
+            }
+            printf("，退回解释器 %lld 次", t->deopts);
+            if (t->osr_disabled) printf("，退回太频繁已停用栈上替换");
+            printf("\n");
+        }
+        if (t->state == TS_READY)
+            printf("    JIT编译 %.3f 毫秒（%s触发），机器码 %d 字节\n", t->compile_ms, t->trigger, t->unit.len);
+        else if (t->state == TS_FAILED)
+            printf("    JIT编译失败（%s），一直解释执行\n", t->why);
+        else
+            printf("    未达到阈值，没有编译\n");
+    }
+}
+
+// ===========================================================
+// AOT：把中间代码翻译成C程序，再调用本机C编译器生成独立可执行文件
+// 帧内变量成为C局部变量 v0..vn，操作数栈的每个深度位置成为局部变量
+// s0..sn（各指令处的栈深度是静态的），跳转目标成为标号，
+// 寄存器分配交给C编译器。READ/WRITE由生成文件里的小运行时实现。
+// ===========================================================
+const char *aot_runtime_head =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <time.h>\n"
+    "\n"
+    "static int rt_bench = 0, rt_in[10000], rt_nin = 0, rt_pos = 0;\n"
+    "static volatile int rt_sink;\n"
+    "\n"
+    "static void rt_error(int pc, const char *msg) {\n"
+    "    printf(\"运行错误 [%d]: %s\\n\", pc, msg);\n"
+    "    exit(3);\n"
+    "}\n"
+    "\n"
+    "static int rt_read(int pc) {\n"
+    "    int v;\n"
+    "    if (rt_bench) {\n"
+    "        if (rt_pos >= rt_nin) rt_error(pc, \"回放输入不足\");\n"
+    "        return rt_in[rt_pos++];\n"
+    "    }\n"
+    "    printf(\"请输入: \");\n"
+    "    if (scanf(\"%d\", &v) != 1) rt_error(pc, \"输入不是整数\");\n"
+    "    return v;\n"
+    "}\n"
+    "\n"
+    "static void rt_write(int v) {\n"
+    "    if (rt_bench) rt_sink = v;\n"
+    "    else printf(\"%d\\n\", v);\n"
+    "}\n"
+    "\n";
+
+// --bench 次数：从标准输入读入全部输入后重复运行，只输出总用时（秒）
+const char *aot_runtime_main =
+    "\n"
+    "int main(int argc, char **argv) {\n"
+    "    if (argc == 3 && strcmp(argv[1], \"--bench\") == 0) {\n"
+    "        struct timespec t0, t1;\n"
+    "        int n = atoi(argv[2]);\n"
+    "        while (rt_nin < 10000 && scanf(\"%d\", &rt_in[rt_nin]) == 1) rt_nin++;\n"
+    "        rt_bench = 1;\n"
+    "        clock_gettime(CLOCK_MONOTONIC, &t0);\n"
+    "        for (int k = 0; k < n; k++) {\n"
+    "            rt_pos = 0;\n"
+    "            program();\n"
+    "        }\n"
+    "        clock_gettime(CLOCK_MONOTONIC, &t1);\n"
+    "        printf(\"%.6f\\n\", (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);\n"
+    "        return 0;\n"
+    "    }\n"
+    "    program();\n"
+    "    printf(\"程序运行结束\\n\");\n"
+    "    return 0;\n"
+    "}\n";
+
+const char *aot_binary_op(int op) {
+    switch (op) {
+        case OP_GT:    return ">";
+        case OP_GE:    return ">=";
+        case OP_LES:   return "<";
+        case OP_LE:    return "<=";
+        case OP_EQ:    return "==";
+        case OP_NOTEQ: return "!=";
+        case OP_AND:   return "&&";
+        default:       return "||";
+    }
+}
+
+int aot_emit_c(const char *src, const char *cfile, const char **why) {
+    if (!analyze_codes(0, codesIndex, why, 0, 0)) return 0;
+
+    FILE *out = fopen(cfile, "w");
+    if (!out) {
+        *why = "无法写C文件";
+        return 0;
+    }
+
+    fprintf(out, "/* 由 xunijiqi --aot 从 %s 生成 */\n", src);
+    fputs(aot_runtime_head, out);
+    fprintf(out, "static void program(void) {\n");
+    for (int i = 0; i < code_frame; i++) {
+        fprintf(out, "%s v%d = 0", i % 8 == 0 ? "    int" : ",", i);
+        if (i % 8 == 7 || i == code_frame - 1) fprintf(out, ";\n");
+    }
+    for (int i = 0; i < code_max_depth; i++) {
+        fprintf(out, "%s s%d = 0", i % 8 == 0 ? "    int" : ",", i);
+        if (i % 8 == 7 || i == code_max_depth - 1) fprintf(out, ";\n");
+    }
+    fprintf(out, "\n");
+
+    for (int pc = 0; pc < codesIndex; pc++) {
+        int d = code_depth[pc], x = codes[pc].operand;
+        if (d < 0) continue;                    // 不可达
+        if (code_target[pc]) fprintf(out, "L%d:\n", pc);
+
+        switch (codes[pc].op) {
+            case OP_LOAD:  fprintf(out, "    s%d = v%d;\n", d, x); break;
+            case OP_LOADI: fprintf(out, "    s%d = %d;\n", d, x); break;
+            case OP_STO:   fprintf(out, "    v%d = s%d;\n", x, d - 1); break;
+
+            // 按无符号运算，溢出时与虚拟机一样回绕
+            case OP_ADD:
+                fprintf(out, "    s%d = (int)((unsigned)s%d + (unsigned)s%d);\n", d - 2, d - 2, d - 1);
+                break;
+            case OP_SUB:
+                fprintf(out, "    s%d = (int)((unsigned)s%d - (unsigned)s%d);\n", d - 2, d - 2, d - 1);
+                break;
+            case OP_MULT:
+                fprintf(out, "    s%d = (int)((unsigned)s%d * (unsigned)s%d);\n", d - 2, d - 2, d - 1);
+                break;
+            case OP_DIV:
+                fprintf(out, "    if (s%d == 0) rt_error(%d, \"除数为0\");\n", d - 1, pc);
+                fprintf(out, "    s%d = s%d == -1 ? (int)(0u - (unsigned)s%d) : s%d / s%d;\n",
+                        d - 2, d - 1, d - 2, d - 2, d - 1);
+                break;
+            case OP_GT: case OP_GE: case OP_LES: case OP_LE: case OP_EQ: case OP_NOTEQ:
+            case OP_AND: case OP_OR:
+                fprintf(out, "    s%d = s%d %s s%d;\n", d - 2, d - 2, aot_binary_op(codes[pc].op), d - 1);
+                break;
+            case OP_NOT:   fprintf(out, "    s%d = !s%d;\n", d - 1, d - 1); break;
+
+            case OP_BR:    fprintf(out, "    goto L%d;\n", x); break;
+            case OP_BRF:   fprintf(out, "    if (!s%d) goto L%d;\n", d - 1, x); break;
+
+            case OP_READ:  fprintf(out, "    v%d = rt_read(%d);\n", x, pc); break;
+            case OP_WRITE: fprintf(out, "    rt_write(v%d);\n", x); break;
+            case OP_ENTER: fprintf(out, "    /* ENTER %d：帧变量即上面的局部变量 */\n", x); break;
+            case OP_STOP:  fprintf(out, "    return;\n"); break;
+        }
+    }
+    fprintf(out, "}\n");
+    fputs(aot_runtime_main, out);
+    fclose(out);
+    return 1;
+}
+
+// 用本机C编译器（环境变量CC，缺省为cc）编译生成的C文件
+int aot_build(const char *src, const char *exe, const char **why) {
+    char cfile[600], cmd[1400];
+    snprintf(cfile, sizeof(cfile), "%s.c", exe);
+    if (!aot_emit_c(src, cfile, why)) return 0;
+
+    const char *cc = getenv("CC");
+    if (!cc || !*cc) cc = "cc";
+    snprintf(cmd, sizeof(cmd), "%s -O2 -o '%s' '%s'", cc, exe, cfile);
+    if (system(cmd) != 0) {
+        *why = "C编译器执行失败";
+        return 0;
+    }
+    return 1;
+}
+
+// ===========================================================
+// 寄存器式虚拟机：把栈式代码改写成三地址寄存器代码再解释执行
+// 帧内变量直接作寄存器；操作数栈上的中间值先用虚拟寄存器表示，
+// 再按活跃区间线性扫描分配到帧尾的临时寄存器。常量折叠进立即数
+// 形式（ADDI等），"比较+BRF"合并成一条比较跳转（BLT等），结果
+// 紧接着STO的运算直接写目标变量，x = x + 1 只需一条 ADDI。
+// 要求每个基本块边界处操作数栈为空（本编译器生成的代码都满足），
+// 否则不改写，仍用栈式解释器。
+// ===========================================================
+enum RegOp {
+    R_MOV, R_MOVI,
+    R_ADD, R_SUB, R_MUL, R_DIV, R_ADDI, R_SUBI, R_MULI,
+    R_GT, R_GE, R_LT, R_LE, R_EQ, R_NE, R_AND, R_OR, R_NOT,
+    R_JMP, R_BRF,
+    R_BGT, R_BGE, R_BLT, R_BLE, R_BEQ, R_BNE,           // if (r[a] op r[b]) goto c
+    R_BGTI, R_BGEI, R_BLTI, R_BLEI, R_BEQI, R_BNEI,     // if (r[a] op b) goto c
+    R_READ, R_WRITE, R_ENTER, R_STOP,
+    R_COUNT
+};
+
+const char *reg_op_names[R_COUNT] = {
+    "MOV", "MOVI",
+    "ADD", "SUB", "MUL", "DIV", "ADDI", "SUBI", "MULI",
+    "GT", "GE", "LT", "LE", "EQ", "NE", "AND", "OR", "NOT",
+    "JMP", "BRF",
+    "BGT", "BGE", "BLT", "BLE", "BEQ", "BNE",
+    "BGTI", "BGEI", "BLTI", "BLEI", "BEQI", "BNEI",
+    "READ", "WRITE", "ENTER", "STOP"
+};
+
+// 各操作数的含义：d=目的寄存器 r=源寄存器 i=立即数 l=跳转目标 -=不用
+const char *reg_op_kinds[R_COUNT] = {
+    "dr-", "di-",
+    "drr", "drr", "drr", "drr", "dri", "dri", "dri",
+    "drr", "drr", "drr", "drr", "drr", "drr", "drr", "drr", "dr-",
+    "l--", "rl-",
+    "rrl", "rrl", "rrl", "rrl", "rrl", "rrl",
+    "ril", "ril", "ril", "ril", "ril", "ril",
+    "d--", "r--", "i--", "---"
+};
+
+typedef struct {
+    int op;
+    int a, b, c;
+    int pc;         // 对应的栈式代码序号，报运行错误用
+} RInstr;
+
+RInstr rcodes[MAX_CODES * 2];
+int rcodesIndex = 0;
+int reg_frame = 0;              // 帧变量 + 临时寄存器总数
+
+// 虚拟寄存器：编号为负数 -(t+1)，分配后换成帧尾的实际寄存器
+#define MAX_VREGS (MAX_CODES * 2)
+int vreg_start[MAX_VREGS], vreg_end[MAX_VREGS], vreg_phys[MAX_VREGS];
+int vreg_count = 0;
+
+// 改写时的符号操作数栈：常量或寄存器（帧变量/虚拟寄存器）
+typedef struct {
+    int is_const;
+    int val;
+} RSlot;
+
+RSlot rstk[MAX_STACK];
+int rtop = 0;
+int rcode_of[MAX_CODES];        // 栈式代码序号 → 寄存器代码序号
+
+int new_vreg() {
+    vreg_start[vreg_count] = rcodesIndex;
+    vreg_end[vreg_count] = rcodesIndex;
+    return -(++vreg_count);
+}
+
+void reg_use(int r) {
+    if (r < 0) vreg_end[-r - 1] = rcodesIndex;
+}
+
+int remit(int op, int a, int b, int c, int pc) {
+    const char *k = reg_op_kinds[op];
+    if (k[0] == 'r') reg_use(a);
+    if (k[1] == 'r') reg_use(b);
+    if (k[2] == 'r') reg_use(c);
+    rcodes[rcodesIndex].op = op;
+    rcodes[rcodesIndex].a = a;
+    rcodes[rcodesIndex].b = b;
+    rcodes[rcodesIndex].c = c;
+    rcodes[rcodesIndex].pc = pc;
+    return rcodesIndex++;
+}
+
+// 把栈项变成寄存器操作数，常量先装入虚拟寄存器
+int rslot_reg(RSlot v, int pc) {
+    if (!v.is_const) return v.val;
+    int t = new_vreg();
+    remit(R_MOVI, t, v.val, 0, pc);
+    return t;
+}
+
+// 写帧变量x之前，栈里还没用掉的x要先复制出来
+void reg_protect(int x, int pc) {
+    for (int i = 0; i < rtop; i++) {
+        if (!rstk[i].is_const && rstk[i].val == x) {
+            int t = new_vreg();
+            remit(R_MOV, t, x, 0, pc);
+            rstk[i].val = t;
+        }
+    }
+}
+
+int reg_cmp_op(int op) {
+    switch (op) {
+        case OP_GT:  return R_GT;
+        case OP_GE:  return R_GE;
+        case OP_LES: return R_LT;
+        case OP_LE:  return R_LE;
+        case OP_EQ:  return R_EQ;
+        default:     return R_NE;
+    }
+}
+
+// 比较取反、交换操作数后对应的比较
+int reg_cmp_negate(int r) {
+    switch (r) {
+        case R_GT: return R_LE;
+        case R_GE: return R_LT;
+        case R_LT: return R_GE;
+        case R_LE: return R_GT;
+        case R_EQ: return R_NE;
+        default:   return R_EQ;
+    }
+}
+
+int reg_cmp_swap(int r) {
+    switch (r) {
+        case R_GT: return R_LT;
+        case R_GE: return R_LE;
+        case R_LT: return R_GT;
+        case R_LE: return R_GE;
+        default:   return r;
+    }
+}
+
+int reg_cmp_eval(int r, int a, int b) {
+    switch (r) {
+        case R_GT: return a > b;
+        case R_GE: return a >= b;
+        case R_LT: return a < b;
+        case R_LE: return a <= b;
+        case R_EQ: return a == b;
+        default:   return a != b;
+    }
+}
+
+// 比较 + BRF：条件不成立时跳转，即按取反的条件跳转
+void reg_compare_branch(int cmp, int target, int pc) {
+    RSlot b = rstk[--rtop], a = rstk[--rtop];
+    int cond = reg_cmp_negate(reg_cmp_op(cmp));
+
+    if (a.is_const && b.is_const) {
+        if (reg_cmp_eval(cond, a.val, b.val)) remit(R_JMP, target, 0, 0, pc);
+        return;
+    }
+    if (a.is_const) {
+        RSlot t = a; a = b; b = t;
+        cond = reg_cmp_swap(cond);
+    }
+    if (b.is_const) remit(cond - R_GT + R_BGTI, a.val, b.val, target, pc);
+    else remit(cond - R_GT + R_BGT, a.val, b.val, target, pc);
+}
+
+void reg_binary(int op, int pc) {
+    RSlot b = rstk[--rtop], a = rstk[--rtop];
+    int r, t;
+
+    // 两个常量直接折叠（除法留到运行时，以便报除数为0）
+    if (a.is_const && b.is_const && op != OP_DIV) {
+        int v;
+        switch (op) {
+            case OP_ADD:  v = (int)((unsigned)a.val + (unsigned)b.val); break;
+            case OP_SUB:  v = (int)((unsigned)a.val - (unsigned)b.val); break;
+            case OP_MULT: v = (int)((unsigned)a.val * (unsigned)b.val); break;
+            case OP_AND:  v = a.val && b.val; break;
+            case OP_OR:   v = a.val || b.val; break;
+            default:      v = reg_cmp_eval(reg_cmp_op(op), a.val, b.val); break;
+        }
+        rstk[rtop].is_const = 1;
+        rstk[rtop++].val = v;
+        return;
+    }
+
+    if ((op == OP_ADD || op == OP_MULT) && a.is_const) {
+        RSlot tmp = a; a = b; b = tmp;
+    }
+
+    t = new_vreg();
+    if (b.is_const && (op == OP_ADD || op == OP_SUB || op == OP_MULT)) {
+        r = rslot_reg(a, pc);
+        remit(op == OP_ADD ? R_ADDI : op == OP_SUB ? R_SUBI : R_MULI, t, r, b.val, pc);
+    } else {
+        int ra = rslot_reg(a, pc), rb = rslot_reg(b, pc), rop;
+        switch (op) {
+            case OP_ADD:  rop = R_ADD; break;
+            case OP_SUB:  rop = R_SUB; break;
+            case OP_MULT: rop = R_MUL; break;
+            case OP_DIV:  rop = R_DIV; break;
+            case OP_AND:  rop = R_AND; break;
+            case OP_OR:   rop = R_OR; break;
+            default:      rop = reg_cmp_op(op); break;
+        }
+        remit(rop, t, ra, rb, pc);
+    }
+    rstk[rtop].is_const = 0;
+    rstk[rtop++].val = t;
+}
+
+void reg_store(int x, int pc) {
+    RSlot v = rstk[--rtop];
+    reg_protect(x, pc);
+
+    if (v.is_const) {
+        remit(R_MOVI, x, v.val, 0, pc);
+        return;
+    }
+    // 值刚由上一条指令算出：直接把那条指令的目的寄存器改成x
+    if (v.val < 0 && rcodesIndex > 0) {
+        RInstr *last = &rcodes[rcodesIndex - 1];
+        if (reg_op_kinds[last->op][0] == 'd' && last->a == v.val) {
+            last->a = x;
+            return;
+        }
+    }
+    remit(R_MOV, x, v.val, 0, pc);
+}
+
+// 线性扫描：按定义顺序处理虚拟寄存器，区间结束的寄存器归还空闲池
+int reg_allocate() {
+    static int free_list[MAX_VREGS], active[MAX_VREGS];
+    int nfree = 0, nactive = 0, used = 0;
+
+    for (int v = 0; v < vreg_count; v++) {
+        for (int k = 0; k < nactive; ) {
+            int w = active[k];
+            if (vreg_end[w] < vreg_start[v]) {
+                free_list[nfree++] = vreg_phys[w];
+                active[k] = active[--nactive];
+            } else {
+                k++;
+            }
+        }
+        vreg_phys[v] = nfree > 0 ? free_list[--nfree] : code_frame + used++;
+        active[nactive++] = v;
+    }
+    return used;
+}
+
+int reg_lower(const char **why) {
+    if (!analyze_codes(0, codesIndex, why, 0, 0)) return 0;
+
+    rcodesIndex = 0;
+    vreg_count = 0;
+    rtop = 0;
+
+    for (int pc = 0; pc < codesIndex; pc++) {
+        rcode_of[pc] = rcodesIndex;
+        if (code_depth[pc] < 0) continue;
+        if (code_target[pc] && code_depth[pc] != 0) {
+            *why = "基本块入口处操作数栈非空";
+            return 0;
+        }
+        if (code_target[pc] || rtop != code_depth[pc]) rtop = code_depth[pc];
+
+        int x = codes[pc].operand, op = codes[pc].op;
+        switch (op) {
+            case OP_LOADI:
+                rstk[rtop].is_const = 1;
+                rstk[rtop++].val = x;
+                break;
+            case OP_LOAD:
+                rstk[rtop].is_const = 0;
+                rstk[rtop++].val = x;
+                break;
+            case OP_STO:
+                reg_store(x, pc);
+                break;
+
+            case OP_GT: case OP_GE: case OP_LES: case OP_LE: case OP_EQ: case OP_NOTEQ:
+                if (pc + 1 < codesIndex && codes[pc + 1].op == OP_BRF && !code_target[pc + 1]) {
+                    if (rtop != 2) {
+                        *why = "跳转处操作数栈非空";
+                        return 0;
+                    }
+                    reg_compare_branch(op, codes[pc + 1].operand, pc);
+                    rcode_of[++pc] = rcodesIndex;
+                    break;
+                }
+                reg_binary(op, pc);
+                break;
+            case OP_ADD: case OP_SUB: case OP_MULT: case OP_DIV: case OP_AND: case OP_OR:
+                reg_binary(op, pc);
+                break;
+            case OP_NOT: {
+                RSlot v = rstk[--rtop];
+                if (v.is_const) {
+                    v.val = !v.val;
+                } else {
+                    int t = new_vreg();
+                    remit(R_NOT, t, v.val, 0, pc);
+                    v.val = t;
+                }
+                rstk[rtop++] = v;
+                break;
+            }
+
+            case OP_BR:
+                if (rtop != 0) { *why = "跳转处操作数栈非空"; return 0; }
+                remit(R_JMP, x, 0, 0, pc);
+                break;
+            case OP_BRF: {
+                RSlot v = rstk[--rtop];
+                if (rtop != 0) { *why = "跳转处操作数栈非空"; return 0; }
+                if (v.is_const) {
+                    if (!v.val) remit(R_JMP, x, 0, 0, pc);
+                } else {
+                    remit(R_BRF, v.val, x, 0, pc);
+                }
+                break;
+            }
+
+            case OP_READ:
+                reg_protect(x, pc);
+                remit(R_READ, x, 0, 0, pc);
+                break;
+            case OP_WRITE:
+                remit(R_WRITE, x, 0, 0, pc);
+                break;
+            case OP_ENTER:
+                remit(R_ENTER, x, 0, 0, pc);
+                break;
+            case OP_STOP:
+                remit(R_STOP, 0, 0, 0, pc);
+                break;
+        }
+    }
+
+    // 跳转目标换成寄存器代码序号，虚拟寄存器换成实际寄存器
+    reg_frame = code_frame + reg_allocate();
+    for (int i = 0; i < rcodesIndex; i++) {
+        RInstr *ri = &rcodes[i];
+        const char *k = reg_op_kinds[ri->op];
+        int *f[3] = { &ri->a, &ri->b, &ri->c };
+        for (int j = 0; j < 3; j++) {
+            if (k[j] == 'l') *f[j] = rcode_of[*f[j]];
+            else if ((k[j] == 'd' || k[j] == 'r') && *f[j] < 0) *f[j] = vreg_phys[-*f[j] - 1];
+        }
+        if (ri->op == R_ENTER) ri->a = reg_frame;
+    }
+    return 1;
+}
+
+void print_reg_codes() {
+    printf("\n=== 寄存器代码（帧 %d 个寄存器，其中临时 %d 个）===\n", reg_frame, reg_frame - code_frame);
+    for (int i = 0; i < rcodesIndex; i++) {
+        RInstr *ri = &rcodes[i];
+        const char *k = reg_op_kinds[ri->op];
+        int f[3] = { ri->a, ri->b, ri->c };
+        printf("%-6d %-6s", i, reg_op_names[ri->op]);
+        for (int j = 0; j < 3 && k[j] != '-'; j++) {
+            if (k[j] == 'i') printf("%s%d", j ? ", " : " ", f[j]);
+            else if (k[j] == 'l') printf("%sL%d", j ? ", " : " ", f[j]);
+            else printf("%sr%d", j ? ", " : " ", f[j]);
+        }
+        printf("\n");
+    }
+}
+
+// 寄存器代码已在改写时检查过操作数范围，执行时不再逐条检查。
+// 寄存器就是帧内的值单元，只有整数指令，按整数取值、写回时带标记
+#define RV(x) as_int(r[x])
+#define RSET(v) r[ins->a] = from_int(v)
+
+void run_reg() {
+    int pc = 0;
+    Value *r = NULL;
+
+    while (1) {
+        RInstr *ins = &rcodes[pc++];
+        exec_count++;
+
+        switch (ins->op) {
+            case R_MOV:  r[ins->a] = r[ins->b]; break;
+            case R_MOVI: RSET(ins->b); break;
+
+            case R_ADD:  RSET((unsigned)RV(ins->b) + (unsigned)RV(ins->c)); break;
+            case R_SUB:  RSET((unsigned)RV(ins->b) - (unsigned)RV(ins->c)); break;
+            case R_MUL:  RSET((unsigned)RV(ins->b) * (unsigned)RV(ins->c)); break;
+            case R_DIV:
+                if (RV(ins->c) == 0) runtime_error(ins->pc, "除数为0");
+                RSET(RV(ins->c) == -1 ? (int)(0u - (unsigned)RV(ins->b)) : RV(ins->b) / RV(ins->c));
+                break;
+            case R_ADDI: RSET((unsigned)RV(ins->b) + (unsigned)ins->c); break;
+            case R_SUBI: RSET((unsigned)RV(ins->b) - (unsigned)ins->c); break;
+            case R_MULI: RSET((unsigned)RV(ins->b) * (unsigned)ins->c); break;
+
+            case R_GT:   RSET(RV(ins->b) > RV(ins->c)); break;
+            case R_GE:   RSET(RV(ins->b) >= RV(ins->c)); break;
+            case R_LT:   RSET(RV(ins->b) < RV(ins->c)); break;
+            case R_LE:   RSET(RV(ins->b) <= RV(ins->c)); break;
+            case R_EQ:   RSET(RV(ins->b) == RV(ins->c)); break;
+            case R_NE:   RSET(RV(ins->b) != RV(ins->c)); break;
+            case R_AND:  RSET(RV(ins->b) && RV(ins->c)); break;
+            case R_OR:   RSET(RV(ins->b) || RV(ins->c)); break;
+            case R_NOT:  RSET(!RV(ins->b)); break;
+
+            case R_JMP:  pc = ins->a; break;
+            case R_BRF:  if (!RV(ins->a)) pc = ins->b; break;
+            case R_BGT:  if (RV(ins->a) > RV(ins->b)) pc = ins->c; break;
+            case R_BGE:  if (RV(ins->a) >= RV(ins->b)) pc = ins->c; break;
+            case R_BLT:  if (RV(ins->a) < RV(ins->b)) pc = ins->c; break;
+            case R_BLE:  if (RV(ins->a) <= RV(ins->b)) pc = ins->c; break;
+            case R_BEQ:  if (RV(ins->a) == RV(ins->b)) pc = ins->c; break;
+            case R_BNE:  if (RV(ins->a) != RV(ins->b)) pc = ins->c; break;
+            case R_BGTI: if (RV(ins->a) > ins->b) pc = ins->c; break;
+            case R_BGEI: if (RV(ins->a) >= ins->b) pc = ins->c; break;
+            case R_BLTI: if (RV(ins->a) < ins->b) pc = ins->c; break;
+            case R_BLEI: if (RV(ins->a) <= ins->b) pc = ins->c; break;
+            case R_BEQI: if (RV(ins->a) == ins->b) pc = ins->c; break;
+            case R_BNEI: if (RV(ins->a) != ins->b) pc = ins->c; break;
+
+            case R_READ:  vm_read(ins->pc, &r[ins->a]); break;
+            case R_WRITE: vm_write(r[ins->a]); break;
+            case R_ENTER:
+                fp = sp;
+                alloc_frame(ins->pc, ins->a);
+                r = &mem[fp];
+                break;
+            case R_STOP:
+                return;
+        }
+    }
+}
+
+// ===========================================================
+// 对比测试：同一程序先逐条检查解释执行（记录输入），再分别用快速
+// 解释器、JIT和寄存器虚拟机回放输入执行，比较输出序列、出错位置和
+// 结束时的变量存储区（寄存器虚拟机帧尾的临时寄存器不参与比较）
+// ===========================================================
+Value interp_out[MAX_IO], interp_mem[MAX_MEM];
+int interp_err, interp_nout;
+
+// 两个值单元是否表示同一个值：清零的单元（未赋值的变量）读作整数0，
+// 解释器原样复制它，JIT和寄存器虚拟机算过之后写回的是带标记的整数0
+int same_value(Value a, Value b) {
+    if (a == b) return 1;
+    return (a == 0 || a == from_int(0)) && (b == 0 || b == from_int(0));
+}
+
+int same_as_interp(int skip_from, int skip_to) {
+    int n = interp_nout < MAX_IO ? interp_nout : MAX_IO;
+    if (interp_err != error_pc || interp_nout != out_count ||
+        memcmp(interp_out, out_buf, n * sizeof(Value)) != 0) return 0;
+    for (int i = 0; i < MAX_MEM; i++) {
+        if ((i < skip_from || i >= skip_to) && !same_value(interp_mem[i], mem[i])) return 0;
+    }
+    return 1;
+}
+
+int check_one(const char *file) {
+    static jmp_buf guard;
+    const char *why = "";
+    volatile int failed = 0;        // longjmp回来后还要读，不能只放在寄存器里
+
+    if (load_codes(file)) return 1;
+
+    vm_reset();
+    io_record = 1; io_replay = 0; io_quiet = 1;
+    in_count = 0;
+    error_guard = &guard;
+    if (setjmp(guard) == 0) run();
+    interp_err = error_pc;
+    interp_nout = out_count;
+    memcpy(interp_out, out_buf, sizeof(out_buf));
+    memcpy(interp_mem, mem, sizeof(mem));
+    io_record = 0; io_replay = 1;
+
+    if (verify_codes()) {
+        vm_reset();
+        if (setjmp(guard) == 0) run_fast();
+        int same = same_as_interp(MAX_MEM, MAX_MEM);
+        printf("%-40s 快速 %s（输出%d个）\n", file, same ? "一致" : "不一致", interp_nout);
+        failed += !same;
+
+        // 分层执行先编译全部函数，逐个函数的机器码和它们之间的调用都要走到
+        tier_reset();
+        tier_mode = TIER_JIT;
+        vm_reset();
+        if (setjmp(guard) == 0) run_tiered();
+        tier_finish();
+        tier_mode = TIER_AUTO;
+        same = same_as_interp(MAX_MEM, MAX_MEM);
+        printf("%-40s 分层 %s（输出%d个）\n", file, same ? "一致" : "不一致", interp_nout);
+        failed += !same;
+    } else {
+        printf("%-40s 快速 跳过（%s）\n", file, verify_msg);
+    }
+
+    JitFn fn = jit_compile(&why);
+    if (fn) {
+        vm_reset();
+        if (setjmp(guard) == 0) run_jit(fn);
+        int same = same_as_interp(MAX_MEM, MAX_MEM);
+        printf("%-40s JIT  %s（输出%d个）\n", file, same ? "一致" : "不一致", interp_nout);
+        failed += !same;
+    } else {
+        printf("%-40s JIT  跳过（%s）\n", file, why);
+    }
+
+    if (reg_lower(&why)) {
+        vm_reset();
+        if (setjmp(guard) == 0) run_reg();
+        int same = same_as_interp(code_frame, reg_frame);
+        printf("%-40s 寄存器 %s（输出%d个）\n", file, same ? "一致" : "不一致", interp_nout);
+        failed += !same;
+    } else {
+        printf("%-40s 寄存器 跳过（%s）\n", file, why);
+    }
+
+    error_guard = NULL;
+    io_replay = 0; io_quiet = 0;
+    return failed ? 1 : 0;
+}
+
+// ===========================================================
+// 基准测试：同一程序分别解释执行、寄存器虚拟机、JIT执行若干遍，比较用时
+// ===========================================================
+// AOT可执行文件以 --bench 方式运行，输入从文件回放，读回它报告的用时
+double bench_aot(const char *file, int times, const char **why) {
+    char exe[600], infile[600], cmd[1400];
+    double t = -1;
+
+    snprintf(exe, sizeof(exe), "%s.out", file);
+    snprintf(infile, sizeof(infile), "%s.in", file);
+    if (!aot_build(file, exe, why)) return -1;
+
+    FILE *in = fopen(infile, "w");
+    if (!in) {
+        *why = "无法写输入文件";
+        return -1;
+    }
+    for (int i = 0; i < in_count; i++) fprintf(in, "%d\n", as_int(in_buf[i]));
+    fclose(in);
+
+    snprintf(cmd, sizeof(cmd), "'%s%s' --bench %d < '%s'",
+             strchr(exe, '/') ? "" : "./", exe, times, infile);
+    FILE *p = popen(cmd, "r");
+    if (!p || fscanf(p, "%lf", &t) != 1) *why = "AOT程序运行失败";
+    if (p) pclose(p);
+    remove(infile);
+    return t;
+}
+
+#define BENCH_ROUNDS 3
+
+// 快速解释执行times遍的用时，输入按记录回放；校验未通过返回-1
+double time_fast(int times) {
+    if (!verify_codes()) {
+        printf("校验未通过：%s\n", verify_msg);
+        return -1;
+    }
+    double t0 = now_seconds();
+    for (int k = 0; k < times; k++) {
+        vm_reset();
+        run_fast();
+    }
+    return now_seconds() - t0;
+}
+
+int bench(const char *file, int times, const char *baseline) {
+    const char *why = "";
+
+    if (load_codes(file)) return 1;
+
+    // 第一遍正常运行，记录输入供后面回放
+    vm_reset();
+    in_count = 0;
+    io_record = 1;
+    run();
+    io_record = 0;
+    long long per_run = exec_count;
+
+    io_replay = 1; io_quiet = 1;
+    double t0 = now_seconds();
+    for (int k = 0; k < times; k++) {
+        vm_reset();
+        run();
+    }
+    double t_interp = now_seconds() - t0;
+
+    double t_fast = time_fast(times);
+
+    double t_jit = -1;
+    JitFn fn = jit_compile(&why);
+    if (fn) {
+        t0 = now_seconds();
+        for (int k = 0; k < times; k++) {
+            vm_reset();
+            run_jit(fn);
+        }
+        t_jit = now_seconds() - t0;
+    } else {
+        printf("JIT不可用：%s\n", why);
+    }
+
+    // 分层执行：前几遍解释，变热后换成后台编译好的机器码
+    tier_reset();
+    tier_mode = TIER_AUTO;
+    t0 = now_seconds();
+    for (int k = 0; k < times; k++) {
+        vm_reset();
+        run_tiered();
+    }
+    double t_tier = now_seconds() - t0;
+    tier_finish();
+
+    double t_reg = -1;
+    long long reg_per_run = 0;
+    if (reg_lower(&why)) {
+        t0 = now_seconds();
+        for (int k = 0; k < times; k++) {
+            vm_reset();
+            run_reg();
+        }
+        t_reg = now_seconds() - t0;
+        reg_per_run = exec_count;
+    } else {
+        printf("寄存器虚拟机不可用：%s\n", why);
+    }
+    io_replay = 0; io_quiet = 0;
+
+    double t_aot = bench_aot(file, times, &why);
+    if (t_aot < 0) printf("AOT不可用：%s\n", why);
+
+    printf("\n每遍 %lld 条指令\n", per_run);
+    printf("解释执行 %d 遍: %.3f 秒\n", times, t_interp);
+    if (t_fast >= 0) {
+        printf("快速解释 %d 遍: %.3f 秒（校验后免检查）", times, t_fast);
+        if (t_fast > 0) printf("，加速比 %.1f 倍", t_interp / t_fast);
+        printf("\n");
+    }
+    if (t_reg >= 0) {
+        printf("寄存器   %d 遍: %.3f 秒（每遍 %lld 条指令，分派减少 %.1f%%）", times, t_reg,
+               reg_per_run, per_run ? 100.0 * (per_run - reg_per_run) / per_run : 0.0);
+        if (t_reg > 0) printf("，加速比 %.1f 倍", t_interp / t_reg);
+        printf("\n");
+    }
+    if (t_jit >= 0) {
+        printf("JIT执行  %d 遍: %.3f 秒（机器码 %d 字节）", times, t_jit, jit_prog.len);
+        if (t_jit > 0) printf("，加速比 %.1f 倍", t_interp / t_jit);
+        printf("\n");
+    }
+    printf("分层执行 %d 遍: %.3f 秒（解释 %lld 遍，JIT %lld 遍，栈上替换 %lld 次）",
+           times, t_tier, tier_funcs[0].interp_runs, tier_funcs[0].jit_runs, tier_osr_total());
+    if (t_tier > 0) printf("，加速比 %.1f 倍", t_interp / t_tier);
+    printf("\n");
+    if (t_aot >= 0) {
+        printf("AOT执行  %d 遍: %.3f 秒", times, t_aot);
+        if (t_aot > 0) printf("，加速比 %.1f 倍", t_interp / t_aot);
+        printf("\n");
+    }
+    if (!baseline) return 0;
+
+    // 对照程序用同样的输入，比较指令数和快速解释的用时。两个程序
+    // 交替测几轮各取最短，减少先后次序和机器负载的影响
+    if (load_codes(baseline)) return 1;
+    io_replay = 1; io_quiet = 1;
+    vm_reset();
+    run();
+    long long base_per_run = exec_count;
+    double t_base = -1;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        if (load_codes(baseline)) return 1;
+        double t = time_fast(times);
+        if (t >= 0 && (t_base < 0 || t < t_base)) t_base = t;
+        if (load_codes(file)) return 1;
+        t = time_fast(times);
+        if (t >= 0 && t < t_fast) t_fast = t;
+    }
+    io_replay = 0; io_quiet = 0;
+    printf("\n对照 %s: 每遍 %lld 条指令", baseline, base_per_run);
+    if (t_base >= 0) printf("，快速解释 %d 遍: %.3f 秒", times, t_base);
+    printf("\n");
+    if (base_per_run > 0)
+        printf("指令数减少 %.1f%%", 100.0 * (base_per_run - per_run) / base_per_run);
+    if (t_fast > 0 && t_base > 0) printf("，快速解释加速比 %.2f 倍", t_base / t_fast);
+    printf("\n");
+    return 0;
+}
+
+// ===========================================================
+// 性能剖析的准备和输出
+// ===========================================================
+// 按程序入口和CALL/TAILCALL目标划分函数，清零计数
+void profile_setup() {
+    prof_funcs = 0;
+    prof_entry[prof_funcs++] = 0;
+    for (int i = 0; i < codesIndex; i++) {
+        int t = codes[i].operand, j;
+        if ((codes[i].op != OP_CALL && codes[i].op != OP_TAILCALL) || t <= 0 || t >= codesIndex) continue;
+        for (j = 0; j < prof_funcs && prof_entry[j] != t; j++) {}
+        if (j < prof_funcs || prof_funcs >= MAX_PROF_FUNCS) continue;
+        for (j = prof_funcs++; j > 0 && prof_entry[j - 1] > t; j--) prof_entry[j] = prof_entry[j - 1];
+        prof_entry[j] = t;
+    }
+    for (int i = 0, f = 0; i < codesIndex; i++) {
+        while (f + 1 < prof_funcs && prof_entry[f + 1] <= i) f++;
+        prof_func[i] = f;
+        prof_line[i] = line_of(i);
+    }
+    prof_nodes = 1;             // 结点0是main
+    prof_node = 0;
+    prof_parent[0] = -1;
+    prof_node_func[0] = 0;
+    prof_first[0] = -1;
+    for (int h = 0; h < PROF_CELLS; h++) prof_cells[h].node = -1;
+    prof_ncells = 0;
+    prof_dropped = 0;
+    memset(prof_hits, 0, sizeof(prof_hits));
+    memset(prof_taken, 0, sizeof(prof_taken));
+    memset(prof_time, 0, sizeof(prof_time));
+    prof_cur = 0;
+    prof_mark = now_seconds();
+}
+
+// 函数名：程序入口是main，其余取函数表中入口相同的函数
+const char *prof_func_name(int f, char *buf, size_t n) {
+    if (prof_entry[f] == 0) return "main";
+    const FuncSig *g = func_at(prof_entry[f]);
+    if (g) return g->name;
+    snprintf(buf, n, "func_%d", prof_entry[f]);
+    return buf;
+}
+
+// 折叠栈按结点（即调用链首次出现的顺序）、再按行排列
+int prof_cell_cmp(const void *a, const void *b) {
+    const ProfCell *x = (const ProfCell *)a, *y = (const ProfCell *)b;
+    if (x->node != y->node) return x->node - y->node;
+    return x->line - y->line;
+}
+
+int profile(const char *file, const char *prefix) {
+    jmp_buf guard;
+    char path[600], name[32];
+
+    if (load_codes(file)) return 1;
+
+    vm_reset();
+    profile_setup();
+    profiling = 1;
+    error_guard = &guard;
+    if (setjmp(guard) == 0) run();
+    error_guard = NULL;
+    profiling = 0;
+    prof_time[prof_cur] += now_seconds() - prof_mark;
+    if (error_pc >= 0) printf("第%d条指令处发生运行错误，剖析结果截至出错处\n", error_pc);
+
+    // 按 (函数, 行) 汇总
+    int max_line = 0;
+    for (int i = 0; i < lineCount; i++)
+        if ((int)line_table[i].line > max_line) max_line = line_table[i].line;
+    long long total = 0;
+    long long *by_line = (long long *)calloc((size_t)(max_line + 1) * prof_funcs, sizeof(long long));
+    long long func_hits[MAX_PROF_FUNCS] = { 0 };
+    if (!by_line) {
+        printf("内存不足\n");
+        return 2;
+    }
+    for (int i = 0; i < codesIndex; i++) {
+        total += prof_hits[i];
+        func_hits[prof_func[i]] += prof_hits[i];
+        by_line[prof_func[i] * (max_line + 1) + line_of(i)] += prof_hits[i];
+    }
+
+    // 折叠栈：每行 "main;调用者;...;函数;L行 次数"，可直接交给 flamegraph.pl
+    snprintf(path, sizeof(path), "%s.folded", prefix);
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        printf("无法写入 %s\n", path);
+        free(by_line);
+        return 2;
+    }
+    ProfCell *cells = (ProfCell *)malloc(sizeof(ProfCell) * (prof_ncells + 1));
+    int ncells = 0;
+    for (int h = 0; h < PROF_CELLS && cells; h++) {
+        if (prof_cells[h].node >= 0) cells[ncells++] = prof_cells[h];
+    }
+    if (cells) qsort(cells, ncells, sizeof(ProfCell), prof_cell_cmp);
+    for (int k = 0; k < ncells; k++) {
+        int chain[MAX_PROF_NODES], depth = 0;
+        for (int nd = cells[k].node; nd >= 0; nd = prof_parent[nd]) chain[depth++] = nd;
+        while (depth > 0) {
+            fprintf(out, "%s;", prof_func_name(prof_node_func[chain[--depth]], name, sizeof(name)));
+        }
+        fprintf(out, "L%d %lld\n", cells[k].line, cells[k].count);
+    }
+    free(cells);
+    fclose(out);
+    printf("折叠栈已输出到 %s\n", path);
+    if (prof_dropped) printf("调用上下文太多，%lld 条指令没有计入折叠栈\n", prof_dropped);
+
+    // 带计数的代码表，BRF另附 跳转/不跳转 次数
+    snprintf(path, sizeof(path), "%s.prof.txt", prefix);
+    out = fopen(path, "w");
+    if (!out) {
+        printf("无法写入 %s\n", path);
+        free(by_line);
+        return 2;
+    }
+    fprintf(out, "性能剖析: %s\n共执行 %lld 条指令\n\n", file, total);
+    fprintf(out, "%-10s %-6s %-12s %-8s %s\n", "函数", "入口", "次数", "占比", "用时(毫秒)");
+    for (int f = 0; f < prof_funcs; f++) {
+        fprintf(out, "%-10s %-6d %-12lld %6.2f%%  %.3f\n", prof_func_name(f, name, sizeof(name)), prof_entry[f],
+                func_hits[f], total ? 100.0 * func_hits[f] / total : 0.0, prof_time[f] * 1000);
+    }
+    fprintf(out, "\n%-6s %-10s %-10s %-6s %-12s %-8s %s\n", "序号", "操作码", "操作数", "行", "次数", "占比", "跳转/不跳转");
+    fprintf(out, "--------------------------------------------------------------------\n");
+    for (int i = 0; i < codesIndex; i++) {
+        fprintf(out, "%-6d %-10s %-10d %-6d %-12lld %6.2f%%", i, op_names[codes[i].op], codes[i].operand,
+                line_of(i), prof_hits[i], total ? 100.0 * prof_hits[i] / total : 0.0);
+        if (codes[i].op == OP_BRF && prof_hits[i] > 0)
+            fprintf(out, "  %lld/%lld（跳转 %.1f%%）", prof_taken[i], prof_hits[i] - prof_taken[i],
+                    100.0 * prof_taken[i] / prof_hits[i]);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "\n按源程序行汇总:\n%-6s %-12s %s\n", "行", "次数", "占比");
+    for (int l = 0; l <= max_line; l++) {
+        long long n = 0;
+        for (int f = 0; f < prof_funcs; f++) n += by_line[f * (max_line + 1) + l];
+        if (n > 0) fprintf(out, "%-6d %-12lld %6.2f%%\n", l, n, total ? 100.0 * n / total : 0.0);
+    }
+    fclose(out);
+    printf("带计数的代码表已输出到 %s\n", path);
+
+    // 剖析文件：按源程序位置记录，编译器 --profile-use 读入（格式见yuyifenxi.cpp）
+    if (lineCount > 0) {
+        snprintf(path, sizeof(path), "%s.cjprof", prefix);
+        out = fopen(path, "w");
+        if (!out) {
+            printf("无法写入 %s\n", path);
+            free(by_line);
+            return 2;
+        }
+        fprintf(out, "profile %s\n", file);
+        for (int i = 0; i < lineCount; i++) {
+            fprintf(out, "pos %u:%u = %lld\n", line_table[i].line, line_table[i].col, prof_hits[line_table[i].pc]);
+        }
+        for (int i = 0; i < codesIndex; i++) {
+            const ModuleLine *p = pos_of(i);
+            if (codes[i].op == OP_BRF && p && prof_hits[i] > 0)
+                fprintf(out, "branch %u:%u = %lld/%lld\n", p->line, p->col, prof_taken[i], prof_hits[i]);
+        }
+        for (int f = 0; f < prof_funcs; f++) {
+            fprintf(out, "call %s = %lld\n", prof_func_name(f, name, sizeof(name)), prof_hits[prof_entry[f]]);
+        }
+        fclose(out);
+        printf("剖析文件已输出到 %s\n", path);
+    }
+
+    // 终端上只列最热的几行
+    printf("\n最热的源程序行:\n");
+    for (int k = 0; k < 5; k++) {
+        int best = -1;
+        long long best_n = 0;
+        for (int l = 0; l <= max_line; l++) {
+            long long n = 0;
+            for (int f = 0; f < prof_funcs; f++) n += by_line[f * (max_line + 1) + l];
+            if (n > best_n) {
+                best_n = n;
+                best = l;
+            }
+        }
+        if (best < 0) break;
+        printf("  第%-4d行 %12lld 次 %6.2f%%\n", best, best_n, total ? 100.0 * best_n / total : 0.0);
+        for (int f = 0; f < prof_funcs; f++) by_line[f * (max_line + 1) + best] = 0;
+    }
+    if (lineCount == 0) printf("（代码没有行号表，全部计入第0行）\n");
+    free(by_line);
+    return 0;
+}
+
+// ===========================================================
+// 主函数：输入中间代码文件 → 执行
+// ===========================================================
+int main(int argc, char **argv) {
+    char code_file[300];
+    int use_jit = 0, use_reg = 0, use_tier = 0, no_verify = 0, argi = 1;
+
+    if (argi < argc && strcmp(argv[argi], "--check") == 0) {
+        int failed = 0;
+        for (argi++; argi < argc; argi++) failed += check_one(argv[argi]);
+        printf("对比测试结束，%d 个不一致\n", failed);
+        return failed ? 1 : 0;
+    }
+    if (argi < argc && strcmp(argv[argi], "--bench") == 0) {
+        if ((argc != 4 && argc != 5) || atoi(argv[2]) <= 0) {
+            printf("用法: %s --bench 次数 中间代码文件 [对照文件]\n", argv[0]);
+            return 1;
+        }
+        return bench(argv[3], atoi(argv[2]), argc == 5 ? argv[4] : NULL);
+    }
+    if (argi < argc && strcmp(argv[argi], "--profile") == 0) {
+        if (argc != 3 && argc != 4) {
+            printf("用法: %s --profile 中间代码文件 [输出前缀]\n", argv[0]);
+            return 1;
+        }
+        return profile(argv[2], argc == 4 ? argv[3] : argv[2]);
+    }
+    if (argi < argc && strcmp(argv[argi], "--dump") == 0) {
+        if (argc != 3) {
+            printf("用法: %s --dump 中间代码文件\n", argv[0]);
+            return 1;
+        }
+        int es = load_codes(argv[2]);
+        if (es) return es;
+        dump_codes(stdout);
+        return 0;
+    }
+    if (argi < argc && strcmp(argv[argi], "--aot") == 0) {
+        char exe[600];
+        const char *why = "";
+        if (argc != 3 && argc != 4) {
+            printf("用法: %s --aot 中间代码文件 [可执行文件]\n", argv[0]);
+            return 1;
+        }
+        if (load_codes(argv[2])) return 1;
+        if (argc == 4) snprintf(exe, sizeof(exe), "%s", argv[3]);
+        else snprintf(exe, sizeof(exe), "%s.out", argv[2]);
+        if (!aot_build(argv[2], exe, &why)) {
+            printf("AOT编译失败：%s\n", why);
+            return 2;
+        }
+        printf("已生成 %s（C代码 %s.c）\n", exe, exe);
+        return 0;
+    }
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strcmp(argv[argi], "--jit") == 0) {
+            use_jit = 1;
+        } else if (strcmp(argv[argi], "--reg") == 0) {
+            use_reg = 1;
+        } else if (strcmp(argv[argi], "--no-verify") == 0) {
+            no_verify = 1;
+        } else if (strcmp(argv[argi], "--tier=auto") == 0) {
+            use_tier = 1;
+            tier_mode = TIER_AUTO;
+        } else if (strcmp(argv[argi], "--tier=interp") == 0) {
+            use_tier = 1;
+            tier_mode = TIER_INTERP;
+        } else if (strcmp(argv[argi], "--tier=jit") == 0) {
+            use_tier = 1;
+            tier_mode = TIER_JIT;
+        } else if (strncmp(argv[argi], "--tier-threshold=", 17) == 0 &&
+                   sscanf(argv[argi] + 17, "%lld,%lld", &tier_call_threshold, &tier_loop_threshold) == 2 &&
+                   tier_call_threshold > 0 && tier_loop_threshold > 0) {
+            use_tier = 1;
+        } else {
+            printf("未知选项 %s\n", argv[argi]);
+            return 1;
+        }
+    }
+
+    if (argi < argc) {
+        strncpy(code_file, argv[argi], sizeof(code_file) - 1);
+        code_file[sizeof(code_file) - 1] = '\0';
+    } else {
+        printf("请输入中间代码文件名（含路径）：");
+        if (scanf("%s", code_file) != 1) return 1;
+    }
+
+    int es = load_codes(code_file);
+    if (es) return es;
+
+    vm_reset();
+    if (use_jit) {
+        const char *why = "";
+        JitFn fn = jit_compile(&why);
+        if (fn) {
+            run_jit(fn);
+            printf("程序运行结束（JIT，机器码 %d 字节）\n", jit_prog.len);
+            return 0;
+        }
+        printf("JIT不可用（%s），改用解释执行\n", why);
+    }
+    if (use_reg) {
+        const char *why = "";
+        if (reg_lower(&why)) {
+            print_reg_codes();
+            vm_reset();
+            run_reg();
+            printf("程序运行结束（寄存器虚拟机），共执行 %lld 条指令\n", exec_count);
+            return 0;
+        }
+        printf("寄存器虚拟机不可用（%s），改用解释执行\n", why);
+    }
+
+    // 通过校验的程序走不做检查的快速路径；--no-verify 时逐条检查执行
+    if (use_tier) {
+        if (!verify_codes()) {
+            printf("字节码校验失败：%s\n", verify_msg);
+            return 4;
+        }
+        run_tiered();
+        tier_finish();
+        printf("程序运行结束，解释器执行 %lld 条指令\n", exec_count);
+        print_tier_stats();
+        return 0;
+    }
+    if (no_verify) {
+        run();
+    } else if (verify_codes()) {
+        run_fast();
+    } else {
+        printf("字节码校验失败：%s\n", verify_msg);
+        return 4;
+    }
+
+    printf("程序运行结束，共执行 %lld 条指令\n", exec_count);
+    return 0;
+}
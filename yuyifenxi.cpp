@@ -4,22 +4,30 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <math.h>
+#include <errno.h>
 
 #define maxsymbolIndex 100
-#define MAX_CODES 200
+#define MAX_CODES 1000
 #define MAX_ERRORS 100
 #define MAX_SCOPE_LEVEL 10
+#define MAX_CONSTS 256
 
 
-// =====================  =====================
+// ===================== 函数声明 =====================
 int TESTparse();
+int compile_file(const char *path);
+int compile_tokens();
 int program();
 int main_declaration();
+int function_declaration();
 int function_body();
 int statement();
 int expression_stat();
 int expression();
 int bool_expr();
+int condition_expr();
+int cond_jump(int *false_list, int first_parsed);
+int logic_expr();
 int additive_expr();
 int term();
 int factor();
@@ -33,12 +41,24 @@ int declaration_list();
 int statement_list();
 int compound_stat();
 int call_stat();
+int call_function(int sym, int want_value, int *inlined);
+int return_stat();
 int break_stat();
 int continue_stat();
+int labeled_stat();
 void report_error(int error_code, const char *fmt, ...);
+void trace(const char *fmt, ...);
 int lookup_current_scope(char *name, int *pPosition);
-
-// ö
+void loop_push();
+void loop_pop();
+int is_branch_op(const char *op);
+int is_logic_token(const char *op);
+int pgo_unroll_factor(int hend, int body_len, long long trips);
+int func_param_count(int sym);
+int func_call_shape(int sym, int *nparams, int *has_value);
+int inline_table_full();
+
+// 数据类型枚举
 enum DataType {
     TYPE_INT,
     TYPE_FLOAT,
@@ -53,20 +73,24 @@ enum DataType {
 
 enum Category_symbol { variable, function, parameter };
 
-// Ϣṹ
+int check_type_compatible(enum DataType t1, enum DataType t2, const char *context);
+const char* type_to_string(enum DataType type);
+
+// 数组信息结构
 typedef struct {
-    int dimensions;     // ά
-    int size[5];        // άС֧5ά
+    int dimensions;     // 数组维数
+    int size[5];        // 各维大小（最大支持5维）
 } ArrayInfo;
 
-// ջ
+// 作用域栈
 typedef struct {
-    int start_symbol;   // ʼķ
-    int level;          // 㼶
-    char type[10];      // ͣglobal, function, block, loop
+    int start_symbol;   // 该作用域开始的符号索引
+    int level;          // 作用域层级
+    char type[10];      // 作用域类型：global, function, block, loop
+    int start_offset;   // 进入该作用域时的帧内偏移，退出时归还
 } ScopeEntry;
 
-// Ϣṹ
+// 错误信息结构
 typedef struct {
     int line;
     int error_code;
@@ -78,10 +102,16 @@ ErrorInfo error_list[MAX_ERRORS];
 int error_count = 0;
 int has_fatal_error = 0;
 
-// мṹ
+// 源程序位置：词法分析器给出的单词首字符的行、列，0为未知
+typedef struct {
+    int line, col;
+} SrcPos;
+
+// 中间代码结构
 typedef struct Code {
     char opt[10];
     int operand;
+    SrcPos pos;         // 生成这条指令的源程序位置，优化时随指令一起搬动
 } Code;
 
 Code codes[MAX_CODES];
@@ -89,7 +119,11 @@ int codesIndex = 0;
 int temp_var_count = 0;
 int label_count = 0;
 
-// űṹǿ棩
+// 浮点常量池：LOADF的操作数是池中下标，整数常量仍由LOADI直接携带
+double const_pool[MAX_CONSTS];
+int constCount = 0;
+
+// 符号表结构（增强版）
 typedef struct {
     char name[64];
     enum Category_symbol kind;
@@ -97,67 +131,262 @@ typedef struct {
     int address;
     int initialized;
     int line_declared;
-    int scope_level;        // 㼶
-    ArrayInfo array_info;   // Ϣ
-    int is_param;           // ǷΪ
-    int param_index;        // 
+    int scope_level;        // 新增：作用域层级
+    ArrayInfo array_info;   // 新增：数组信息
+    int is_param;           // 新增：是否为参数
+    int param_index;        // 新增：参数索引
+    int scope_closed;       // 所在作用域已退出，不再可见，槽位可被复用
 } SymbolEntry;
 
 SymbolEntry symbol[maxsymbolIndex];
 int symbolIndex = 0;
-int offset;
+int offset;             // 下一个空闲的帧内槽位（0号槽位保留）
+int frame_size = 0;     // 函数帧大小：各作用域同时存活变量数的最大值 + 1
 int current_line = 1;
 
-// 
+// 作用域管理
 ScopeEntry scope_stack[MAX_SCOPE_LEVEL];
 int scope_top = -1;
 int current_scope_level = 0;
-int in_loop = 0;  // Ƿѭ
+int in_loop = 0;  // 是否在循环内
+enum DataType expr_type = TYPE_INT;     // 刚分析完的子表达式的类型，决定生成哪种运算指令
 
-// ASTر
+// AST相关变量
 char *astText = NULL;
 size_t astCap = 0;
 int indentLevel = 0;
 
-// Tokenر
+// Token相关变量
 char token[64], token1[256];
 char tokenfile[260];
 FILE *fpTokenin;
+SrcPos token_pos;       // 当前（预读的）单词在源程序中的位置，单词流不带位置时为0
+SrcPos consumed_pos;    // 上一个已读过的单词的位置：生成指令时预读的单词往往已在下一行
+
+// 产物选择：只构造要求的产物，直接运行本程序时全部输出
+#define EMIT_TOKENS  1
+#define EMIT_AST     2
+#define EMIT_SYMBOLS 4
+#define EMIT_CODES   8
+#define EMIT_MODULE  16
+#define EMIT_ALL (EMIT_AST | EMIT_SYMBOLS | EMIT_CODES | EMIT_MODULE)
+
+int emit_mask = EMIT_ALL;
+int trace_enabled = 1;
+char outbase[260];      // 产物文件名前缀，默认就是单词流文件名
+
+// ===================== 编译统计 =====================
+// --stats=文件 时记录各阶段的墙钟时间、CPU时间和阶段内内存峰值的增长，
+// 以及单词、语法树节点、符号、作用域等计数，编译结束写成JSON。
+// 中间代码条数取链接后写进模块的代码表（优化和函数链接都会改变条数）。
+// 只在阶段边界计时；读单词夹在语法分析中间、每个单词一次，计时本身
+// 就和读一个单词差不多贵，不单独计时，算在parse阶段里。
+// 编译时 -DCOMPILE_STATS=0 去掉全部统计代码。
+
+#ifndef COMPILE_STATS
+#define COMPILE_STATS 1
+#endif
+
+#if COMPILE_STATS
+
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+enum StatPhase { PHASE_CACHE, PHASE_LEX, PHASE_PARSE, PHASE_OPTIMIZE, PHASE_OUTPUT, PHASE_COUNT };
+const char *stat_phase_names[] = { "cache", "lex", "parse", "optimize", "output" };
+
+enum StatCounter {
+    STAT_TOKENS, STAT_AST_NODES, STAT_SYMBOLS_INSERTED, STAT_SYMBOL_LOOKUPS,
+    STAT_SCOPES_ENTERED, STAT_COUNT
+};
+const char *stat_counter_names[] = {
+    "tokens", "ast_nodes", "symbols_inserted", "symbol_lookups",
+    "scopes_entered"
+};
+
+typedef struct {
+    double wall_ms, cpu_ms;
+    double wall_start, cpu_start;
+    long peak_start;
+    long peak_growth_kb;    // 阶段内进程内存峰值的增长：ru_maxrss只有进程级的峰值，
+                            // 前面阶段的峰值更高时这一阶段记为0
+    int ran;
+} PhaseStat;
+
+PhaseStat phase_stats[PHASE_COUNT];
+long stat_counters[STAT_COUNT];
+int stats_enabled = 0;
+char stats_path[260];
+
+double stat_wall_ms() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+#else
+    return clock() * 1000.0 / CLOCKS_PER_SEC;
+#endif
+}
+
+double stat_cpu_ms() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+#else
+    return clock() * 1000.0 / CLOCKS_PER_SEC;
+#endif
+}
+
+long stat_peak_kb() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;     // macOS按字节计
+#else
+    return ru.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void stats_reset() {
+    memset(phase_stats, 0, sizeof(phase_stats));
+    memset(stat_counters, 0, sizeof(stat_counters));
+}
+
+void phase_begin(int p) {
+    if (!stats_enabled) return;
+    phase_stats[p].wall_start = stat_wall_ms();
+    phase_stats[p].cpu_start = stat_cpu_ms();
+    phase_stats[p].peak_start = stat_peak_kb();
+}
+
+void phase_end(int p) {
+    if (!stats_enabled) return;
+    phase_stats[p].wall_ms += stat_wall_ms() - phase_stats[p].wall_start;
+    phase_stats[p].cpu_ms += stat_cpu_ms() - phase_stats[p].cpu_start;
+    phase_stats[p].peak_growth_kb += stat_peak_kb() - phase_stats[p].peak_start;
+    phase_stats[p].ran = 1;
+}
+
+// 把统计写成JSON，cache_hit为1时只有cache阶段。各阶段的内存是峰值增长，
+// 进程整体的峰值单独记在 process_peak_rss_kb
+int write_stats(const char *path, int cache_hit, int result) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        printf("无法写入统计文件 %s\n", path);
+        return 1;
+    }
+    fprintf(f, "{\n  \"input\": \"");
+    for (const char *p = tokenfile; *p; p++) {
+        if (*p == '"' || *p == '\\') fputc('\\', f);
+        fputc(*p, f);
+    }
+    fprintf(f, "\",\n  \"result\": %d,\n  \"cache_hit\": %s,\n", result, cache_hit ? "true" : "false");
+    fprintf(f, "  \"process_peak_rss_kb\": %ld,\n", stat_peak_kb());
+
+    fprintf(f, "  \"phases\": {");
+    int first = 1;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (!phase_stats[p].ran) continue;
+        fprintf(f, "%s\n    \"%s\": { \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"peak_rss_growth_kb\": %ld",
+                first ? "" : ",", stat_phase_names[p],
+                phase_stats[p].wall_ms, phase_stats[p].cpu_ms, phase_stats[p].peak_growth_kb);
+        fprintf(f, " }");
+        first = 0;
+    }
+    fprintf(f, "\n  },\n  \"counters\": {\n");
+    for (int c = 0; c < STAT_COUNT; c++) {
+        fprintf(f, "    \"%s\": %ld,\n", stat_counter_names[c], stat_counters[c]);
+    }
+    fprintf(f, "    \"codes_emitted\": %d,\n    \"errors\": %d\n  }\n}\n", codesIndex, error_count);
+    fclose(f);
+    return 0;
+}
+
+int stats_open(const char *path) {
+    snprintf(stats_path, sizeof(stats_path), "%s", path);
+    stats_enabled = 1;
+    return 0;
+}
 
-// =====================  =====================
+void stats_finish(int cache_hit, int result) {
+    if (stats_enabled) write_stats(stats_path, cache_hit, result);
+}
+
+#define STAT_INC(c) (stat_counters[c]++)
+#define PHASE_BEGIN(p) phase_begin(p)
+#define PHASE_END(p) phase_end(p)
+
+#else
+
+int stats_open(const char *path) {
+    printf("编译时关闭了统计功能（COMPILE_STATS=0）\n");
+    return 1;
+}
+
+void stats_reset() {}
+void stats_finish(int cache_hit, int result) {}
+
+#define STAT_INC(c) ((void)0)
+#define PHASE_BEGIN(p) ((void)0)
+#define PHASE_END(p) ((void)0)
+
+#endif
+
+// ===================== 作用域管理函数 =====================
 
 void enter_scope(const char *type) {
     if (scope_top >= MAX_SCOPE_LEVEL - 1) {
-        report_error(60, "Ƕ׹");
+        report_error(60, "作用域嵌套过深");
         return;
     }
 
     scope_top++;
+    STAT_INC(STAT_SCOPES_ENTERED);
     scope_stack[scope_top].start_symbol = symbolIndex;
     scope_stack[scope_top].level = current_scope_level;
     strcpy(scope_stack[scope_top].type, type);
+    scope_stack[scope_top].start_offset = offset;
 
     current_scope_level++;
 
-    printf(": %s (㼶: %d)\n", type, current_scope_level);
+    trace("进入作用域: %s (层级: %d)\n", type, current_scope_level);
 
     if (strcmp(type, "loop") == 0) {
         in_loop++;
+        loop_push();
     }
 }
 
 void exit_scope() {
     if (scope_top < 0) return;
 
-    printf("˳: %s (㼶: %d)\n",
+    trace("退出作用域: %s (层级: %d)\n",
            scope_stack[scope_top].type, current_scope_level);
 
-    // ѭ򣬼ѭ
+    // 如果是循环作用域，减少循环计数
     if (strcmp(scope_stack[scope_top].type, "loop") == 0 && in_loop > 0) {
         in_loop--;
+        loop_pop();
+    }
+
+    // 该作用域的符号不再可见（保留在表中供输出）
+    for (int i = scope_stack[scope_top].start_symbol; i < symbolIndex; i++) {
+        symbol[i].scope_closed = 1;
+    }
+
+    // 块和循环作用域的槽位归还，供后面不相交的作用域复用
+    if (strcmp(scope_stack[scope_top].type, "block") == 0 ||
+        strcmp(scope_stack[scope_top].type, "loop") == 0) {
+        offset = scope_stack[scope_top].start_offset;
     }
 
-    // ӷűƳķţ򻯣ֻ
     current_scope_level--;
     scope_top--;
 }
@@ -166,9 +395,9 @@ int get_current_scope_level() {
     return current_scope_level;
 }
 
-// =====================  =====================
+// ===================== 辅助函数 =====================
 
-// ޸ĸ
+// 修复后的辅助函数
 int is_float_string(const char *str) {
     if (!str || !*str) return 0;
 
@@ -176,30 +405,30 @@ int is_float_string(const char *str) {
     int has_digit = 0;
     int i = 0;
 
-    // Ƿз
+    // 检查是否有符号
     if (str[i] == '+' || str[i] == '-') {
         i++;
     }
 
-    // 
+    // 检查整数部分
     while (str[i] != '\0' && str[i] >= '0' && str[i] <= '9') {
         has_digit = 1;
         i++;
     }
 
-    // СС
+    // 检查小数点和小数部分
     if (str[i] == '.') {
         has_dot = 1;
         i++;
 
-        // С
+        // 检查小数部分
         while (str[i] != '\0' && str[i] >= '0' && str[i] <= '9') {
             has_digit = 1;
             i++;
         }
     }
 
-    // ѧѡ
+    // 检查科学计数法（可选）
     if (has_digit && (str[i] == 'e' || str[i] == 'E')) {
         i++;
         if (str[i] == '+' || str[i] == '-') {
@@ -210,7 +439,7 @@ int is_float_string(const char *str) {
         }
     }
 
-    // ַˣ֣С㣬Ǹ
+    // 如果整个字符串都被处理了，并且有数字，且有小数点，才是浮点数
     return (str[i] == '\0' && has_digit && has_dot);
 }
 
@@ -219,12 +448,12 @@ int is_int_string(const char *str) {
 
     int i = 0;
 
-    // 
+    // 检查符号
     if (str[i] == '+' || str[i] == '-') {
         i++;
     }
 
-    // ַ
+    // 检查所有字符都是数字
     while (str[i] != '\0') {
         if (str[i] < '0' || str[i] > '9') {
             return 0;
@@ -232,7 +461,7 @@ int is_int_string(const char *str) {
         i++;
     }
 
-    // ȷһ
+    // 确保至少有一个数字
     return (i > 0 && (str[0] != '+' && str[0] != '-')) || (i > 1);
 }
 
@@ -241,7 +470,7 @@ int is_string_literal(const char *str) {
     return (str[0] == '"' && str[strlen(str)-1] == '"');
 }
 
-// =====================  =====================
+// ===================== 错误处理函数 =====================
 
 void report_error(int error_code, const char *fmt, ...) {
     if (error_count >= MAX_ERRORS) return;
@@ -256,7 +485,7 @@ void report_error(int error_code, const char *fmt, ...) {
     error_list[error_count].is_warning = 0;
     error_count++;
 
-    printf("[%d]: %s\n", error_code, error_list[error_count-1].message);
+    printf("错误[%d]: %s\n", error_code, error_list[error_count-1].message);
 
     if (error_code >= 10 && error_code <= 35) {
         has_fatal_error = 1;
@@ -276,11 +505,22 @@ void report_warning(const char *fmt, ...) {
     error_list[error_count].is_warning = 1;
     error_count++;
 
-    printf(": %s\n", error_list[error_count-1].message);
+    printf("警告: %s\n", error_list[error_count-1].message);
+}
+
+// 分析过程跟踪（读入的单词、生成的代码、作用域和符号），驱动程序默认关闭，
+// 关闭时连格式化也不做
+void trace(const char *fmt, ...) {
+    if (!trace_enabled) return;
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
 }
 
 void print_all_errors() {
-    printf("\n=== ﷨ ===\n");
+    if (error_count == 0 && !trace_enabled) return;     // 不跟踪时编译通过就不出声
+    printf("\n=== 语法语义分析报告 ===\n");
 
     int error_num = 0;
     int warning_num = 0;
@@ -288,31 +528,35 @@ void print_all_errors() {
     for (int i = 0; i < error_count; i++) {
         if (error_list[i].is_warning) {
             warning_num++;
-            printf(" %d ( %d): %s\n", warning_num, error_list[i].line, error_list[i].message);
+            printf("警告 %d (行 %d): %s\n", warning_num, error_list[i].line, error_list[i].message);
         } else {
             error_num++;
-            printf(" %d [%d] ( %d): %s\n",
+            printf("错误 %d [代码%d] (行 %d): %s\n",
                    error_num, error_list[i].error_code, error_list[i].line, error_list[i].message);
         }
     }
 
-    printf("\nܽ:  %d %d \n", error_num, warning_num);
+    printf("\n总结: 共发现 %d 个错误，%d 个警告\n", error_num, warning_num);
 
     if (error_num == 0 && warning_num == 0) {
-        printf("﷨ͨ\n");
+        printf("语法语义分析通过！\n");
     } else if (error_num == 0) {
-        printf("ͨоҪע⡣\n");
+        printf("语义检查通过，但有警告需要注意。\n");
     } else if (has_fatal_error) {
-        printf("жм롣\n");
+        printf("存在致命错误，中断生成中间代码。\n");
     }
 }
 
-// ===================== AST =====================
+// ===================== AST函数 =====================
 void ast_init() {
+    free(astText);      // 上一次编译提前返回时可能没有释放
+    astText = NULL;
+    indentLevel = 0;
+    if (!(emit_mask & EMIT_AST)) return;   // 不要语法树时不构造，各ast_函数直接返回
     astCap = 1 << 16;
     astText = (char *)malloc(astCap);
     if (!astText) {
-        fprintf(stderr, "ڴʧ\n");
+        fprintf(stderr, "内存分配失败\n");
         exit(1);
     }
     astText[0] = '\0';
@@ -320,12 +564,14 @@ void ast_init() {
 }
 
 void ast_add_indent() {
+    if (!astText) return;
     for (int i = 0; i < indentLevel; i++) {
         strcat(astText, "  ");
     }
 }
 
 void ast_append(const char *fmt, ...) {
+    if (!astText) return;
     va_list ap;
     va_start(ap, fmt);
     size_t cur = strlen(astText);
@@ -337,7 +583,7 @@ void ast_append(const char *fmt, ...) {
         astCap = (cur + need + 16) * 2;
         astText = (char *)realloc(astText, astCap);
         if (!astText) {
-            fprintf(stderr, "ڴطʧ\n");
+            fprintf(stderr, "内存重分配失败\n");
             exit(1);
         }
     }
@@ -345,6 +591,7 @@ void ast_append(const char *fmt, ...) {
 }
 
 void ast_begin(const char *name) {
+    STAT_INC(STAT_AST_NODES);
     ast_add_indent();
     ast_append("%s:\n", name);
     indentLevel++;
@@ -361,57 +608,71 @@ void ast_add_attr(const char *attr, const char *value) {
     ast_append("  %s: %s\n", attr, value);
 }
 
-// ===================== мɺ =====================
+// ===================== 中间代码生成函数 =====================
+
+SrcPos code_pos() {
+    return consumed_pos.line ? consumed_pos : token_pos;
+}
+
+// 两次读单词之间生成的指令（不论经gen_code还是直接写codes[]）都属于
+// 当时已读过的那个单词，在读下一个单词前统一记上它的位置
+int lines_filled = 0;
+
+void fill_code_lines() {
+    if (lines_filled > codesIndex) lines_filled = codesIndex;     // 有指令被撤回
+    for (; lines_filled < codesIndex; lines_filled++) codes[lines_filled].pos = code_pos();
+}
 
 void gen_code(const char *opt, int operand) {
+    if (inline_table_full()) return;
     if (codesIndex >= MAX_CODES) {
-        report_error(99, "м");
+        report_error(99, "中间代码表已满");
         return;
     }
 
-    // 루ָ
+    // 修正操作码（根据你的指令集）
     if (strcmp(opt, "LIT") == 0) {
         strcpy(codes[codesIndex].opt, "LOADI");
     } else if (strcmp(opt, "LIT_BOOL") == 0) {
         strcpy(codes[codesIndex].opt, "LOADI");
     } else if (strcmp(opt, "INC") == 0) {
-        // Ҫָ
-        // x++ ൱: LOAD x; LOADI 1; ADD; STO x
-        strcpy(codes[codesIndex].opt, "LOAD");  // ȼر
+        // 自增操作需要多条指令
+        // x++ 相当于: LOAD x; LOADI 1; ADD; STO x
+        strcpy(codes[codesIndex].opt, "LOAD");  // 先加载变量
         codes[codesIndex].operand = operand;
         codesIndex++;
 
         if (codesIndex >= MAX_CODES) {
-            report_error(99, "м");
+            report_error(99, "中间代码表已满");
             return;
         }
-        strcpy(codes[codesIndex].opt, "LOADI");  // س1
+        strcpy(codes[codesIndex].opt, "LOADI");  // 加载常量1
         codes[codesIndex].operand = 1;
         codesIndex++;
 
         if (codesIndex >= MAX_CODES) {
-            report_error(99, "м");
+            report_error(99, "中间代码表已满");
             return;
         }
-        strcpy(codes[codesIndex].opt, "ADD");  // 
+        strcpy(codes[codesIndex].opt, "ADD");  // 相加
         codes[codesIndex].operand = 0;
         codesIndex++;
 
         if (codesIndex >= MAX_CODES) {
-            report_error(99, "м");
+            report_error(99, "中间代码表已满");
             return;
         }
-        strcpy(codes[codesIndex].opt, "STO");  // 
+        strcpy(codes[codesIndex].opt, "STO");  // 存回
         codes[codesIndex].operand = operand;
-        // βcodesIndex++Ϊ㺯
+        // 这次不用codesIndex++，因为外层函数会加
     } else if (strcmp(opt, "DEC") == 0) {
-        // x-- ൱: LOAD x; LOADI 1; SUB; STO x
+        // x-- 相当于: LOAD x; LOADI 1; SUB; STO x
         strcpy(codes[codesIndex].opt, "LOAD");
         codes[codesIndex].operand = operand;
         codesIndex++;
 
         if (codesIndex >= MAX_CODES) {
-            report_error(99, "м");
+            report_error(99, "中间代码表已满");
             return;
         }
         strcpy(codes[codesIndex].opt, "LOADI");
@@ -419,7 +680,7 @@ void gen_code(const char *opt, int operand) {
         codesIndex++;
 
         if (codesIndex >= MAX_CODES) {
-            report_error(99, "м");
+            report_error(99, "中间代码表已满");
             return;
         }
         strcpy(codes[codesIndex].opt, "SUB");
@@ -427,20 +688,20 @@ void gen_code(const char *opt, int operand) {
         codesIndex++;
 
         if (codesIndex >= MAX_CODES) {
-            report_error(99, "м");
+            report_error(99, "中间代码表已满");
             return;
         }
         strcpy(codes[codesIndex].opt, "STO");
         codes[codesIndex].operand = operand;
     } else if (strcmp(opt, "PRE_INC") == 0 || strcmp(opt, "PRE_DEC") == 0) {
-        // ǰ/Լƣʹ˳ͬ
+        // 前置自增/自减与后置类似，但使用顺序不同
         if (strcmp(opt, "PRE_INC") == 0) {
             strcpy(codes[codesIndex].opt, "LOAD");
             codes[codesIndex].operand = operand;
             codesIndex++;
 
             if (codesIndex >= MAX_CODES) {
-                report_error(99, "м");
+                report_error(99, "中间代码表已满");
                 return;
             }
             strcpy(codes[codesIndex].opt, "LOADI");
@@ -448,7 +709,7 @@ void gen_code(const char *opt, int operand) {
             codesIndex++;
 
             if (codesIndex >= MAX_CODES) {
-                report_error(99, "м");
+                report_error(99, "中间代码表已满");
                 return;
             }
             strcpy(codes[codesIndex].opt, "ADD");
@@ -456,15 +717,15 @@ void gen_code(const char *opt, int operand) {
             codesIndex++;
 
             if (codesIndex >= MAX_CODES) {
-                report_error(99, "м");
+                report_error(99, "中间代码表已满");
                 return;
             }
-            strcpy(codes[codesIndex].opt, "LOAD");  // ټһڱʽ
+            strcpy(codes[codesIndex].opt, "LOAD");  // 再加载一次用于表达式
             codes[codesIndex].operand = operand;
             codesIndex++;
 
             if (codesIndex >= MAX_CODES) {
-                report_error(99, "м");
+                report_error(99, "中间代码表已满");
                 return;
             }
             strcpy(codes[codesIndex].opt, "STO");
@@ -474,7 +735,7 @@ void gen_code(const char *opt, int operand) {
             codesIndex++;
 
             if (codesIndex >= MAX_CODES) {
-                report_error(99, "м");
+                report_error(99, "中间代码表已满");
                 return;
             }
             strcpy(codes[codesIndex].opt, "LOADI");
@@ -482,7 +743,7 @@ void gen_code(const char *opt, int operand) {
             codesIndex++;
 
             if (codesIndex >= MAX_CODES) {
-                report_error(99, "м");
+                report_error(99, "中间代码表已满");
                 return;
             }
             strcpy(codes[codesIndex].opt, "SUB");
@@ -490,7 +751,7 @@ void gen_code(const char *opt, int operand) {
             codesIndex++;
 
             if (codesIndex >= MAX_CODES) {
-                report_error(99, "м");
+                report_error(99, "中间代码表已满");
                 return;
             }
             strcpy(codes[codesIndex].opt, "LOAD");
@@ -498,7 +759,7 @@ void gen_code(const char *opt, int operand) {
             codesIndex++;
 
             if (codesIndex >= MAX_CODES) {
-                report_error(99, "м");
+                report_error(99, "中间代码表已满");
                 return;
             }
             strcpy(codes[codesIndex].opt, "STO");
@@ -526,13 +787,13 @@ void gen_code(const char *opt, int operand) {
     } else if (strcmp(opt, "NOT") == 0) {
         strcpy(codes[codesIndex].opt, "NOT");
     } else {
-        // 뱣ֲ
+        // 其他操作码保持不变
         strcpy(codes[codesIndex].opt, opt);
     }
 
     codes[codesIndex].operand = operand;
 
-    printf("ɴ[%d]: %s %d\n", codesIndex, codes[codesIndex].opt, codes[codesIndex].operand);
+    trace("生成代码[%d]: %s %d\n", codesIndex, codes[codesIndex].opt, codes[codesIndex].operand);
     codesIndex++;
 }
 
@@ -540,242 +801,2783 @@ int new_temp() {
     return temp_var_count++;
 }
 
+// 优化引入的临时变量排在帧尾，返回其帧内槽位
+int new_frame_temp() {
+    return frame_size + new_temp();
+}
+
+// 分析期间需要的匿名变量：像局部变量一样占用当前作用域的槽位，
+// 作用域退出时随之归还（此时帧大小尚未确定，不能用帧尾临时变量）
+int new_scope_slot() {
+    int addr = offset++;
+    if (offset > frame_size) frame_size = offset;
+    return addr;
+}
+
 int new_label() {
     return label_count++;
 }
 
+// ===================== 类型化运算指令 =====================
+// 整数运算沿用 ADD/LES 等原操作码，浮点运算用带F后缀的操作码
+// （ADDF/LESF…），float与double在虚拟机里用同一种浮点表示。
+// 整数与浮点混合运算时先用 I2F n 把距栈顶第n个值转成浮点，
+// 运行时不需要类型标记。
+
+int is_float_type(enum DataType t) {
+    return t == TYPE_FLOAT || t == TYPE_DOUBLE;
+}
+
+// 数值类型之间的运算按需提升，不必报告
+int is_numeric_type(enum DataType t) {
+    return t == TYPE_INT || t == TYPE_CHAR || is_float_type(t);
+}
+
+int check_operand_types(enum DataType t1, enum DataType t2, const char *context) {
+    if (is_numeric_type(t1) && is_numeric_type(t2)) return 1;
+    return check_type_compatible(t1, t2, context);
+}
+
+// 混合运算的结果类型：有浮点就是浮点，double优先
+enum DataType arith_result_type(enum DataType t1, enum DataType t2) {
+    if (t1 == TYPE_DOUBLE || t2 == TYPE_DOUBLE) return TYPE_DOUBLE;
+    if (t1 == TYPE_FLOAT || t2 == TYPE_FLOAT) return TYPE_FLOAT;
+    return TYPE_INT;
+}
+
+// 常量入池，相同的值只存一份
+int add_float_const(double v) {
+    for (int i = 0; i < constCount; i++) {
+        if (const_pool[i] == v) return i;
+    }
+    if (constCount >= MAX_CONSTS) {
+        report_error(99, "浮点常量池已满");
+        return 0;
+    }
+    const_pool[constCount] = v;
+    return constCount++;
+}
+
+// 生成二元运算：op为整数操作码（ADD/LES等），t1、t2为左右操作数类型
+void gen_typed_binary(const char *op, enum DataType t1, enum DataType t2) {
+    if (!is_float_type(t1) && !is_float_type(t2)) {
+        gen_code(op, 0);
+        return;
+    }
+    char fop[16];
+    snprintf(fop, sizeof(fop), "%sF", op);
+    if (!is_float_type(t1)) gen_code("I2F", 1);
+    if (!is_float_type(t2)) gen_code("I2F", 0);
+    gen_code(fop, 0);
+}
+
+// 栈顶的值从类型from转成类型to（赋值时用）
+void gen_convert(enum DataType from, enum DataType to) {
+    if (is_float_type(to) && !is_float_type(from) && from != TYPE_UNKNOWN) {
+        gen_code("I2F", 0);
+    } else if (!is_float_type(to) && to != TYPE_UNKNOWN && is_float_type(from)) {
+        gen_code("F2I", 0);
+    }
+}
+
+void print_const_pool(FILE *out) {
+    if (constCount == 0) return;
+    fprintf(out, "\n浮点常量池: %d 个\n", constCount);
+    for (int i = 0; i < constCount; i++) {
+        fprintf(out, "常量 %d = %.17g\n", i, const_pool[i]);
+    }
+}
+
+// 行号表：按位置游程编码，连续位置相同的指令只记一项
+// "从这条指令起属于第几行第几列"。单词流不带位置（全为0）时不输出
+int build_line_table(int *pcs, SrcPos *pos) {
+    int n = 0, known = 0;
+    for (int i = 0; i < codesIndex; i++) {
+        if (codes[i].pos.line) known = 1;
+        if (n == 0 || codes[i].pos.line != pos[n - 1].line || codes[i].pos.col != pos[n - 1].col) {
+            pcs[n] = i;
+            pos[n] = codes[i].pos;
+            n++;
+        }
+    }
+    return known ? n : 0;
+}
+
+void print_line_table(FILE *out) {
+    static int pcs[MAX_CODES];
+    static SrcPos pos[MAX_CODES];
+    int n = build_line_table(pcs, pos);
+    if (n == 0) return;
+    fprintf(out, "\n行号表: %d 项\n", n);
+    for (int i = 0; i < n; i++) {
+        fprintf(out, "行号 %d = %d:%d\n", pcs[i], pos[i].line, pos[i].col);
+    }
+}
+
 void print_intermediate_code() {
     if (has_fatal_error) {
         return;
     }
 
-    printf("\n=== мɽ ===\n");
-    printf("%-6s %-10s %-10s\n", "", "", "");
+    printf("\n=== 中间代码生成结果 ===\n");
+    printf("%-6s %-10s %-10s\n", "序号", "操作码", "操作数");
     printf("--------------------------\n");
     for (int i = 0; i < codesIndex; i++) {
         printf("%-6d %-10s %-10d\n", i, codes[i].opt, codes[i].operand);
     }
+    print_const_pool(stdout);
 }
 
-// =====================  =====================
+// ===================== 二进制模块输出 =====================
+// 与文本代码表内容相同的紧凑格式，虚拟机映射后直接执行，布局见
+// xunijiqi.cpp 的 ModuleHeader 说明。操作码按下表编号，须与虚拟机的
+// enum OpCode 顺序一致，指令集改动时两边同时增加 MODULE_VERSION。
+
+#define MODULE_MAGIC "CJBC"
+#define MODULE_VERSION 4
+#define MODULE_PREFUSED 1
+
+const char *module_op_names[] = {
+    "LOAD", "LOADI", "STO",
+    "ADD", "SUB", "MULT", "DIV",
+    "GT", "GE", "LES", "LE", "EQ", "NOTEQ",
+    "AND", "OR", "NOT",
+    "BR", "BRF",
+    "READ", "WRITE",
+    "ENTER", "ALLOC", "CALL", "STOP",
+    "LOADF", "ADDF", "SUBF", "MULTF", "DIVF",
+    "GTF", "GEF", "LESF", "LEF", "EQF", "NOTEQF",
+    "I2F", "F2I", "READF", "WRITEF",
+    "RET", "TAILCALL"
+};
 
-const char* type_to_string(enum DataType type) {
-    switch (type) {
-        case TYPE_INT: return "int";
-        case TYPE_FLOAT: return "float";
-        case TYPE_DOUBLE: return "double";
-        case TYPE_CHAR: return "char";
-        case TYPE_STRING: return "string";
-        case TYPE_BOOL: return "bool";
-        case TYPE_VOID: return "void";
-        case TYPE_ARRAY: return "array";
-        default: return "unknown";
-    }
-}
+typedef struct {
+    char magic[4];
+    unsigned short version;
+    unsigned short flags;
+    unsigned int code_count, const_count, symbol_count, line_count;
+    unsigned int frame_size;
+    unsigned int code_off, const_off, symbol_off, line_off, str_off, str_size;
+    unsigned int file_size;
+} ModuleHeader;
 
-// ǿͼԼ
-int check_type_compatible(enum DataType t1, enum DataType t2, const char *context) {
-    if (t1 == TYPE_UNKNOWN || t2 == TYPE_UNKNOWN) {
-        return 1;
-    }
+typedef struct {
+    int op;
+    int operand;
+    int fused;          // 比较后紧跟的BRF不是跳转目标，可与比较一次完成
+} ModuleInstr;
 
-    if (t1 == t2) return 1;
+typedef struct {
+    unsigned int name;
+    int type;
+    int kind;
+    int address;        // 变量、形参为帧内槽位，函数为入口指令序号（未链接为-1）
+    int scope_level;
+    int params;         // 函数的形参个数
+} ModuleSymbol;
 
-    // ͼ
-    if (t1 == TYPE_ARRAY || t2 == TYPE_ARRAY) {
-        report_error(50, "%s: Ͳͻ", context);
-        return 0;
+typedef struct {
+    unsigned int pc;
+    unsigned int line;
+    unsigned int col;
+} ModuleLine;
+
+int module_opcode(const char *opt) {
+    for (int i = 0; i < (int)(sizeof(module_op_names) / sizeof(module_op_names[0])); i++) {
+        if (strcmp(opt, module_op_names[i]) == 0) return i;
     }
+    return -1;
+}
 
-    // ַ⴦
-    if (t1 == TYPE_STRING || t2 == TYPE_STRING) {
-        if (t1 != t2) {
-            report_error(50, "%s: ַַֻ", context);
-            return 0;
-        }
-        return 1;
+int is_compare_opt(const char *opt) {
+    static const char *ops[] = { "GT", "GE", "LES", "LE", "EQ", "NOTEQ",
+                                 "GTF", "GEF", "LESF", "LEF", "EQF", "NOTEQF" };
+    for (int i = 0; i < (int)(sizeof(ops) / sizeof(ops[0])); i++) {
+        if (strcmp(opt, ops[i]) == 0) return 1;
     }
+    return 0;
+}
 
-    // ͼ
-    if (t1 == TYPE_BOOL || t2 == TYPE_BOOL) {
-        if (t1 != t2) {
-            report_error(50, "%s: ֻ벼", context);
-            return 0;
+int write_module(const char *path) {
+    static ModuleInstr mcode[MAX_CODES];
+    static ModuleSymbol msym[maxsymbolIndex];
+    static char strtab[maxsymbolIndex * 64];
+    static char target[MAX_CODES];
+    static ModuleLine mline[MAX_CODES];
+    static int pcs[MAX_CODES];
+    static SrcPos pos[MAX_CODES];
+    static const char pad[8] = { 0 };
+    unsigned int str_size = 0;
+    int frame = codesIndex > 0 && strcmp(codes[0].opt, "ENTER") == 0 ? codes[0].operand : 0;   // main的帧
+
+    memset(target, 0, sizeof(target));
+    for (int i = 0; i < codesIndex; i++) {
+        if (is_branch_op(codes[i].opt) && codes[i].operand >= 0 && codes[i].operand < codesIndex)
+            target[codes[i].operand] = 1;
+    }
+    for (int i = 0; i < codesIndex; i++) {
+        mcode[i].op = module_opcode(codes[i].opt);
+        if (mcode[i].op < 0) {
+            printf("操作码 %s 不能写入模块\n", codes[i].opt);
+            return 1;
         }
-        return 1;
+        mcode[i].operand = codes[i].operand;
+        mcode[i].fused = is_compare_opt(codes[i].opt) && i + 1 < codesIndex &&
+                         strcmp(codes[i + 1].opt, "BRF") == 0 && !target[i + 1];
     }
-
-    // ʽֵת
-    if ((t1 == TYPE_INT && (t2 == TYPE_FLOAT || t2 == TYPE_DOUBLE)) ||
-        (t1 == TYPE_FLOAT && t2 == TYPE_DOUBLE) ||
-        (t1 == TYPE_CHAR && (t2 == TYPE_INT || t2 == TYPE_FLOAT || t2 == TYPE_DOUBLE))) {
-        report_warning("%s:  %s  %s ʽת",
-                      context, type_to_string(t2), type_to_string(t1));
-        return 1;
+    for (int i = 0; i < symbolIndex; i++) {
+        int len = strlen(symbol[i].name) + 1;
+        msym[i].name = str_size;
+        msym[i].type = symbol[i].type;
+        msym[i].kind = symbol[i].kind;
+        msym[i].address = symbol[i].address;
+        msym[i].scope_level = symbol[i].scope_level;
+        msym[i].params = symbol[i].kind == function ? func_param_count(i) : 0;
+        memcpy(strtab + str_size, symbol[i].name, len);
+        str_size += len;
     }
 
-    // ת
-    if ((t1 == TYPE_FLOAT && t2 == TYPE_INT) ||
-        (t1 == TYPE_DOUBLE && (t2 == TYPE_INT || t2 == TYPE_FLOAT)) ||
-        (t1 == TYPE_INT && t2 == TYPE_CHAR)) {
-        report_warning("%s:  %s  %s ʽת",
-                      context, type_to_string(t2), type_to_string(t1));
-        return 1;
+    int line_count = build_line_table(pcs, pos);
+    for (int i = 0; i < line_count; i++) {
+        mline[i].pc = pcs[i];
+        mline[i].line = pos[i].line;
+        mline[i].col = pos[i].col;
     }
 
-    report_error(50, "%s: Ͳƥ (%s  %s)",
-                context, type_to_string(t1), type_to_string(t2));
-    return 0;
+    ModuleHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MODULE_MAGIC, 4);
+    h.version = MODULE_VERSION;
+    h.flags = MODULE_PREFUSED;
+    h.code_count = codesIndex;
+    h.const_count = constCount;
+    h.symbol_count = symbolIndex;
+    h.line_count = line_count;
+    h.frame_size = frame;
+    h.code_off = sizeof(h);
+    unsigned int code_end = h.code_off + codesIndex * sizeof(ModuleInstr);
+    h.const_off = (code_end + 7) & ~7u;         // double按8字节对齐
+    h.symbol_off = h.const_off + constCount * sizeof(double);
+    h.line_off = h.symbol_off + symbolIndex * sizeof(ModuleSymbol);
+    h.str_off = h.line_off + line_count * sizeof(ModuleLine);
+    h.str_size = str_size;
+    h.file_size = h.str_off + str_size;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return 1;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(mcode, sizeof(ModuleInstr), codesIndex, f) == (size_t)codesIndex &&
+             fwrite(pad, 1, h.const_off - code_end, f) == h.const_off - code_end &&
+             fwrite(const_pool, sizeof(double), constCount, f) == (size_t)constCount &&
+             fwrite(msym, sizeof(ModuleSymbol), symbolIndex, f) == (size_t)symbolIndex &&
+             fwrite(mline, sizeof(ModuleLine), line_count, f) == (size_t)line_count &&
+             fwrite(strtab, 1, str_size, f) == str_size;
+    if (fclose(f) != 0) ok = 0;
+    return ok ? 0 : 1;
 }
 
-int check_variable_initialized(char *name) {
-    int pos;
-    if (lookup_current_scope(name, &pos) == 0 && symbol[pos].kind == variable) {
-        return symbol[pos].initialized;
-    }
-    return 1;
-}
+// ===================== 循环跳转回填 =====================
+// 每层循环一个上下文，break/continue先生成目标未定的BR，
+// 这些BR经操作数串成回填链（-1为链尾），循环结束时统一填入目标。
+// 循环上下文随"loop"作用域进出，与in_loop计数保持一致。
 
-void mark_variable_initialized(char *name) {
-    int pos;
-    if (lookup_current_scope(name, &pos) == 0 && symbol[pos].kind == variable) {
-        symbol[pos].initialized = 1;
-    }
+#define MAX_LOOP_DEPTH MAX_SCOPE_LEVEL
+
+typedef struct {
+    char label[64];         // 循环标号，无标号为空串
+    int break_list;         // 待回填的break链
+    int continue_list;      // 待回填的continue链
+} LoopContext;
+
+LoopContext loop_stack[MAX_LOOP_DEPTH];
+int loop_top = 0;
+char pending_label[64] = "";    // 已读入、等待下一个循环认领的标号
+
+void loop_push() {
+    if (loop_top >= MAX_LOOP_DEPTH) return;
+    LoopContext *lc = &loop_stack[loop_top++];
+    strcpy(lc->label, pending_label);
+    lc->break_list = -1;
+    lc->continue_list = -1;
+    pending_label[0] = '\0';
 }
 
-enum DataType get_variable_type(char *name) {
-    int pos;
-    if (lookup_current_scope(name, &pos) == 0) {
-        return symbol[pos].type;
-    }
-    return TYPE_UNKNOWN;
+void loop_pop() {
+    if (loop_top > 0) loop_top--;
 }
 
-// 飺Ƿѭ
-void check_in_loop(const char *statement) {
-    if (in_loop == 0) {
-        report_error(61, "%s 䲻ѭڲ", statement);
+// 按标号查找循环上下文，label为空串时取最内层循环；找不到返回-1
+int find_loop(const char *label) {
+    if (label[0] == '\0') return loop_top - 1;
+    for (int i = loop_top - 1; i >= 0; i--) {
+        if (strcmp(loop_stack[i].label, label) == 0) return i;
     }
+    return -1;
 }
 
-// ===================== űǿ =====================
+// 生成一条目标待定的BR并挂到回填链上
+void gen_jump_to_list(int *list) {
+    int cx = codesIndex;
+    gen_code("BR", *list);
+    if (codesIndex > cx) *list = cx;
+}
 
-int lookup_current_scope(char *name, int *pPosition) {
-    int i;
-    for (i = symbolIndex - 1; i >= 0; i--) {
-        if (symbol[i].scope_level <= current_scope_level &&
-            strcmp(symbol[i].name, name) == 0) {
-            *pPosition = i;
-            return 0;
-            }
+void backpatch(int list, int target) {
+    while (list >= 0 && list < codesIndex) {
+        int next = codes[list].operand;
+        codes[list].operand = target;
+        list = next;
     }
+}
 
-    // ֻش룬Զ
-    // õ߾Ƿ񱨸
-    return 23;  // 23ʾδҵ
+// 循环代码生成完毕：break指向循环出口，continue指向条件判断或增量部分
+void loop_close(int break_target, int continue_target) {
+    if (loop_top <= 0) return;
+    LoopContext *lc = &loop_stack[loop_top - 1];
+    backpatch(lc->break_list, break_target);
+    backpatch(lc->continue_list, continue_target);
+    lc->break_list = lc->continue_list = -1;
 }
 
-// ȫֲҷ
-int lookup_global(char *name, int *pPosition) {
-    int i;
-    for (i = symbolIndex - 1; i >= 0; i--) {
-        if (strcmp(symbol[i].name, name) == 0) {
-            *pPosition = i;
-            return 0;
+// 跳转链穿透：目标是无条件BR的跳转直接改到最终目标
+int thread_jumps(Code *c, int n) {
+    int threaded = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (strcmp(c[i].opt, "BR") != 0 && strcmp(c[i].opt, "BRF") != 0) continue;
+        int target = c[i].operand, steps = 0;
+        while (target >= 0 && target < n && strcmp(c[target].opt, "BR") == 0 &&
+               c[target].operand != target && steps < n) {
+            target = c[target].operand;
+            steps++;
+        }
+        if (target != c[i].operand) {
+            c[i].operand = target;
+            threaded++;
         }
     }
-    return 23;
+    return threaded;
 }
 
-// ŵű
-int insert_Symbol(enum Category_symbol category, char *name, enum DataType type,
-                  int is_array, int array_dim, int *array_sizes, int is_param) {
-    int i, es = 0;
+// ===================== 中间代码优化（SSA） =====================
+// 把栈式中间代码按基本块符号执行，转换为SSA形式（按需构造phi），
+// 在SSA上做全局值编号（公共子表达式消除）、复制传播和稀疏条件常量传播，
+// 再降级回栈式代码，最后根据活跃变量删除死存储。
+// 遇到无法处理的情况（未知指令、跨基本块的栈值等）就放弃优化，保留原代码。
 
-    if (symbolIndex >= maxsymbolIndex) {
-        report_error(21, "ű");
-        return 21;
-    }
+#ifndef OPT_LEVEL
+#define OPT_LEVEL 1         // 编译时用 -DOPT_LEVEL=0 关闭优化，便于对比
+#endif
 
-    // 鵱ǰظ
-    for (i = symbolIndex - 1; i >= 0; i--) {
-        if (symbol[i].scope_level == current_scope_level &&
-            strcmp(symbol[i].name, name) == 0) {
-            if (symbol[i].kind == category) {
-                if (category == function) {
-                    report_error(32, " %s ظ", name);
-                    es = 32;
-                } else {
-                    report_error(22, " %s ظ", name);
-                    es = 22;
-                }
-            } else {
-                report_error(22, "%s Ƴͻ", name);
-                es = 22;
-            }
-            break;
-        }
-    }
+#define MAX_BLOCKS MAX_CODES
+#define MAX_PREDS 16
+#define MAX_SLOTS 256
+#define MAX_SSA_VALUES 4096
+#define MAX_PHI_ARGS 8192
 
-    if (es > 0) return es;
+// 基本块
+typedef struct {
+    int start, end;         // 指令区间 [start, end)
+    int succ[2];            // succ[0]: 顺序执行/无条件目标，succ[1]: BRF条件为假的目标
+    int nsucc;
+    int pred[MAX_PREDS];
+    int npred;
+} BasicBlock;
 
-    // ·
-    symbol[symbolIndex].kind = category;
-    symbol[symbolIndex].type = type;
-    symbol[symbolIndex].scope_level = current_scope_level;
-    symbol[symbolIndex].line_declared = current_line;
-    symbol[symbolIndex].is_param = is_param;
+BasicBlock bb[MAX_BLOCKS];
+int bbCount = 0;
+int block_of[MAX_CODES];
 
-    if (category == function) {
-        symbol[symbolIndex].initialized = 1;
-    } else {
-        symbol[symbolIndex].initialized = 0;
-        if (!is_param) {
-            symbol[symbolIndex].address = offset;
-            offset++;
-        }
-    }
+// SSA值
+enum SsaKind { SV_CONST, SV_UNDEF, SV_PHI, SV_BIN, SV_NOT, SV_READ, SV_CALL, SV_ARG };
 
-    // Ϣ
-    if (is_array && array_dim > 0) {
-        symbol[symbolIndex].type = TYPE_ARRAY;
-        symbol[symbolIndex].array_info.dimensions = array_dim;
-        for (i = 0; i < array_dim && i < 5; i++) {
-            symbol[symbolIndex].array_info.size[i] = array_sizes[i];
-        }
-    }
+typedef struct {
+    enum SsaKind kind;
+    char op[10];            // BIN/NOT/CALL的操作码
+    int a, b;               // 操作数（SSA值编号）
+    int cval;               // 常量值；CALL为被调函数的符号下标，ARG为第几个实参
+    int block;              // 定义所在基本块（常量为-1）
+    int var;                // PHI/UNDEF/READ对应的变量槽
+    int replaced;           // 被替换成的值，-1表示未被替换
+    int pending;            // 未封闭基本块中的不完整phi
+    int arg_start, arg_count;   // PHI的参数；CALL时栈上的全部值（实参在最上面）
+    int pops, pushes;       // CALL弹出的实参个数、压入的返回值个数
+} SsaValue;
+
+SsaValue ssa[MAX_SSA_VALUES];
+int ssaCount = 0;
+int phi_args[MAX_PHI_ARGS];
+int phiArgCount = 0;
+int ssa_failed = 0;
+int opt_entry_args = 0;     // 入口处已在栈上的实参个数（优化函数体时），main为0
+
+int cur_def[MAX_SLOTS][MAX_BLOCKS];     // 每个基本块中变量的当前定义
+int entry_def[MAX_SLOTS][MAX_BLOCKS];   // 基本块入口处变量的定义
+int slot_used[MAX_SLOTS];
+int sealed[MAX_BLOCKS];
+int ins_val[MAX_CODES];                 // 每条指令对应的SSA值
+int ins_sp[MAX_CODES];                  // 执行每条指令前原代码的栈高
+int ins_stack[MAX_CODES];               // STO/READ时栈上其余的值在phi_args中的起点
+
+// 稀疏条件常量传播的格
+enum { LAT_TOP, LAT_CONST, LAT_BOTTOM };
+int lat[MAX_SSA_VALUES];
+int lat_val[MAX_SSA_VALUES];
+int exec_block[MAX_BLOCKS];
+int exec_edge[MAX_BLOCKS][MAX_PREDS];
+
+int idom[MAX_BLOCKS];
+
+int opt_gvn_count = 0;
+int opt_const_count = 0;
+int opt_dse_count = 0;
+
+int is_binary_op(const char *op) {
+    return strcmp(op, "ADD") == 0 || strcmp(op, "SUB") == 0 ||
+           strcmp(op, "MULT") == 0 || strcmp(op, "DIV") == 0 ||
+           strcmp(op, "GT") == 0 || strcmp(op, "GE") == 0 ||
+           strcmp(op, "LES") == 0 || strcmp(op, "LE") == 0 ||
+           strcmp(op, "EQ") == 0 || strcmp(op, "NOTEQ") == 0 ||
+           strcmp(op, "AND") == 0 || strcmp(op, "OR") == 0;
+}
 
-    strncpy(symbol[symbolIndex].name, name, sizeof(symbol[symbolIndex].name) - 1);
-    symbol[symbolIndex].name[sizeof(symbol[symbolIndex].name) - 1] = '\0';
-    symbolIndex++;
+int is_commutative_op(const char *op) {
+    return strcmp(op, "ADD") == 0 || strcmp(op, "MULT") == 0 ||
+           strcmp(op, "EQ") == 0 || strcmp(op, "NOTEQ") == 0 ||
+           strcmp(op, "AND") == 0 || strcmp(op, "OR") == 0;
+}
 
-    printf(": %s, : %s, : %d\n",
-           name, type_to_string(type), current_scope_level);
-    return 0;
+int is_branch_op(const char *op) {
+    return strcmp(op, "BR") == 0 || strcmp(op, "BRF") == 0;
 }
 
-// ===================== Tokenȡ =====================
+int is_slot_op(const char *op) {
+    return strcmp(op, "LOAD") == 0 || strcmp(op, "STO") == 0 ||
+           strcmp(op, "READ") == 0 || strcmp(op, "WRITE") == 0;
+}
 
-int read_next_token() {
-    char line[512];
-    if (fgets(line, sizeof(line), fpTokenin) == NULL) {
-        token[0] = '\0';
-        token1[0] = '\0';
-        return 0;
-    }
-    line[strcspn(line, "\n")] = '\0';
+// 无副作用、只压入一个值的指令
+int is_pure_op(const char *op) {
+    return strcmp(op, "LOAD") == 0 || strcmp(op, "LOADI") == 0 ||
+           strcmp(op, "NOT") == 0 || is_binary_op(op);
+}
+
+// 调用与返回：优化器只知道弹出、压入几个值，当作不透明的栈操作。
+// 被调函数只能访问自己的帧，不会改动调用者的变量槽
+int is_call_op(const char *op) {
+    return strcmp(op, "CALL") == 0 || strcmp(op, "RET") == 0 ||
+           strcmp(op, "TAILCALL") == 0;
+}
+
+// 执行到这里不再落到下一条指令
+int is_exit_op(const char *op) {
+    return strcmp(op, "STOP") == 0 || strcmp(op, "RET") == 0 ||
+           strcmp(op, "TAILCALL") == 0;
+}
 
-    if (line[0] != '\0') {
-        current_line++;
+// 常量折叠，返回0表示不能折叠（除零）
+int fold_binary(const char *op, int a, int b, int *result) {
+    if (strcmp(op, "ADD") == 0) *result = (int)((unsigned)a + (unsigned)b);
+    else if (strcmp(op, "SUB") == 0) *result = (int)((unsigned)a - (unsigned)b);
+    else if (strcmp(op, "MULT") == 0) *result = (int)((unsigned)a * (unsigned)b);
+    else if (strcmp(op, "DIV") == 0) {
+        if (b == 0) return 0;
+        *result = b == -1 ? (int)(0u - (unsigned)a) : a / b;     // INT_MIN / -1 与虚拟机一样回绕
     }
+    else if (strcmp(op, "GT") == 0) *result = a > b;
+    else if (strcmp(op, "GE") == 0) *result = a >= b;
+    else if (strcmp(op, "LES") == 0) *result = a < b;
+    else if (strcmp(op, "LE") == 0) *result = a <= b;
+    else if (strcmp(op, "EQ") == 0) *result = a == b;
+    else if (strcmp(op, "NOTEQ") == 0) *result = a != b;
+    else if (strcmp(op, "AND") == 0) *result = a && b;
+    else if (strcmp(op, "OR") == 0) *result = a || b;
+    else return 0;
+    return 1;
+}
 
-    char *token_end = line;
-    while (*token_end != ' ' && *token_end != '\t' && *token_end != '\0') {
-        token_end++;
+// 构造控制流图，失败返回非0
+int build_cfg(Code *c, int n) {
+    static int leader[MAX_CODES + 1];
+    int i, b;
+
+    bbCount = 0;
+    if (n <= 0) return 1;
+
+    memset(leader, 0, sizeof(leader));
+    leader[0] = 1;
+    for (i = 0; i < n; i++) {
+        if (is_branch_op(c[i].opt)) {
+            if (c[i].operand < 0 || c[i].operand >= n) return 1;
+            leader[c[i].operand] = 1;
+            leader[i + 1] = 1;
+        } else if (is_exit_op(c[i].opt)) {
+            leader[i + 1] = 1;
+        }
     }
 
-    int type_len = token_end - line;
-    if (type_len > 63) type_len = 63;
+    for (i = 0; i < n; i++) {
+        if (leader[i]) {
+            if (bbCount > 0) bb[bbCount - 1].end = i;
+            bb[bbCount].start = i;
+            bb[bbCount].nsucc = 0;
+            bb[bbCount].npred = 0;
+            bbCount++;
+        }
+        block_of[i] = bbCount - 1;
+    }
+    bb[bbCount - 1].end = n;
+
+    for (b = 0; b < bbCount; b++) {
+        Code *last = &c[bb[b].end - 1];
+        int next = (b + 1 < bbCount) ? b + 1 : -1;
+
+        if (strcmp(last->opt, "BR") == 0) {
+            bb[b].succ[bb[b].nsucc++] = block_of[last->operand];
+        } else if (strcmp(last->opt, "BRF") == 0) {
+            if (next < 0) return 1;
+            bb[b].succ[bb[b].nsucc++] = next;
+            bb[b].succ[bb[b].nsucc++] = block_of[last->operand];
+        } else if (!is_exit_op(last->opt) && next >= 0) {
+            bb[b].succ[bb[b].nsucc++] = next;
+        }
+    }
+
+    for (b = 0; b < bbCount; b++) {
+        for (i = 0; i < bb[b].nsucc; i++) {
+            BasicBlock *s = &bb[bb[b].succ[i]];
+            if (s->npred >= MAX_PREDS) return 1;
+            s->pred[s->npred++] = b;
+        }
+    }
+    return 0;
+}
+
+// 计算支配树（Cooper-Harvey-Kennedy迭代算法），不可达块的idom为-1
+void compute_dominators() {
+    static int order[MAX_BLOCKS], rpo_num[MAX_BLOCKS];
+    static int stack_b[MAX_BLOCKS], stack_k[MAX_BLOCKS], visited[MAX_BLOCKS];
+    int count = 0, sp = 0, i, changed;
+
+    memset(visited, 0, sizeof(visited));
+    for (i = 0; i < bbCount; i++) {
+        idom[i] = -1;
+        rpo_num[i] = -1;
+    }
+
+    // 迭代深度优先搜索求后序
+    stack_b[sp] = 0;
+    stack_k[sp] = 0;
+    sp++;
+    visited[0] = 1;
+    while (sp > 0) {
+        int b = stack_b[sp - 1];
+        if (stack_k[sp - 1] < bb[b].nsucc) {
+            int s = bb[b].succ[stack_k[sp - 1]++];
+            if (!visited[s]) {
+                visited[s] = 1;
+                stack_b[sp] = s;
+                stack_k[sp] = 0;
+                sp++;
+            }
+        } else {
+            order[count++] = b;
+            sp--;
+        }
+    }
+    // 反转为逆后序
+    for (i = 0; i < count / 2; i++) {
+        int t = order[i];
+        order[i] = order[count - 1 - i];
+        order[count - 1 - i] = t;
+    }
+    for (i = 0; i < count; i++) rpo_num[order[i]] = i;
+
+    idom[0] = 0;
+    do {
+        changed = 0;
+        for (i = 1; i < count; i++) {
+            int b = order[i], new_idom = -1, k;
+            for (k = 0; k < bb[b].npred; k++) {
+                int p = bb[b].pred[k];
+                if (idom[p] == -1) continue;
+                if (new_idom == -1) {
+                    new_idom = p;
+                } else {
+                    int x = p, y = new_idom;
+                    while (x != y) {
+                        while (rpo_num[x] > rpo_num[y]) x = idom[x];
+                        while (rpo_num[y] > rpo_num[x]) y = idom[y];
+                    }
+                    new_idom = x;
+                }
+            }
+            if (new_idom != idom[b]) {
+                idom[b] = new_idom;
+                changed = 1;
+            }
+        }
+    } while (changed);
+}
+
+int dominates(int a, int b) {
+    if (a < 0 || b < 0 || idom[b] == -1) return 0;
+    while (b != a) {
+        if (b == 0) return 0;
+        b = idom[b];
+    }
+    return 1;
+}
+
+int ssa_new(enum SsaKind kind, int block) {
+    if (ssaCount >= MAX_SSA_VALUES) {
+        ssa_failed = 1;
+        return 0;
+    }
+    SsaValue *v = &ssa[ssaCount];
+    memset(v, 0, sizeof(*v));
+    v->kind = kind;
+    v->block = block;
+    v->a = v->b = -1;
+    v->var = -1;
+    v->replaced = -1;
+    return ssaCount++;
+}
+
+int ssa_find(int v) {
+    while (ssa[v].replaced != -1) v = ssa[v].replaced;
+    return v;
+}
+
+int ssa_const(int c) {
+    for (int i = 0; i < ssaCount; i++) {
+        if (ssa[i].kind == SV_CONST && ssa[i].cval == c) return i;
+    }
+    int v = ssa_new(SV_CONST, -1);
+    ssa[v].cval = c;
+    return v;
+}
+
+int ssa_undef(int var) {
+    for (int i = 0; i < ssaCount; i++) {
+        if (ssa[i].kind == SV_UNDEF && ssa[i].var == var) return i;
+    }
+    int v = ssa_new(SV_UNDEF, 0);
+    ssa[v].var = var;
+    return v;
+}
+
+int read_variable(int var, int block);
+
+int try_remove_trivial_phi(int phi) {
+    int same = -1, i;
+
+    for (i = 0; i < ssa[phi].arg_count; i++) {
+        int op = ssa_find(phi_args[ssa[phi].arg_start + i]);
+        if (op == same || op == phi) continue;
+        if (same != -1) return phi;     // 至少两个不同的参数，不是平凡phi
+        same = op;
+    }
+    if (same == -1) same = ssa_undef(ssa[phi].var);
+    ssa[phi].replaced = same;
+
+    // 以该phi为参数的其他phi可能也变成了平凡phi
+    for (i = 0; i < ssaCount; i++) {
+        if (ssa[i].kind != SV_PHI || ssa[i].replaced != -1 || ssa[i].pending) continue;
+        for (int k = 0; k < ssa[i].arg_count; k++) {
+            if (phi_args[ssa[i].arg_start + k] == phi) {
+                try_remove_trivial_phi(i);
+                break;
+            }
+        }
+    }
+    return same;
+}
+
+int add_phi_operands(int phi) {
+    int b = ssa[phi].block;
+    int args[MAX_PREDS];
+
+    for (int k = 0; k < bb[b].npred; k++) {
+        args[k] = read_variable(ssa[phi].var, bb[b].pred[k]);
+    }
+    if (phiArgCount + bb[b].npred > MAX_PHI_ARGS) {
+        ssa_failed = 1;
+        return phi;
+    }
+    ssa[phi].arg_start = phiArgCount;
+    ssa[phi].arg_count = bb[b].npred;
+    for (int k = 0; k < bb[b].npred; k++) phi_args[phiArgCount++] = args[k];
+    return try_remove_trivial_phi(phi);
+}
+
+int read_variable(int var, int block) {
+    int v;
+
+    if (cur_def[var][block] != -1) return cur_def[var][block];
+
+    if (!sealed[block]) {
+        // 前驱还没有处理完，先放一个不完整的phi
+        v = ssa_new(SV_PHI, block);
+        ssa[v].var = var;
+        ssa[v].pending = 1;
+    } else if (bb[block].npred == 0) {
+        v = ssa_undef(var);
+    } else if (bb[block].npred == 1) {
+        v = read_variable(var, bb[block].pred[0]);
+    } else {
+        v = ssa_new(SV_PHI, block);
+        ssa[v].var = var;
+        cur_def[var][block] = v;
+        v = add_phi_operands(v);
+    }
+    cur_def[var][block] = v;
+    return v;
+}
+
+void seal_block(int block) {
+    for (int i = 0; i < ssaCount; i++) {
+        if (ssa[i].kind == SV_PHI && ssa[i].block == block && ssa[i].pending) {
+            ssa[i].pending = 0;
+            add_phi_operands(i);
+        }
+    }
+    sealed[block] = 1;
+}
+
+// 记下第i条指令执行时栈上的前n个值（内联在表达式中的函数体改写变量槽时栈上还有值）
+int save_stack(int i, const int *stk, int n) {
+    if (phiArgCount + n > MAX_PHI_ARGS) return 1;
+    ins_stack[i] = phiArgCount;
+    for (int k = 0; k < n; k++) phi_args[phiArgCount++] = stk[k];
+    return 0;
+}
+
+// 符号执行一个基本块，把栈操作转换为SSA值
+int fill_block(int b) {
+    int stk[MAX_CODES];
+    int sp = 0, var;
+
+    for (var = 0; var < MAX_SLOTS; var++) {
+        if (slot_used[var]) entry_def[var][b] = read_variable(var, b);
+    }
+    // 函数入口处实参已在栈上，由随后的STO弹进形参槽位
+    for (int k = 0; b == 0 && k < opt_entry_args; k++) {
+        int v = ssa_new(SV_ARG, b);
+        ssa[v].cval = k;
+        stk[sp++] = v;
+    }
+
+    for (int i = bb[b].start; i < bb[b].end; i++) {
+        const char *op = codes[i].opt;
+        int x = codes[i].operand;
+
+        ins_val[i] = -1;
+        ins_sp[i] = sp;
+        if (strcmp(op, "LOADI") == 0) {
+            ins_val[i] = stk[sp++] = ssa_const(x);
+        } else if (strcmp(op, "LOAD") == 0) {
+            ins_val[i] = stk[sp++] = cur_def[x][b];
+        } else if (strcmp(op, "STO") == 0) {
+            if (sp < 1 || save_stack(i, stk, sp - 1)) return 1;
+            ins_val[i] = cur_def[x][b] = stk[--sp];
+        } else if (is_binary_op(op)) {
+            if (sp < 2) return 1;
+            int v = ssa_new(SV_BIN, b);
+            strcpy(ssa[v].op, op);
+            ssa[v].b = stk[--sp];
+            ssa[v].a = stk[--sp];
+            ins_val[i] = stk[sp++] = v;
+        } else if (strcmp(op, "NOT") == 0) {
+            if (sp < 1) return 1;
+            int v = ssa_new(SV_NOT, b);
+            strcpy(ssa[v].op, op);
+            ssa[v].a = stk[--sp];
+            ins_val[i] = stk[sp++] = v;
+        } else if (strcmp(op, "READ") == 0) {
+            if (save_stack(i, stk, sp)) return 1;
+            int v = ssa_new(SV_READ, b);
+            ssa[v].var = x;
+            ins_val[i] = cur_def[x][b] = v;
+        } else if (strcmp(op, "WRITE") == 0) {
+            ins_val[i] = cur_def[x][b];
+        } else if (strcmp(op, "BRF") == 0) {
+            if (sp < 1) return 1;
+            ins_val[i] = stk[--sp];
+        } else if (strcmp(op, "CALL") == 0 || strcmp(op, "TAILCALL") == 0) {
+            // 记下调用时栈上的全部值：降级时按原顺序先把它们放回栈上再调用
+            int nparams, has_value;
+            if (!func_call_shape(x, &nparams, &has_value) || sp < nparams ||
+                phiArgCount + sp > MAX_PHI_ARGS) return 1;
+            int v = ssa_new(SV_CALL, b);
+            if (ssa_failed) return 1;
+            strcpy(ssa[v].op, op);
+            ssa[v].cval = x;
+            ssa[v].pops = nparams;
+            ssa[v].pushes = has_value && strcmp(op, "CALL") == 0;
+            ssa[v].arg_start = phiArgCount;
+            ssa[v].arg_count = sp;
+            for (int k = 0; k < sp; k++) phi_args[phiArgCount++] = stk[k];
+            sp -= nparams;
+            ins_val[i] = v;
+            if (ssa[v].pushes) stk[sp++] = v;
+        } else if (strcmp(op, "RET") == 0) {
+            if (sp < x) return 1;
+            if (x) ins_val[i] = stk[--sp];
+        } else if (strcmp(op, "BR") != 0 && strcmp(op, "STOP") != 0 &&
+                   strcmp(op, "ENTER") != 0 && strcmp(op, "ALLOC") != 0) {
+            return 1;   // 浮点运算等暂不支持
+        }
+        if (ssa_failed) return 1;
+    }
+    // 块末尾残留的栈值（如无赋值的表达式语句）没有使用者，直接丢弃
+    return 0;
+}
+
+// 全局值编号：按逆后序（支配者先于被支配者）查找等价的值
+void global_value_numbering() {
+    static int done[MAX_SSA_VALUES];
+    static int order[MAX_BLOCKS];
+    int count = 0, i, j, k;
+
+    memset(done, 0, sizeof(done));
+    // 支配树先序：反复挑选idom已处理的块
+    static int placed[MAX_BLOCKS];
+    memset(placed, 0, sizeof(placed));
+    if (idom[0] == 0) {
+        order[count++] = 0;
+        placed[0] = 1;
+    }
+    for (k = 0; k < count; k++) {
+        for (i = 0; i < bbCount; i++) {
+            if (!placed[i] && idom[i] == order[k] && i != 0) {
+                order[count++] = i;
+                placed[i] = 1;
+            }
+        }
+    }
+
+    for (k = 0; k < count; k++) {
+        int b = order[k];
+        for (i = 0; i < ssaCount; i++) {
+            SsaValue *v = &ssa[i];
+            if (v->block != b || v->replaced != -1) continue;
+
+            if (v->kind == SV_BIN || v->kind == SV_NOT) {
+                int a = ssa_find(v->a);
+                int c = (v->kind == SV_BIN) ? ssa_find(v->b) : -1;
+                v->a = a;
+                v->b = c;
+
+                // 常量折叠与代数化简
+                int result;
+                if (v->kind == SV_BIN && ssa[a].kind == SV_CONST && ssa[c].kind == SV_CONST &&
+                    fold_binary(v->op, ssa[a].cval, ssa[c].cval, &result)) {
+                    v->replaced = ssa_const(result);
+                } else if (v->kind == SV_NOT && ssa[a].kind == SV_CONST) {
+                    v->replaced = ssa_const(!ssa[a].cval);
+                } else if (v->kind == SV_BIN && ssa[c].kind == SV_CONST &&
+                           ((ssa[c].cval == 0 && (strcmp(v->op, "ADD") == 0 || strcmp(v->op, "SUB") == 0)) ||
+                            (ssa[c].cval == 1 && (strcmp(v->op, "MULT") == 0 || strcmp(v->op, "DIV") == 0)))) {
+                    v->replaced = a;
+                } else if (v->kind == SV_BIN && ssa[a].kind == SV_CONST &&
+                           ((ssa[a].cval == 0 && strcmp(v->op, "ADD") == 0) ||
+                            (ssa[a].cval == 1 && strcmp(v->op, "MULT") == 0))) {
+                    v->replaced = c;
+                } else {
+                    for (j = 0; j < ssaCount; j++) {
+                        SsaValue *w = &ssa[j];
+                        if (!done[j] || w->replaced != -1 || w->kind != v->kind) continue;
+                        if (strcmp(w->op, v->op) != 0) continue;
+                        if (!(w->a == a && w->b == c) &&
+                            !(is_commutative_op(v->op) && w->a == c && w->b == a)) continue;
+                        if (!dominates(w->block, b)) continue;
+                        v->replaced = j;
+                        opt_gvn_count++;
+                        break;
+                    }
+                }
+            } else if (v->kind == SV_PHI) {
+                // 同一基本块中参数完全相同的phi
+                for (j = 0; j < ssaCount; j++) {
+                    SsaValue *w = &ssa[j];
+                    if (!done[j] || w->replaced != -1 || w->kind != SV_PHI || w->block != b) continue;
+                    int same = (w->arg_count == v->arg_count);
+                    for (int t = 0; same && t < v->arg_count; t++) {
+                        same = ssa_find(phi_args[w->arg_start + t]) == ssa_find(phi_args[v->arg_start + t]);
+                    }
+                    if (same) {
+                        v->replaced = j;
+                        opt_gvn_count++;
+                        break;
+                    }
+                }
+            }
+            done[i] = 1;
+        }
+    }
+}
+
+void mark_edge_executable(int from, int to, int *changed) {
+    for (int k = 0; k < bb[to].npred; k++) {
+        if (bb[to].pred[k] == from && !exec_edge[to][k]) {
+            exec_edge[to][k] = 1;
+            *changed = 1;
+        }
+    }
+    if (!exec_block[to]) {
+        exec_block[to] = 1;
+        *changed = 1;
+    }
+}
+
+void set_lattice(int v, int state, int value, int *changed) {
+    if (lat[v] == state && (state != LAT_CONST || lat_val[v] == value)) return;
+    lat[v] = state;
+    lat_val[v] = value;
+    *changed = 1;
+}
+
+// 稀疏条件常量传播（在小程序上直接迭代到不动点）
+void sparse_conditional_constants() {
+    int changed, i, b;
+
+    memset(exec_block, 0, sizeof(exec_block));
+    memset(exec_edge, 0, sizeof(exec_edge));
+    for (i = 0; i < ssaCount; i++) {
+        lat[i] = LAT_TOP;
+        if (ssa[i].kind == SV_CONST) {
+            lat[i] = LAT_CONST;
+            lat_val[i] = ssa[i].cval;
+        }
+    }
+    exec_block[0] = 1;
+
+    do {
+        changed = 0;
+        for (i = 0; i < ssaCount; i++) {
+            SsaValue *v = &ssa[i];
+            if (v->kind == SV_CONST || v->replaced != -1 || !exec_block[v->block]) continue;
+
+            if (v->kind == SV_UNDEF || v->kind == SV_READ || v->kind == SV_CALL || v->kind == SV_ARG) {
+                set_lattice(i, LAT_BOTTOM, 0, &changed);
+            } else if (v->kind == SV_PHI) {
+                int state = LAT_TOP, value = 0;
+                for (int k = 0; k < v->arg_count; k++) {
+                    if (!exec_edge[v->block][k]) continue;
+                    int a = ssa_find(phi_args[v->arg_start + k]);
+                    if (lat[a] == LAT_BOTTOM ||
+                        (lat[a] == LAT_CONST && state == LAT_CONST && lat_val[a] != value)) {
+                        state = LAT_BOTTOM;
+                        break;
+                    }
+                    if (lat[a] == LAT_CONST) {
+                        state = LAT_CONST;
+                        value = lat_val[a];
+                    }
+                }
+                set_lattice(i, state, value, &changed);
+            } else {
+                int a = ssa_find(v->a);
+                int c = (v->kind == SV_BIN) ? ssa_find(v->b) : a;
+                int result;
+                if (lat[a] == LAT_BOTTOM || lat[c] == LAT_BOTTOM) {
+                    set_lattice(i, LAT_BOTTOM, 0, &changed);
+                } else if (lat[a] == LAT_CONST && lat[c] == LAT_CONST) {
+                    if (v->kind == SV_NOT) {
+                        set_lattice(i, LAT_CONST, !lat_val[a], &changed);
+                    } else if (fold_binary(v->op, lat_val[a], lat_val[c], &result)) {
+                        set_lattice(i, LAT_CONST, result, &changed);
+                    } else {
+                        set_lattice(i, LAT_BOTTOM, 0, &changed);
+                    }
+                }
+            }
+        }
+
+        for (b = 0; b < bbCount; b++) {
+            if (!exec_block[b]) continue;
+            Code *last = &codes[bb[b].end - 1];
+            if (strcmp(last->opt, "BRF") == 0) {
+                int cond = ssa_find(ins_val[bb[b].end - 1]);
+                if (lat[cond] == LAT_CONST) {
+                    mark_edge_executable(b, bb[b].succ[lat_val[cond] ? 0 : 1], &changed);
+                } else if (lat[cond] == LAT_BOTTOM) {
+                    mark_edge_executable(b, bb[b].succ[0], &changed);
+                    mark_edge_executable(b, bb[b].succ[1], &changed);
+                }
+            } else {
+                for (int k = 0; k < bb[b].nsucc; k++) {
+                    mark_edge_executable(b, bb[b].succ[k], &changed);
+                }
+            }
+        }
+    } while (changed);
+}
+
+// 降级回栈式代码
+Code opt_codes[MAX_CODES];
+int optIndex = 0;
+int slot_val[MAX_SLOTS];
+
+SrcPos opt_pos;
+
+// 实际留在栈上的值，与原代码栈底的liveCount个值一一对应：调用前已算出的值和
+// 返回值，以及函数入口处的实参。弹出它们的指令从liveUsed起依次取用
+int live_stack[MAX_CODES];
+int liveCount = 0, liveUsed = 0;
+
+void opt_emit(const char *opt, int operand) {
+    // 栈上的值还没被取走时又压入别的值，次序就乱了
+    if (optIndex >= MAX_CODES || liveUsed < liveCount) {
+        ssa_failed = 1;
+        return;
+    }
+    strcpy(opt_codes[optIndex].opt, opt);
+    opt_codes[optIndex].operand = operand;
+    opt_codes[optIndex].pos = opt_pos;
+    optIndex++;
+}
+
+void emit_value(int v, int hint_var, int depth) {
+    v = ssa_find(v);
+    if (depth > MAX_CODES) {
+        ssa_failed = 1;
+        return;
+    }
+    if (liveUsed < liveCount && live_stack[liveUsed] == v) {
+        liveUsed++;
+        return;
+    }
+    if (lat[v] == LAT_CONST || ssa[v].kind == SV_CONST) {
+        opt_emit("LOADI", lat[v] == LAT_CONST ? lat_val[v] : ssa[v].cval);
+        return;
+    }
+    // 复制传播后，任何持有该值的变量槽都可以直接读取
+    if (hint_var >= 0 && slot_val[hint_var] == v) {
+        opt_emit("LOAD", hint_var);
+        return;
+    }
+    for (int x = 0; x < MAX_SLOTS; x++) {
+        if (slot_used[x] && slot_val[x] == v) {
+            opt_emit("LOAD", x);
+            return;
+        }
+    }
+    if (ssa[v].kind == SV_BIN) {
+        emit_value(ssa[v].a, -1, depth + 1);
+        emit_value(ssa[v].b, -1, depth + 1);
+        opt_emit(ssa[v].op, 0);
+    } else if (ssa[v].kind == SV_NOT) {
+        emit_value(ssa[v].a, -1, depth + 1);
+        opt_emit("NOT", 0);
+    } else {
+        ssa_failed = 1;     // phi/输入值/返回值必须保存在某个变量槽或栈上
+    }
+}
+
+// 求值v是否要用到只保存在变量槽x中的值
+int needs_slot(int v, int x, int depth) {
+    v = ssa_find(v);
+    if (depth > 64) return 1;
+    if (lat[v] == LAT_CONST || ssa[v].kind == SV_CONST) return 0;
+    for (int y = 0; y < MAX_SLOTS; y++) {
+        if (y != x && slot_used[y] && slot_val[y] == v) return 0;
+    }
+    if (ssa[v].kind == SV_BIN) return needs_slot(ssa[v].a, x, depth + 1) || needs_slot(ssa[v].b, x, depth + 1);
+    if (ssa[v].kind == SV_NOT) return needs_slot(ssa[v].a, x, depth + 1);
+    return slot_val[x] == v;
+}
+
+// 第i条指令要改写变量槽x，原代码栈上还有n个值。其中还没算出的值要用到x里的
+// 旧值（如先调用、再内联展开的函数把返回值存进形参）时，按原顺序先算出来留在栈上
+void keep_stack_values(int i, int x, int n) {
+    int p, need = 0;
+    for (p = liveCount; p < n && !need; p++) need = needs_slot(phi_args[ins_stack[i] + p], x, 0);
+    for (p = liveCount; p < n && need; p++) {
+        int v = ssa_find(phi_args[ins_stack[i] + p]);
+        emit_value(v, -1, 0);
+        live_stack[liveCount++] = v;
+        liveUsed = liveCount;
+    }
+}
+
+int lower_from_ssa() {
+    static int new_start[MAX_BLOCKS];
+    int b, x;
+
+    optIndex = 0;
+    for (b = 0; b < bbCount; b++) {
+        new_start[b] = -1;
+        if (!exec_block[b]) continue;
+        new_start[b] = optIndex;
+
+        for (x = 0; x < MAX_SLOTS; x++) {
+            slot_val[x] = slot_used[x] ? ssa_find(entry_def[x][b]) : -1;
+        }
+        liveCount = 0;
+        for (x = 0; b == 0 && x < ssaCount; x++) {
+            if (ssa[x].kind == SV_ARG) live_stack[ssa[x].cval] = x;
+        }
+        if (b == 0) liveCount = opt_entry_args;
+
+        for (int i = bb[b].start; i < bb[b].end; i++) {
+            const char *op = codes[i].opt;
+            int operand = codes[i].operand;
+            opt_pos = codes[i].pos;         // 按需重新生成的表达式归到使用它的指令的位置
+
+            // 这条指令弹出的最低栈位置，栈上从这里往上的值都要由它取走
+            int d = liveCount;
+            if (strcmp(op, "STO") == 0 || strcmp(op, "BRF") == 0) d = ins_sp[i] - 1;
+            else if (strcmp(op, "RET") == 0) d = ins_sp[i] - operand;
+            else if (strcmp(op, "CALL") == 0 || strcmp(op, "TAILCALL") == 0) d = 0;
+            liveUsed = d < liveCount ? d : liveCount;
+
+            if (strcmp(op, "STO") == 0) {
+                int v = ssa_find(ins_val[i]);
+                int hint = -1;
+                if (i > 0 && strcmp(codes[i - 1].opt, "LOAD") == 0) hint = codes[i - 1].operand;
+                keep_stack_values(i, operand, d);
+                emit_value(v, hint, 0);
+                opt_emit("STO", operand);
+                slot_val[operand] = v;
+            } else if (strcmp(op, "READ") == 0) {
+                keep_stack_values(i, operand, ins_sp[i]);
+                opt_emit("READ", operand);
+                slot_val[operand] = ins_val[i];
+            } else if (strcmp(op, "WRITE") == 0 || strcmp(op, "STOP") == 0 ||
+                       strcmp(op, "ENTER") == 0 || strcmp(op, "ALLOC") == 0) {
+                opt_emit(op, operand);
+            } else if (strcmp(op, "BR") == 0) {
+                opt_emit("BR", bb[b].succ[0]);      // 暂存目标块号，稍后回填
+            } else if (strcmp(op, "BRF") == 0) {
+                int cond = ssa_find(ins_val[i]);
+                if (lat[cond] == LAT_CONST) {
+                    opt_const_count++;
+                    if (!lat_val[cond]) opt_emit("BR", bb[b].succ[1]);
+                } else {
+                    emit_value(cond, -1, 0);
+                    opt_emit("BRF", bb[b].succ[1]);
+                }
+            } else if (strcmp(op, "CALL") == 0 || strcmp(op, "TAILCALL") == 0) {
+                // 调用有副作用，就地调用：先按原顺序放回调用时栈上的值
+                SsaValue *v = &ssa[ins_val[i]];
+                int k, below = v->arg_count - v->pops;
+                for (k = 0; k < v->arg_count; k++) emit_value(phi_args[v->arg_start + k], -1, 0);
+                opt_emit(op, operand);
+                for (k = 0; k < below; k++) live_stack[k] = ssa_find(phi_args[v->arg_start + k]);
+                liveCount = below;
+                if (v->pushes) live_stack[liveCount++] = ins_val[i];
+                d = liveUsed = liveCount;
+            } else if (strcmp(op, "RET") == 0) {
+                if (operand) emit_value(ins_val[i], -1, 0);
+                opt_emit("RET", operand);
+            }
+            // LOAD/LOADI/运算指令在被使用处按需生成
+            if (ssa_failed || liveUsed < liveCount) return 1;
+            if (d < liveCount) liveCount = d;
+        }
+        // 块末尾栈上不能留着调用前后的值或没弹出的实参
+        if (liveCount > 0) return 1;
+    }
+
+    for (int i = 0; i < optIndex; i++) {
+        if (is_branch_op(opt_codes[i].opt)) {
+            opt_codes[i].operand = new_start[opt_codes[i].operand];
+            if (opt_codes[i].operand < 0) return 1;
+        }
+    }
+    return 0;
+}
+
+// 删除keep[i]为0的指令，并重定位跳转目标
+void compact_codes(Code *c, int *n, const char *keep) {
+    static int map[MAX_CODES + 1];
+    int i, m = 0;
+
+    for (i = 0; i < *n; i++) {
+        map[i] = m;
+        if (keep[i]) m++;
+    }
+    map[*n] = m;
+    for (i = 0, m = 0; i < *n; i++) {
+        if (!keep[i]) continue;
+        c[m] = c[i];
+        if (is_branch_op(c[m].opt)) c[m].operand = map[c[m].operand];
+        m++;
+    }
+    *n = m;
+}
+
+// 删除跳到下一条指令的BR
+int remove_redundant_jumps(Code *c, int *n) {
+    static char keep[MAX_CODES];
+    int removed = 0;
+
+    for (int i = 0; i < *n; i++) {
+        keep[i] = !(strcmp(c[i].opt, "BR") == 0 && c[i].operand == i + 1);
+        if (!keep[i]) removed++;
+    }
+    if (removed) compact_codes(c, n, keep);
+    return removed;
+}
+
+// 基于活跃变量的死存储删除：STO之后不再被读取的变量，连同其纯计算一起删除
+int eliminate_dead_stores(Code *c, int *n) {
+    static char live_in[MAX_BLOCKS][MAX_SLOTS], live_out[MAX_BLOCKS][MAX_SLOTS];
+    static char live[MAX_SLOTS], keep[MAX_CODES];
+    int b, i, changed, removed = 0;
+
+    for (i = 0; i < *n; i++) {
+        if (!is_pure_op(c[i].opt) && !is_slot_op(c[i].opt) && !is_branch_op(c[i].opt) &&
+            !is_call_op(c[i].opt) && strcmp(c[i].opt, "STOP") != 0 &&
+            strcmp(c[i].opt, "ENTER") != 0 && strcmp(c[i].opt, "ALLOC") != 0) return 0;
+        if (is_slot_op(c[i].opt) && (c[i].operand < 0 || c[i].operand >= MAX_SLOTS)) return 0;
+    }
+    if (build_cfg(c, *n)) return 0;
+
+    memset(live_in, 0, sizeof(live_in));
+    memset(live_out, 0, sizeof(live_out));
+    do {
+        changed = 0;
+        for (b = bbCount - 1; b >= 0; b--) {
+            memset(live, 0, sizeof(live));
+            for (int k = 0; k < bb[b].nsucc; k++) {
+                for (int x = 0; x < MAX_SLOTS; x++) live[x] |= live_in[bb[b].succ[k]][x];
+            }
+            memcpy(live_out[b], live, sizeof(live));
+            for (i = bb[b].end - 1; i >= bb[b].start; i--) {
+                if (strcmp(c[i].opt, "STO") == 0 || strcmp(c[i].opt, "READ") == 0) live[c[i].operand] = 0;
+                else if (strcmp(c[i].opt, "LOAD") == 0 || strcmp(c[i].opt, "WRITE") == 0) live[c[i].operand] = 1;
+            }
+            if (memcmp(live, live_in[b], sizeof(live)) != 0) {
+                memcpy(live_in[b], live, sizeof(live));
+                changed = 1;
+            }
+        }
+    } while (changed);
+
+    memset(keep, 1, sizeof(keep));
+    for (b = 0; b < bbCount; b++) {
+        memcpy(live, live_out[b], sizeof(live));
+        for (i = bb[b].end - 1; i >= bb[b].start; i--) {
+            if (strcmp(c[i].opt, "STO") == 0 && !live[c[i].operand]) {
+                // 向前找到被存储的值的整个计算序列
+                int need = 1, j = i - 1;
+                while (j >= bb[b].start && is_pure_op(c[j].opt)) {
+                    need += is_binary_op(c[j].opt) ? 1 : (strcmp(c[j].opt, "NOT") == 0 ? 0 : -1);
+                    if (need == 0) break;
+                    j--;
+                }
+                if (need == 0) {
+                    for (int t = j; t <= i; t++) keep[t] = 0;
+                    removed++;
+                    i = j;
+                    continue;
+                }
+            }
+            if (strcmp(c[i].opt, "STO") == 0 || strcmp(c[i].opt, "READ") == 0) live[c[i].operand] = 0;
+            else if (strcmp(c[i].opt, "LOAD") == 0 || strcmp(c[i].opt, "WRITE") == 0) live[c[i].operand] = 1;
+        }
+    }
+    if (removed) compact_codes(c, n, keep);
+    return removed;
+}
+
+// SSA上的优化，成功返回0；失败时codes保持不变
+int ssa_optimize() {
+    int i, b;
+
+    ssaCount = 0;
+    phiArgCount = 0;
+    ssa_failed = 0;
+    opt_gvn_count = opt_const_count = opt_dse_count = 0;
+
+    if (build_cfg(codes, codesIndex) || bb[0].npred > 0) {
+        trace("控制流无法分析，跳过SSA优化\n");
+        return 1;
+    }
+
+    memset(slot_used, 0, sizeof(slot_used));
+    for (i = 0; i < codesIndex; i++) {
+        if (is_slot_op(codes[i].opt)) {
+            if (codes[i].operand < 0 || codes[i].operand >= MAX_SLOTS) return 1;
+            slot_used[codes[i].operand] = 1;
+        }
+    }
+    memset(cur_def, -1, sizeof(cur_def));
+    memset(entry_def, -1, sizeof(entry_def));
+    memset(sealed, 0, sizeof(sealed));
+
+    // 按代码顺序填充基本块，前驱全部处理完的块随即封闭
+    static int filled[MAX_BLOCKS];
+    memset(filled, 0, sizeof(filled));
+    if (bb[0].npred == 0) seal_block(0);
+    for (b = 0; b < bbCount && !ssa_failed; b++) {
+        if (fill_block(b)) ssa_failed = 1;
+        filled[b] = 1;
+        for (int s = 0; s < bbCount; s++) {
+            if (sealed[s]) continue;
+            int ready = 1;
+            for (int k = 0; k < bb[s].npred; k++) ready &= filled[bb[s].pred[k]];
+            if (ready) seal_block(s);
+        }
+    }
+    for (b = 0; b < bbCount && !ssa_failed; b++) {
+        if (!sealed[b]) seal_block(b);
+    }
+    if (ssa_failed) {
+        trace("中间代码含有暂不支持的结构，跳过SSA优化\n");
+        return 1;
+    }
+
+    int phi_count = 0;
+    for (i = 0; i < ssaCount; i++) {
+        if (ssa[i].kind == SV_PHI && ssa[i].replaced == -1) phi_count++;
+    }
+
+    compute_dominators();
+    global_value_numbering();
+    if (ssa_failed) return 1;
+    sparse_conditional_constants();
+    for (i = 0; i < ssaCount; i++) {
+        if (lat[i] == LAT_CONST && ssa[i].kind != SV_CONST && ssa[i].replaced == -1) opt_const_count++;
+    }
+
+    if (lower_from_ssa()) {
+        trace("SSA降级失败，保留原中间代码\n");
+        return 1;
+    }
+    remove_redundant_jumps(opt_codes, &optIndex);
+    int removed;
+    while ((removed = eliminate_dead_stores(opt_codes, &optIndex)) > 0) {
+        opt_dse_count += removed;
+        remove_redundant_jumps(opt_codes, &optIndex);
+    }
+
+    memcpy(codes, opt_codes, sizeof(Code) * optIndex);
+    codesIndex = optIndex;
+
+    trace("SSA值 %d 个，phi %d 个，值编号合并 %d 处，常量 %d 处，死存储 %d 处\n",
+           ssaCount, phi_count, opt_gvn_count, opt_const_count, opt_dse_count);
+    return 0;
+}
+
+// ===================== 循环不变代码外提 =====================
+// 由回边（while_stat/for_stat生成的 BR loop_start）找出自然循环，
+// 把循环内只读取循环中未被修改的变量的纯表达式提到循环前置块中计算一次，
+// 结果存入临时变量槽，循环内改为 LOAD 临时变量。
+// 外提的表达式只含 LOAD/LOADI/算术/比较/NOT，不含 READ/WRITE/CALL/STO；
+// 除法只在除数是非零常量时外提，保证提前执行也不会产生运行错误。
+
+#define MIN_HOIST_SIZE 3        // 表达式至少3条指令才值得换成一条LOAD
+
+int loop_member[MAX_BLOCKS];
+int loop_licm_count = 0;
+
+// 中间代码是否只含优化器认识的指令
+int codes_supported(Code *c, int n) {
+    for (int i = 0; i < n; i++) {
+        if (!is_pure_op(c[i].opt) && !is_slot_op(c[i].opt) && !is_branch_op(c[i].opt) &&
+            !is_call_op(c[i].opt) && strcmp(c[i].opt, "STOP") != 0 &&
+            strcmp(c[i].opt, "ENTER") != 0 && strcmp(c[i].opt, "ALLOC") != 0) return 0;
+        if (is_slot_op(c[i].opt) && (c[i].operand < 0 || c[i].operand >= MAX_SLOTS)) return 0;
+    }
+    return 1;
+}
+
+// 求以header为首的自然循环（该header所有回边的并集），没有回边返回0
+int find_natural_loop(int header) {
+    static int work[MAX_BLOCKS];
+    int sp = 0, found = 0;
+
+    memset(loop_member, 0, sizeof(loop_member));
+    loop_member[header] = 1;
+    for (int k = 0; k < bb[header].npred; k++) {
+        int p = bb[header].pred[k];
+        if (!dominates(header, p)) continue;
+        found = 1;
+        if (!loop_member[p]) {
+            loop_member[p] = 1;
+            work[sp++] = p;
+        }
+    }
+    while (sp > 0) {
+        int b = work[--sp];
+        for (int k = 0; k < bb[b].npred; k++) {
+            int q = bb[b].pred[k];
+            if (!loop_member[q] && idom[q] != -1) {
+                loop_member[q] = 1;
+                work[sp++] = q;
+            }
+        }
+    }
+    return found;
+}
+
+// 计算每条纯指令所压入的值对应的表达式起点，不是完整的纯表达式时为-1
+void compute_expr_starts(Code *c, int start, int end, int *expr_start) {
+    for (int i = start; i < end; i++) {
+        expr_start[i] = -1;
+        if (strcmp(c[i].opt, "LOAD") == 0 || strcmp(c[i].opt, "LOADI") == 0) {
+            expr_start[i] = i;
+        } else if (strcmp(c[i].opt, "NOT") == 0) {
+            if (i > start) expr_start[i] = expr_start[i - 1];
+        } else if (is_binary_op(c[i].opt)) {
+            if (i > start && expr_start[i - 1] > start) {
+                expr_start[i] = expr_start[expr_start[i - 1] - 1];
+            }
+        }
+    }
+}
+
+// 表达式 [s, e] 是否可以安全外提
+int is_hoistable(Code *c, int s, int e, const int *expr_start, const char *modified) {
+    for (int i = s; i <= e; i++) {
+        if (!is_pure_op(c[i].opt)) return 0;
+        if (strcmp(c[i].opt, "LOAD") == 0 && modified[c[i].operand]) return 0;
+        if (strcmp(c[i].opt, "DIV") == 0) {
+            if (expr_start[i - 1] != i - 1 || strcmp(c[i - 1].opt, "LOADI") != 0 ||
+                c[i - 1].operand == 0) return 0;
+        }
+    }
+    return 1;
+}
+
+int same_code_range(Code *c, int s1, int e1, int s2, int e2) {
+    if (e1 - s1 != e2 - s2) return 0;
+    for (int i = 0; i <= e1 - s1; i++) {
+        if (strcmp(c[s1 + i].opt, c[s2 + i].opt) != 0 ||
+            c[s1 + i].operand != c[s2 + i].operand) return 0;
+    }
+    return 1;
+}
+
+// 代码编辑：在某处插入直线代码，或把一段纯表达式替换为新代码
+// entry为1的插入作为循环前置块：循环外跳到该位置的分支改跳到插入的代码
+#define MAX_EDITS 64
+
+typedef struct {
+    int start, end;         // 被替换的区间 [start, end)，插入时 start == end
+    int code_start, code_len;
+    int entry;
+} CodeEdit;
+
+CodeEdit edits[MAX_EDITS];
+int editCount = 0;
+Code edit_pool[MAX_CODES];
+SrcPos edit_pos;        // edit_emit生成的指令记在哪个源程序位置
+int editPoolCount = 0;
+int edit_failed = 0;
+
+void edits_reset() {
+    editCount = 0;
+    editPoolCount = 0;
+    edit_failed = 0;
+}
+
+void edit_begin(int start, int end, int entry) {
+    if (editCount >= MAX_EDITS) {
+        edit_failed = 1;
+        return;
+    }
+    edits[editCount].start = start;
+    edits[editCount].end = end;
+    edits[editCount].code_start = editPoolCount;
+    edits[editCount].code_len = 0;
+    edits[editCount].entry = entry;
+    editCount++;
+    edit_pos = codes[start < codesIndex ? start : 0].pos;     // 新生成的指令算在被编辑区段的起点上
+}
+
+void edit_emit(const char *opt, int operand) {
+    if (edit_failed || editPoolCount >= MAX_CODES) {
+        edit_failed = 1;
+        return;
+    }
+    strcpy(edit_pool[editPoolCount].opt, opt);
+    edit_pool[editPoolCount].operand = operand;
+    edit_pool[editPoolCount].pos = edit_pos;
+    editPoolCount++;
+    edits[editCount - 1].code_len++;
+}
+
+void edit_copy(int start, int end) {
+    for (int i = start; i < end; i++) {
+        edit_pos = codes[i].pos;
+        edit_emit(codes[i].opt, codes[i].operand);
+    }
+}
+
+// 应用所有编辑（互不重叠），失败返回非0且codes不变
+int apply_edits() {
+    static Code out[MAX_CODES];
+    static int pos[MAX_CODES + 1], before[MAX_CODES + 1];
+    int i, k, m = 0, ei = 0;
+
+    if (edit_failed) return 1;
+
+    // 按位置排序，同一位置插入在替换之前
+    for (i = 1; i < editCount; i++) {
+        CodeEdit key = edits[i];
+        for (k = i - 1; k >= 0; k--) {
+            int later = edits[k].start > key.start ||
+                        (edits[k].start == key.start && edits[k].end > key.end);
+            if (!later) break;
+            edits[k + 1] = edits[k];
+        }
+        edits[k + 1] = key;
+    }
+
+    for (i = 0; i <= codesIndex; i++) {
+        before[i] = -1;
+        while (ei < editCount && edits[ei].start == i && edits[ei].end == i) {
+            if (edits[ei].entry && before[i] < 0) before[i] = m;
+            if (m + edits[ei].code_len > MAX_CODES) return 1;
+            for (k = 0; k < edits[ei].code_len; k++) out[m++] = edit_pool[edits[ei].code_start + k];
+            ei++;
+        }
+        if (i == codesIndex) break;
+        if (ei < editCount && edits[ei].start == i) {
+            if (m + edits[ei].code_len > MAX_CODES) return 1;
+            for (k = i; k < edits[ei].end; k++) pos[k] = m;
+            for (k = 0; k < edits[ei].code_len; k++) out[m++] = edit_pool[edits[ei].code_start + k];
+            i = edits[ei].end - 1;
+            ei++;
+            continue;
+        }
+        if (m >= MAX_CODES) return 1;
+        pos[i] = m;
+        out[m++] = codes[i];
+    }
+    pos[codesIndex] = m;
+
+    for (i = 0; i < codesIndex; i++) {
+        if (!is_branch_op(codes[i].opt) || strcmp(out[pos[i]].opt, codes[i].opt) != 0) continue;
+        int target = codes[i].operand;
+        if (before[target] >= 0 && !loop_member[block_of[i]]) out[pos[i]].operand = before[target];
+        else out[pos[i]].operand = pos[target];
+    }
+
+    memcpy(codes, out, sizeof(Code) * m);
+    codesIndex = m;
+    return 0;
+}
+
+// 循环中被赋值（STO/READ）的变量
+void collect_modified_slots(char *modified) {
+    memset(modified, 0, MAX_SLOTS);
+    for (int b = 0; b < bbCount; b++) {
+        if (!loop_member[b]) continue;
+        for (int i = bb[b].start; i < bb[b].end; i++) {
+            if (strcmp(codes[i].opt, "STO") == 0 || strcmp(codes[i].opt, "READ") == 0) {
+                modified[codes[i].operand] = 1;
+            }
+        }
+    }
+}
+
+// 前置块插在header之前；header前一块如果属于循环且顺序落入header，无法插入
+int can_insert_preheader(int header) {
+    int h = bb[header].start;
+    return !(h > 0 && loop_member[block_of[h - 1]] &&
+             strcmp(codes[h - 1].opt, "BR") != 0 && !is_exit_op(codes[h - 1].opt));
+}
+
+// 外提一个循环中的不变表达式，返回外提的表达式个数
+int hoist_loop(int header) {
+    static char modified[MAX_SLOTS];
+    static int expr_start[MAX_CODES];
+    static int cand_start[MAX_CODES], cand_end[MAX_CODES], cand_temp[MAX_CODES];
+    int ncand = 0, b, i, k;
+
+    if (!can_insert_preheader(header)) return 0;
+
+    collect_modified_slots(modified);
+    for (b = 0; b < bbCount; b++) {
+        if (loop_member[b]) compute_expr_starts(codes, bb[b].start, bb[b].end, expr_start);
+    }
+
+    // 在每个循环块中从后往前找最大的不变表达式
+    for (b = 0; b < bbCount; b++) {
+        if (!loop_member[b]) continue;
+        for (i = bb[b].end - 1; i >= bb[b].start; i--) {
+            int s = is_pure_op(codes[i].opt) ? expr_start[i] : -1;
+            if (s < 0) continue;
+            // 紧跟BRF的比较在虚拟机里与BRF合成一条，外提后BRF要单独执行
+            int size = i - s + 1;
+            if (is_compare_opt(codes[i].opt) && i + 1 < codesIndex &&
+                strcmp(codes[i + 1].opt, "BRF") == 0) size--;
+            if (size < MIN_HOIST_SIZE || !is_hoistable(codes, s, i, expr_start, modified)) continue;
+
+            cand_start[ncand] = s;
+            cand_end[ncand] = i;
+            cand_temp[ncand] = -1;
+            for (k = 0; k < ncand; k++) {
+                if (same_code_range(codes, cand_start[k], cand_end[k], s, i)) {
+                    cand_temp[ncand] = cand_temp[k];
+                    break;
+                }
+            }
+            if (cand_temp[ncand] == -1) {
+                cand_temp[ncand] = new_frame_temp();
+                if (cand_temp[ncand] >= MAX_SLOTS) return 0;
+            }
+            ncand++;
+            i = s;
+        }
+    }
+    if (ncand == 0) return 0;
+
+    // 前置块中每个不同的临时变量计算一次
+    edits_reset();
+    edit_begin(bb[header].start, bb[header].start, 1);
+    for (k = 0; k < ncand; k++) {
+        int first = 1;
+        for (int t = 0; t < k; t++) first &= (cand_temp[t] != cand_temp[k]);
+        if (!first) continue;
+        edit_copy(cand_start[k], cand_end[k] + 1);
+        edit_emit("STO", cand_temp[k]);
+    }
+    for (k = 0; k < ncand; k++) {
+        edit_begin(cand_start[k], cand_end[k] + 1, 0);
+        edit_emit("LOAD", cand_temp[k]);
+    }
+    return apply_edits() ? 0 : ncand;
+}
+
+int loop_invariant_code_motion() {
+    int hoisted = 0;
+
+    for (int round = 0; round < MAX_BLOCKS; round++) {
+        if (!codes_supported(codes, codesIndex) || build_cfg(codes, codesIndex)) break;
+        compute_dominators();
+
+        // 内层循环的header在代码中靠后，先处理内层
+        int n = 0;
+        for (int h = bbCount - 1; h >= 0 && n == 0; h--) {
+            if (find_natural_loop(h)) n = hoist_loop(h);
+        }
+        if (n == 0) break;
+        hoisted += n;
+    }
+    return hoisted;
+}
+
+// ===================== 归纳变量强度削弱与循环展开 =====================
+// 基本归纳变量：循环内唯一一次赋值为 i = i + c（或 i - c），
+// 且该赋值所在块支配所有回边，即每次迭代恰好执行一次。
+// 强度削弱把循环中的 i * k（k为常量或循环不变变量）换成临时变量 t，
+// 前置块中 t = i * k，每次 i 增加后 t 增加 k * c。
+// 每次迭代更新t需要4条指令，每处使用节省2条，2处使用时每趟持平、前置块
+// 白白多出4到8条，所以至少3处使用才削弱。
+// 计数循环 for (i = a; i < N; i = i + c) 在迭代次数可知（a、N为常量，或有
+// 剖析数据）且够主循环走两趟时按UNROLL_FACTOR（剖析数据另选）展开，
+// 原循环保留作为余数循环。
+
+#ifndef UNROLL_FACTOR
+#define UNROLL_FACTOR 4
+#endif
+#define UNROLL_MAX_BODY 40      // 循环体超过这么多条指令就不展开
+#define SR_MIN_USES 3
+
+int loop_sr_count = 0;
+int loop_unroll_count = 0;
+
+// 当前循环内是否还有内层循环
+int loop_is_innermost(int header) {
+    for (int b = 0; b < bbCount; b++) {
+        if (!loop_member[b] || b == header) continue;
+        for (int k = 0; k < bb[b].npred; k++) {
+            int q = bb[b].pred[k];
+            if (loop_member[q] && dominates(b, q)) return 0;
+        }
+    }
+    return 1;
+}
+
+// 判断var是否为当前循环的基本归纳变量，返回赋值指令位置，不是返回-1
+int find_induction_var(int header, int var, int *step) {
+    int pos = -1;
+
+    for (int b = 0; b < bbCount; b++) {
+        if (!loop_member[b]) continue;
+        for (int i = bb[b].start; i < bb[b].end; i++) {
+            if (strcmp(codes[i].opt, "READ") == 0 && codes[i].operand == var) return -1;
+            if (strcmp(codes[i].opt, "STO") != 0 || codes[i].operand != var) continue;
+            if (pos >= 0) return -1;
+            pos = i;
+        }
+    }
+    if (pos < 0 || pos - 3 < bb[block_of[pos]].start) return -1;
+
+    // LOAD var; LOADI c; ADD/SUB; STO var   或   LOADI c; LOAD var; ADD; STO var
+    Code *c = &codes[pos - 3];
+    int load_first = strcmp(c[0].opt, "LOAD") == 0 && c[0].operand == var &&
+                     strcmp(c[1].opt, "LOADI") == 0;
+    int const_first = strcmp(c[0].opt, "LOADI") == 0 &&
+                      strcmp(c[1].opt, "LOAD") == 0 && c[1].operand == var &&
+                      strcmp(c[2].opt, "ADD") == 0;
+    if (load_first && strcmp(c[2].opt, "ADD") == 0) *step = c[1].operand;
+    else if (load_first && strcmp(c[2].opt, "SUB") == 0) *step = -c[1].operand;
+    else if (const_first) *step = c[0].operand;
+    else return -1;
+    if (*step == 0) return -1;
+
+    // 赋值所在块必须支配所有回边
+    for (int k = 0; k < bb[header].npred; k++) {
+        int latch = bb[header].pred[k];
+        if (loop_member[latch] && !dominates(block_of[pos], latch)) return -1;
+    }
+    return pos;
+}
+
+// 对一个循环做强度削弱，返回削弱的乘法个数
+int strength_reduce_loop(int header) {
+    static char modified[MAX_SLOTS];
+    static int expr_start[MAX_CODES], use_pos[MAX_CODES];
+    int b, i, step, nuse = 0;
+
+    if (!can_insert_preheader(header) || !loop_is_innermost(header)) return 0;
+    collect_modified_slots(modified);
+    for (b = 0; b < bbCount; b++) {
+        if (loop_member[b]) compute_expr_starts(codes, bb[b].start, bb[b].end, expr_start);
+    }
+
+    // 找第一个 i * k 形式的乘法，再收集同一 (i, k) 的所有使用
+    int iv = -1, iv_pos = -1, factor_op = 0, factor = 0;
+    for (b = 0; b < bbCount && iv < 0; b++) {
+        if (!loop_member[b]) continue;
+        for (i = bb[b].start + 2; i < bb[b].end && iv < 0; i++) {
+            if (strcmp(codes[i].opt, "MULT") != 0 || expr_start[i] != i - 2) continue;
+            for (int side = 0; side < 2; side++) {
+                Code *v = &codes[i - 2 + side], *f = &codes[i - 1 - side];
+                if (strcmp(v->opt, "LOAD") != 0 || !modified[v->operand]) continue;
+                int is_const = strcmp(f->opt, "LOADI") == 0;
+                if (!is_const && !(strcmp(f->opt, "LOAD") == 0 && !modified[f->operand])) continue;
+                int p = find_induction_var(header, v->operand, &step);
+                if (p < 0) continue;
+                iv = v->operand;
+                iv_pos = p;
+                factor_op = is_const;
+                factor = f->operand;
+                break;
+            }
+        }
+    }
+    if (iv < 0) return 0;
+
+    for (b = 0; b < bbCount; b++) {
+        if (!loop_member[b]) continue;
+        for (i = bb[b].start + 2; i < bb[b].end; i++) {
+            if (strcmp(codes[i].opt, "MULT") != 0 || expr_start[i] != i - 2) continue;
+            if (i > iv_pos - 3 && i <= iv_pos) continue;
+            const char *fop = factor_op ? "LOADI" : "LOAD";
+            for (int side = 0; side < 2; side++) {
+                Code *v = &codes[i - 2 + side], *f = &codes[i - 1 - side];
+                if (strcmp(v->opt, "LOAD") == 0 && v->operand == iv &&
+                    strcmp(f->opt, fop) == 0 && f->operand == factor) {
+                    use_pos[nuse++] = i;
+                    break;
+                }
+            }
+        }
+    }
+    if (nuse < SR_MIN_USES) return 0;
+
+    int t = new_frame_temp();
+    int s = factor_op ? -1 : new_frame_temp();
+    if (t >= MAX_SLOTS || s >= MAX_SLOTS) return 0;
+
+    edits_reset();
+    edit_begin(bb[header].start, bb[header].start, 1);
+    edit_emit("LOAD", iv);
+    edit_emit(factor_op ? "LOADI" : "LOAD", factor);
+    edit_emit("MULT", 0);
+    edit_emit("STO", t);
+    if (!factor_op) {
+        edit_emit("LOAD", factor);
+        edit_emit("LOADI", step);
+        edit_emit("MULT", 0);
+        edit_emit("STO", s);
+    }
+    edit_begin(iv_pos + 1, iv_pos + 1, 0);
+    edit_emit("LOAD", t);
+    if (factor_op) edit_emit("LOADI", (int)((unsigned)factor * (unsigned)step));
+    else edit_emit("LOAD", s);
+    edit_emit("ADD", 0);
+    edit_emit("STO", t);
+    for (i = 0; i < nuse; i++) {
+        edit_begin(use_pos[i] - 2, use_pos[i] + 1, 0);
+        edit_emit("LOAD", t);
+    }
+    return apply_edits() ? 0 : nuse;
+}
+
+int induction_strength_reduction() {
+    int reduced = 0;
+
+    for (int round = 0; round < MAX_BLOCKS; round++) {
+        if (!codes_supported(codes, codesIndex) || build_cfg(codes, codesIndex)) break;
+        compute_dominators();
+
+        int n = 0;
+        for (int h = bbCount - 1; h >= 0 && n == 0; h--) {
+            if (find_natural_loop(h)) n = strength_reduce_loop(h);
+        }
+        if (n == 0) break;
+        reduced += n;
+    }
+    return reduced;
+}
+
+// 比较运算两侧交换后的运算符
+const char *swap_compare(const char *op) {
+    if (strcmp(op, "LES") == 0) return "GT";
+    if (strcmp(op, "GT") == 0) return "LES";
+    if (strcmp(op, "LE") == 0) return "GE";
+    if (strcmp(op, "GE") == 0) return "LE";
+    return NULL;
+}
+
+// 计数循环在编译时可知的迭代次数：循环前紧挨着 LOADI a; STO i，上限为常量，
+// 且除回边外没有别处跳到header；不可知时返回-1
+long long known_trip_count(int h, int region_end, int var, const Code *bound, const char *cmp, int step) {
+    if (h < 2 || strcmp(bound->opt, "LOADI") != 0) return -1;
+    if (strcmp(codes[h - 1].opt, "STO") != 0 || codes[h - 1].operand != var ||
+        strcmp(codes[h - 2].opt, "LOADI") != 0 || block_of[h - 2] != block_of[h - 1]) return -1;
+    for (int i = 0; i < codesIndex; i++) {
+        if (is_branch_op(codes[i].opt) && codes[i].operand == h && (i < h || i >= region_end)) return -1;
+    }
+
+    long long a = codes[h - 2].operand, n = bound->operand, span;
+    if (strcmp(cmp, "LES") == 0) span = n - a;
+    else if (strcmp(cmp, "LE") == 0) span = n - a + 1;
+    else if (strcmp(cmp, "GT") == 0) span = a - n;
+    else span = a - n + 1;
+    long long c = step < 0 ? -(long long)step : step;
+    return span <= 0 ? 0 : (span + c - 1) / c;
+}
+
+// 展开以header开始的计数循环，成功返回1
+int unroll_loop(int header) {
+    static char modified[MAX_SLOTS];
+    static Code out[MAX_CODES];
+    int h = bb[header].start, hend = bb[header].end;
+    int region_end = hend, b, i, k, step;
+
+    if (!loop_is_innermost(header)) return 0;
+
+    // 循环必须占据一段连续的代码 [h, region_end)，且最后一条是BR
+    for (b = header; b < bbCount && loop_member[b]; b++) region_end = bb[b].end;
+    for (b = 0; b < bbCount; b++) {
+        if (loop_member[b] && (bb[b].start < h || bb[b].end > region_end)) return 0;
+        if (!loop_member[b] && bb[b].start >= h && bb[b].end <= region_end) return 0;
+    }
+    if (strcmp(codes[region_end - 1].opt, "BR") != 0) return 0;
+    int body_len = region_end - hend;
+    if (body_len > UNROLL_MAX_BODY) return 0;
+    // 含调用的循环体，调用本身的开销远大于省下的循环控制，不展开
+    for (i = hend; i < region_end; i++) {
+        if (strcmp(codes[i].opt, "CALL") == 0) return 0;
+    }
+
+    // header必须是 LOAD i; B; cmp; BRF exit（或 B; LOAD i; cmp; BRF exit）
+    if (hend - h != 4 || strcmp(codes[hend - 1].opt, "BRF") != 0 ||
+        codes[hend - 1].operand != region_end) return 0;
+    collect_modified_slots(modified);
+    Code *c = &codes[h];
+    int iv_side = (strcmp(c[0].opt, "LOAD") == 0 && modified[c[0].operand]) ? 0 : 1;
+    Code *iv = &c[iv_side], *bound = &c[1 - iv_side];
+    if (strcmp(iv->opt, "LOAD") != 0) return 0;
+    if (!(strcmp(bound->opt, "LOADI") == 0 ||
+          (strcmp(bound->opt, "LOAD") == 0 && !modified[bound->operand]))) return 0;
+    const char *cmp = iv_side == 0 ? c[2].opt : swap_compare(c[2].opt);
+    if (cmp == NULL || !swap_compare(cmp)) return 0;
+    if (find_induction_var(header, iv->operand, &step) < 0) return 0;
+    int up = strcmp(cmp, "LES") == 0 || strcmp(cmp, "LE") == 0;
+    if ((up && step < 0) || (!up && step > 0)) return 0;
+
+    // 除header的条件分支外，循环内外之间没有其他跳转
+    for (i = 0; i < codesIndex; i++) {
+        if (!is_branch_op(codes[i].opt) || i == hend - 1) continue;
+        int inside = i >= h && i < region_end;
+        int target = codes[i].operand;
+        int target_inside = target >= h && target < region_end;
+        if (inside && !target_inside) return 0;
+        if (!inside && target_inside && target != h) return 0;
+    }
+
+    long long trips = known_trip_count(h, region_end, iv->operand, bound, cmp, step);
+    int factor = pgo_unroll_factor(hend, body_len, trips);
+    if (factor < 2 || step == 0) return 0;
+
+    // 主循环连走factor趟的条件是 i + (factor-1)*step 仍满足比较，但i加上这个量
+    // 可能溢出回绕。改为把i与上限 N -/+ e 比较（i <= N 即 i < N + 1，差的1从e里
+    // 扣掉，统一成严格比较）：常量上限在编译时求出，越出int范围时主循环一趟
+    // 也走不了，不展开；变量上限由前置块先检查 N -/+ e 会不会越界，越界时
+    // 直接进余数循环，否则把算出的上限存进临时变量
+    long long e = (long long)(factor - 1) * (step < 0 ? -(long long)step : step);
+    if (strcmp(cmp, "LE") == 0 || strcmp(cmp, "GE") == 0) e--;
+    if (e > 0x3fffffff) return 0;
+    long long limit = 0;
+    int lim_slot = -1;
+    if (strcmp(bound->opt, "LOADI") == 0) {
+        limit = up ? (long long)bound->operand - e : (long long)bound->operand + e;
+        if (limit < (int)0x80000000 || limit > 0x7fffffff) return 0;
+    } else if (e > 0) {
+        lim_slot = new_frame_temp();
+        if (lim_slot >= MAX_SLOTS) return 0;
+    }
+    int pre_len = lim_slot >= 0 ? 8 : 0;
+    int check_len = 4;
+    int grow = pre_len + check_len + factor * body_len;
+    if (codesIndex + grow > MAX_CODES) return 0;
+
+    // 新布局：前置块 + 主循环检查 + factor份循环体 + 原循环（余数循环）
+    int m = h;
+    int main_start = h + pre_len;
+    int rem_start = h + grow;
+    memcpy(out, codes, sizeof(Code) * h);
+
+    if (lim_slot >= 0) {
+        out[m++] = *bound;
+        strcpy(out[m].opt, "LOADI");
+        out[m++].operand = up ? (int)((int)0x80000000 + e) : (int)(0x7fffffff - e);
+        strcpy(out[m].opt, up ? "GE" : "LE"); out[m++].operand = 0;
+        strcpy(out[m].opt, "BRF");   out[m++].operand = rem_start;
+        out[m++] = *bound;
+        strcpy(out[m].opt, "LOADI"); out[m++].operand = (int)e;
+        strcpy(out[m].opt, up ? "SUB" : "ADD"); out[m++].operand = 0;
+        strcpy(out[m].opt, "STO");   out[m++].operand = lim_slot;
+    }
+    strcpy(out[m].opt, "LOAD");  out[m++].operand = iv->operand;
+    if (lim_slot >= 0) {
+        strcpy(out[m].opt, "LOAD");  out[m++].operand = lim_slot;
+    } else if (strcmp(bound->opt, "LOADI") == 0) {
+        strcpy(out[m].opt, "LOADI"); out[m++].operand = (int)limit;
+    } else {
+        out[m++] = *bound;
+    }
+    strcpy(out[m].opt, up ? "LES" : "GT"); out[m++].operand = 0;
+    strcpy(out[m].opt, "BRF");   out[m++].operand = rem_start;
+    // 前置块和主循环检查算在循环头那一行，列记为0：剖析时不与余数循环的条件分支混在一起
+    for (i = h; i < m; i++) {
+        out[i].pos.line = codes[h].pos.line;
+        out[i].pos.col = 0;
+    }
+
+    for (k = 0; k < factor; k++) {
+        int copy_start = main_start + check_len + k * body_len;
+        int next_iter = (k + 1 < factor) ? copy_start + body_len : main_start;
+        for (i = hend; i < region_end; i++) {
+            out[m] = codes[i];
+            if (is_branch_op(codes[i].opt)) {
+                int target = codes[i].operand;
+                out[m].operand = (target == h) ? next_iter : copy_start + (target - hend);
+            }
+            m++;
+        }
+    }
+
+    for (i = h; i < codesIndex; i++) {
+        out[m] = codes[i];
+        if (is_branch_op(codes[i].opt)) {
+            int target = codes[i].operand;
+            if (target >= h) out[m].operand = target + grow;
+        }
+        m++;
+    }
+
+    // 循环之前跳到header的分支改跳到前置块（没有前置块时即主循环检查）
+    for (i = 0; i < h; i++) {
+        if (is_branch_op(out[i].opt) && out[i].operand > h) out[i].operand += grow;
+    }
+
+    memcpy(codes, out, sizeof(Code) * m);
+    codesIndex = m;
+    return 1;
+}
+
+int unroll_counted_loops() {
+    static int headers[MAX_BLOCKS];
+    int nheader = 0, unrolled = 0;
+
+    if (UNROLL_FACTOR < 2) return 0;
+    if (!codes_supported(codes, codesIndex) || build_cfg(codes, codesIndex)) return 0;
+    compute_dominators();
+    for (int b = bbCount - 1; b >= 0; b--) {
+        if (find_natural_loop(b)) headers[nheader++] = bb[b].start;
+    }
+
+    // 从后往前展开，前面循环的位置不受影响
+    for (int k = 0; k < nheader; k++) {
+        if (build_cfg(codes, codesIndex)) break;
+        compute_dominators();
+        int header = block_of[headers[k]];
+        if (bb[header].start != headers[k] || !find_natural_loop(header)) continue;
+        unrolled += unroll_loop(header);
+    }
+    return unrolled;
+}
+
+// ===================== 剖析反馈优化 =====================
+// 虚拟机 --profile 运行后写出剖析文件（*.cjprof），按源程序位置记录
+// （关键字用ASCII，与源文件编码无关）：
+//   pos 行:列 = 次数           从该位置开始的一段指令执行的次数
+//   branch 行:列 = 跳转/执行   该位置上的BRF发生跳转的次数和执行次数
+//   call 函数 = 次数           函数被进入的次数
+// 以源程序位置而不是指令序号为键，展开等改变代码布局的优化前后都能对上；
+// 同一位置出现多次（如展开后的各份循环体）时次数相加。
+// 编译时 --profile-use 读入后：按平均迭代次数选展开因子，按分支跳转
+// 比例重排基本块，让热路径顺序执行，按函数进入次数调整内联预算。
+
+#define PGO_MAX_UNROLL 8        // 剖析数据能选的最大展开因子
+#define PGO_MIN_BRANCH 16       // BRF执行不到这么多次不调整布局
+#define MAX_PGO_ENTRIES (MAX_CODES * 4)
+#define MAX_PGO_FUNCS 64
+
+typedef struct {
+    int line, col;
+    long long hits;             // 从这个位置开始的指令执行次数
+    long long taken;            // 这个位置上的BRF跳转次数
+    long long branch_hits;      // 这个位置上的BRF执行次数
+} PgoEntry;
+
+typedef struct {
+    char name[64];
+    long long count;
+} PgoCall;
+
+PgoEntry pgo[MAX_PGO_ENTRIES];
+int pgoCount = 0;
+PgoCall pgo_calls[MAX_PGO_FUNCS];
+int pgoCallCount = 0;
+char pgo_file[260] = "";        // 空串表示没有剖析数据
+int pgo_layout_count = 0;       // 按剖析数据反转的分支数
+
+PgoEntry *pgo_entry(int line, int col, int create) {
+    for (int i = 0; i < pgoCount; i++) {
+        if (pgo[i].line == line && pgo[i].col == col) return &pgo[i];
+    }
+    if (!create || pgoCount >= MAX_PGO_ENTRIES) return NULL;
+    PgoEntry *e = &pgo[pgoCount++];
+    memset(e, 0, sizeof(*e));
+    e->line = line;
+    e->col = col;
+    return e;
+}
+
+// 读入剖析文件，失败返回非0
+int pgo_load(const char *path) {
+    char line[512], name[64];
+    int l, c, dropped = 0;
+    long long a, b;
+
+    pgoCount = pgoCallCount = 0;
+    pgo_file[0] = '\0';
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("打开剖析文件%s错误!\n", path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        PgoEntry *e;
+        if (sscanf(line, "pos %d:%d = %lld", &l, &c, &a) == 3) {
+            if ((e = pgo_entry(l, c, 1)) != NULL) e->hits += a;
+            else dropped++;
+        } else if (sscanf(line, "branch %d:%d = %lld/%lld", &l, &c, &a, &b) == 4) {
+            if ((e = pgo_entry(l, c, 1)) != NULL) {
+                e->taken += a;
+                e->branch_hits += b;
+            } else {
+                dropped++;
+            }
+        } else if (sscanf(line, "call %63s = %lld", name, &a) == 2 && pgoCallCount < MAX_PGO_FUNCS) {
+            strcpy(pgo_calls[pgoCallCount].name, name);
+            pgo_calls[pgoCallCount].count = a;
+            pgoCallCount++;
+        }
+    }
+    fclose(f);
+    if (pgoCount == 0) {
+        printf("剖析文件%s中没有带源程序位置的数据\n", path);
+        return 1;
+    }
+    if (dropped) printf("剖析文件%s过大，%d 项未读入\n", path, dropped);
+    snprintf(pgo_file, sizeof(pgo_file), "%s", path);
+    trace("读入剖析数据 %d 个位置，%d 个函数\n", pgoCount, pgoCallCount);
+    return 0;
+}
+
+// 计数循环的展开因子。有剖析数据时平均迭代次数 = 循环体首条指令的执行
+// 次数 / 条件分支跳出的次数，取2的幂，使展开后的主循环平均至少走两趟（检查
+// 本身有4条指令），且不超过PGO_MAX_UNROLL；迭代太少或从未执行的循环不展开。
+// 没有数据时看编译时可知的迭代次数trips（不可知为-1）：不到UNROLL_FACTOR
+// 的两倍就把因子减半，减到不足2时不展开，省下的循环控制抵不上主循环检查
+int pgo_unroll_factor(int hend, int body_len, long long trips) {
+    int factor = UNROLL_FACTOR;
+    PgoEntry *exit = NULL, *body = NULL;
+    if (pgo_file[0]) {
+        exit = pgo_entry(codes[hend - 1].pos.line, codes[hend - 1].pos.col, 0);
+        body = pgo_entry(codes[hend].pos.line, codes[hend].pos.col, 0);
+    }
+    if (!exit || !body || exit == body || exit->branch_hits == 0 || exit->taken == 0) {
+        while (factor >= 2 && trips < 2 * factor) factor /= 2;
+        return factor >= 2 ? factor : 0;
+    }
+    if (body->hits == 0) return 0;
+
+    trips = body->hits / exit->taken;
+    factor = 1;
+    while (factor * 4 <= trips && factor * 2 <= PGO_MAX_UNROLL &&
+           factor * 2 * body_len <= UNROLL_FACTOR * UNROLL_MAX_BODY) factor *= 2;
+    trace("剖析: 第%d行的循环平均迭代 %lld 次，展开因子 %d\n", codes[hend - 1].pos.line, trips, factor);
+    return factor >= 2 ? factor : 0;
+}
+
+// 整数比较取反（浮点比较遇到NaN时取反不等价，不处理）
+const char *invert_compare(const char *op) {
+    static const char *pairs[][2] = { { "GT", "LE" }, { "LE", "GT" }, { "GE", "LES" },
+                                      { "LES", "GE" }, { "EQ", "NOTEQ" }, { "NOTEQ", "EQ" } };
+    for (int i = 0; i < 6; i++) {
+        if (strcmp(op, pairs[i][0]) == 0) return pairs[i][1];
+    }
+    return NULL;
+}
+
+// 按分支跳转比例重排基本块：从入口起每块后面接它的热后继，
+// BRF多半跳转时把跳转目标接在后面并把比较取反，原来顺序执行的
+// 一侧改由BRF跳过去；后继已排过的块需要时补一条BR。
+// 没有剖析数据的分支保持原来的先后次序。返回反转的分支数
+int pgo_layout() {
+    static int order[MAX_BLOCKS], new_start[MAX_BLOCKS];
+    static char placed[MAX_BLOCKS], hot_target[MAX_BLOCKS];
+    static Code out[MAX_CODES];
+    int b, i, k, n = 0, m = 0, any = 0, inverted = 0;
+
+    if (!pgo_file[0] || !codes_supported(codes, codesIndex) || build_cfg(codes, codesIndex)) return 0;
+
+    for (b = 0; b < bbCount; b++) {
+        int last = bb[b].end - 1;
+        hot_target[b] = 0;
+        placed[b] = 0;
+        if (strcmp(codes[last].opt, "BRF") != 0 || last - 1 < bb[b].start ||
+            !invert_compare(codes[last - 1].opt)) continue;
+        PgoEntry *e = pgo_entry(codes[last].pos.line, codes[last].pos.col, 0);
+        if (e && e->branch_hits >= PGO_MIN_BRANCH && e->taken * 2 > e->branch_hits) {
+            hot_target[b] = 1;
+            any = 1;
+        }
+    }
+    if (!any) return 0;
+
+    // 排定顺序：沿热后继串成链，链断了从最前面未排的块接着排
+    for (b = 0; n < bbCount; ) {
+        if (b < 0 || placed[b]) {
+            for (b = 0; placed[b]; b++) {}
+        }
+        placed[b] = 1;
+        order[n++] = b;
+        const char *op = codes[bb[b].end - 1].opt;
+        int next = -1;
+        if (strcmp(op, "BRF") == 0) {
+            next = (hot_target[b] && !placed[bb[b].succ[1]]) ? bb[b].succ[1] : bb[b].succ[0];
+        } else if (strcmp(op, "BR") != 0 && bb[b].nsucc > 0) {
+            next = bb[b].succ[0];
+        }
+        b = (next >= 0 && !placed[next]) ? next : -1;
+    }
+
+    // 按新顺序输出，跳转目标先记成块号，全部排完再换成指令序号
+    for (k = 0; k < n; k++) {
+        b = order[k];
+        int next = k + 1 < n ? order[k + 1] : -1;
+        if (m + (bb[b].end - bb[b].start) + 1 > MAX_CODES) return 0;
+        new_start[b] = m;
+        for (i = bb[b].start; i < bb[b].end; i++) {
+            out[m] = codes[i];
+            if (is_branch_op(out[m].opt)) out[m].operand = block_of[out[m].operand];
+            m++;
+        }
+        Code *last = &out[m - 1];
+        int fall = -1;
+        if (strcmp(last->opt, "BRF") == 0) {
+            if (next == bb[b].succ[1] && hot_target[b]) {
+                strcpy(out[m - 2].opt, invert_compare(out[m - 2].opt));
+                last->operand = bb[b].succ[0];
+                inverted++;
+            } else {
+                fall = bb[b].succ[0];
+            }
+        } else if (strcmp(last->opt, "BR") != 0 && bb[b].nsucc > 0) {
+            fall = bb[b].succ[0];
+        }
+        if (fall >= 0 && fall != next) {
+            strcpy(out[m].opt, "BR");
+            out[m].operand = fall;
+            out[m].pos = last->pos;
+            m++;
+        }
+    }
+    for (i = 0; i < m; i++) {
+        if (is_branch_op(out[i].opt)) out[i].operand = new_start[out[i].operand];
+    }
+
+    memcpy(codes, out, sizeof(Code) * m);
+    codesIndex = m;
+    return inverted;
+}
+
+void optimize_codes() {
+    for (int i = 0; i < error_count; i++) {
+        if (!error_list[i].is_warning) return;
+    }
+    if (codesIndex == 0 || has_fatal_error) return;
+
+    int before = codesIndex;
+    trace("\n=== 中间代码优化 ===\n");
+
+    ssa_optimize();
+
+    loop_licm_count = loop_invariant_code_motion();
+    if (loop_licm_count > 0) {
+        trace("循环不变代码外提 %d 处\n", loop_licm_count);
+    }
+
+    loop_sr_count = induction_strength_reduction();
+    if (loop_sr_count > 0) {
+        trace("归纳变量强度削弱 %d 处\n", loop_sr_count);
+    }
+
+    loop_unroll_count = unroll_counted_loops();
+    if (loop_unroll_count > 0) {
+        trace("循环展开 %d 个（展开因子 %d%s）\n", loop_unroll_count, UNROLL_FACTOR,
+              pgo_file[0] ? "，按剖析数据调整" : "");
+    }
+
+    pgo_layout_count = pgo_layout();
+    if (pgo_layout_count > 0) {
+        trace("按剖析数据重排基本块，反转分支 %d 处\n", pgo_layout_count);
+    }
+
+    // 临时变量占用帧尾槽位，ENTER的帧大小随之增大
+    if (temp_var_count > 0) {
+        for (int i = 0; i < codesIndex; i++) {
+            if (strcmp(codes[i].opt, "ENTER") == 0) codes[i].operand = frame_size + temp_var_count;
+        }
+    }
+
+    // 展开和外提会产生新的跳转链，展开的各份循环体之间还有跳到下一条的BR
+    thread_jumps(codes, codesIndex);
+    remove_redundant_jumps(codes, &codesIndex);
+
+    trace("中间代码: %d -> %d 条\n", before, codesIndex);
+}
+
+// ===================== 函数与内联 =====================
+// main之前定义的函数：名字(形参:类型, ...):返回类型 { 声明 语句 }，返回类型
+// 省略时为void。调用约定：实参按顺序压入操作数栈，CALL转到函数入口；
+// 函数入口 ENTER 开辟帧后用 STO 把实参逆序弹进形参槽位（形参占槽位1..n），
+// RET 0/RET 1 释放帧并回到调用处，RET 1 的返回值留在栈顶。
+// 函数体最后一条是对另一函数（或自己）的调用、结果直接返回时，CALL+RET
+// 合成 TAILCALL：先释放本帧再转到被调函数，被调函数的ENTER原地复用这块
+// 帧空间，尾递归不增长调用深度。
+//
+// 函数分析完先像main一样单独优化一遍（入口处实参已在栈上，优化器把CALL/RET
+// 当作弹出、压入已知个数的值的不透明指令），再把代码从codes[]移到func_codes[]
+// 保存（跳转目标改为相对函数开头），codesIndex退回原处。
+// 调用处若被调函数不递归、函数体不超过大小预算，就把函数体复制过来：去掉ENTER，槽位k改名为调用者帧中从当前offset起的槽位
+// （此时offset及以后的槽位都空闲），跳转目标按复制位置重定位，RET改成跳到
+// 展开代码末尾，指令保留被调函数的源程序位置。表达式中的调用此时栈上可能
+// 还有别的值，而基本块边界处操作数栈要保持为空，所以只内联不含跳转的函数。
+// 函数体内的调用在分析函数体时已经内联过，所以嵌套调用自底向上展开。
+// 有剖析数据时按被调函数的进入次数调整预算：常调用的放宽，很少调用的收紧。
+// 不能内联的调用生成 CALL 符号下标，main优化完后 link_functions 把仍被
+// 调用的函数接在main之后，操作数改成函数入口的指令序号。
+
+#define MAX_FUNCS 32
+#define MAX_PARAMS 8
+#define INLINE_MAX_SIZE 24      // 函数体不超过这么多条指令才内联
+#define INLINE_HOT_SIZE 96      // 剖析数据表明调用频繁时放宽到这么多条
+#define INLINE_COLD_SIZE 8      // 剖析数据表明很少调用时只内联这么小的
+#define INLINE_HOT_CALLS 1000
+#define INLINE_COLD_CALLS 10
+#define INLINE_MAX_GROWTH 400   // 整个程序因内联增加的指令数上限
+
+typedef struct {
+    int symbol;             // 符号表下标，重名的函数为-1（照常分析，但不保存）
+    int start, len;         // 在func_codes中的区间，第一条是ENTER；分析完之前len为0
+    int frame;              // 帧大小
+    int nparams;
+    enum DataType param_type[MAX_PARAMS];
+    enum DataType ret_type;
+    int recursive;          // 函数体里调用了自己
+    int has_tailcall;       // 含TAILCALL，不能内联
+    int has_branch;         // 含跳转，不能内联到表达式中
+    int local_from, local_to;   // 函数体里声明的局部变量在符号表中的区间
+} FuncInfo;
+
+Code func_codes[MAX_CODES];
+int funcCodeCount = 0;
+FuncInfo funcs[MAX_FUNCS];
+int funcCount = 0;
+FuncInfo *cur_func = NULL;      // 正在分析的函数（main为NULL）
+int inline_count = 0;
+int inline_growth = 0;
+int inline_disabled = 0;        // 内联后代码表放不下，这一遍不内联重新编译
+int inline_overflow = 0;        // 这一遍因内联放不下而中止
+
+// 函数定义开始：登记函数，形参和返回类型随后填入
+FuncInfo *func_begin(int sym) {
+    if (funcCount >= MAX_FUNCS) {
+        report_error(99, "函数表已满");
+        return NULL;
+    }
+    FuncInfo *f = &funcs[funcCount++];
+    memset(f, 0, sizeof(*f));
+    f->symbol = sym;
+    f->ret_type = TYPE_VOID;
+    return f;
+}
+
+// 函数分析完：代码从codes[start]起移到func_codes，返回0成功
+int func_save(FuncInfo *f, int start, int frame) {
+    int len = codesIndex - start;
+    if (funcCodeCount + len > MAX_CODES) {
+        report_error(99, "函数代码表已满");
+        return 99;
+    }
+    fill_code_lines();
+    f->start = funcCodeCount;
+    f->len = len;
+    f->frame = frame;
+    for (int i = 0; i < len; i++) {
+        Code c = codes[start + i];
+        if (is_branch_op(c.opt)) {
+            c.operand -= start;
+            f->has_branch = 1;
+        }
+        func_codes[funcCodeCount++] = c;
+    }
+    codesIndex = start;
+    return 0;
+}
+
+#if OPT_LEVEL > 0
+// 函数体存进函数代码表之前按main的流程单独优化一遍：这时codes[]里只有这个
+// 函数，入口处实参已在栈上。临时变量排在本函数的帧尾，返回优化后的帧大小
+int optimize_function(FuncInfo *f, int start) {
+    if (start != 0) return frame_size;
+    trace("\n优化函数 %s\n", symbol[f->symbol].name);
+    temp_var_count = 0;
+    opt_entry_args = f->nparams;
+    thread_jumps(codes, codesIndex);
+    optimize_codes();
+    opt_entry_args = 0;
+    int frame = frame_size + temp_var_count;
+    temp_var_count = 0;
+    return frame;
+}
+#endif
+
+FuncInfo *func_of_symbol(int sym) {
+    for (int i = 0; i < funcCount; i++) {
+        if (funcs[i].symbol == sym) return &funcs[i];
+    }
+    return NULL;
+}
+
+int func_param_count(int sym) {
+    FuncInfo *f = func_of_symbol(sym);
+    return f ? f->nparams : 0;
+}
+
+// 优化器看CALL：弹出几个实参、是否压入返回值，不认识的函数返回0
+int func_call_shape(int sym, int *nparams, int *has_value) {
+    FuncInfo *f = func_of_symbol(sym);
+    if (!f) return 0;
+    *nparams = f->nparams;
+    *has_value = f->ret_type != TYPE_VOID;
+    return 1;
+}
+
+// 函数体大小预算，按剖析数据中的进入次数调整
+int inline_budget(const char *name) {
+    for (int i = 0; i < pgoCallCount; i++) {
+        if (strcmp(pgo_calls[i].name, name) != 0) continue;
+        if (pgo_calls[i].count >= INLINE_HOT_CALLS) return INLINE_HOT_SIZE;
+        if (pgo_calls[i].count < INLINE_COLD_CALLS) return INLINE_COLD_SIZE;
+        break;
+    }
+    return INLINE_MAX_SIZE;
+}
+
+// want_value为1表示调用在表达式中，结果要留在栈顶。
+// 代码表的预算按链接后的大小算：link_functions最多把已保存的函数体都接在
+// main后面，正在分析的函数体之后也要存进函数代码表，两张表都是MAX_CODES。
+// 放不下时照常生成CALL
+int can_inline(FuncInfo *f, int want_value) {
+#if OPT_LEVEL > 0
+    int body = f->len - 1 + 2 * (f->local_to - f->local_from);     // 加上局部变量清零
+    if (inline_disabled || f->len == 0 || f->recursive || f->has_tailcall) return 0;
+    if (want_value && f->has_branch) return 0;
+    return body <= inline_budget(symbol[f->symbol].name) &&
+           inline_growth + body <= INLINE_MAX_GROWTH &&
+           codesIndex + funcCodeCount + body + 1 < MAX_CODES;
+#else
+    return 0;
+#endif
+}
+
+// 内联时只知道已经生成的代码，之后的代码加上内联展开的部分仍可能放不下。
+// 内联过的程序生成代码前先检查链接后的大小，放不下就停止生成（按致命错误
+// 处理，后面直接写codes[]的地方都不再写），compile_tokens不内联重新编译
+int inline_table_full() {
+    if (inline_count == 0 || codesIndex + funcCodeCount < MAX_CODES) return 0;
+    inline_overflow = 1;
+    has_fatal_error = 1;
+    return 1;
+}
+
+// 把函数体展开在当前位置，实参已在栈顶，由函数开头的STO弹进改名后的形参槽位。
+// RET都跳到展开代码末尾；返回值在表达式中直接留在栈顶（函数不含跳转，只有
+// 末尾一条RET），作语句时存入一个多余的槽位丢弃。
+// 调用时ENTER会清零帧，展开后的槽位却是调用者的，循环里再次展开时还留着
+// 上一次的值，所以先把局部变量清零（在展开处被覆盖的由死存储删除去掉）
+void inline_call(FuncInfo *f, int want_value) {
+    static int newpos[MAX_CODES + 1];
+    int base = offset - 1, at = codesIndex;     // 被调函数的槽位k改名为base + k
+    int rslot = base + f->frame, end;
+
+    for (int i = f->local_from; i < f->local_to; i++) {
+        if (symbol[i].kind != variable) continue;
+        if (is_float_type(symbol[i].type)) gen_code("LOADF", add_float_const(0.0));
+        else gen_code("LOADI", 0);
+        gen_code("STO", base + symbol[i].address);
+    }
+
+    // 先算出每条指令复制后的位置，跳转目标按它重定位
+    int n = codesIndex;
+    for (int i = 1; i < f->len; i++) {
+        Code *c = &func_codes[f->start + i];
+        newpos[i] = n;
+        if (strcmp(c->opt, "RET") == 0) {
+            n += c->operand && !want_value;
+            n += i + 1 < f->len;
+        } else {
+            n++;
+        }
+    }
+    newpos[f->len] = end = n;
+
+    fill_code_lines();
+    for (int i = 1; i < f->len; i++) {
+        Code c = func_codes[f->start + i];
+        if (strcmp(c.opt, "RET") == 0) {
+            if (c.operand && !want_value) {
+                strcpy(c.opt, "STO");
+                c.operand = rslot;
+                codes[codesIndex++] = c;
+            }
+            if (i + 1 < f->len) {
+                strcpy(c.opt, "BR");
+                c.operand = end;
+                codes[codesIndex++] = c;
+            }
+            continue;
+        }
+        if (is_branch_op(c.opt)) c.operand = newpos[c.operand];
+        else if (is_slot_op(c.opt) || strcmp(c.opt, "READF") == 0 || strcmp(c.opt, "WRITEF") == 0)
+            c.operand += base;
+        codes[codesIndex++] = c;
+    }
+    lines_filled = codesIndex;      // 保留被调函数的源程序位置
+    int used = rslot + (f->ret_type != TYPE_VOID && !want_value);
+    if (used > frame_size) frame_size = used;
+
+    inline_count++;
+    inline_growth += codesIndex - at;
+    trace("内联函数 %s（%d 条指令，槽位从 %d 起）\n", symbol[f->symbol].name, codesIndex - at, offset);
+}
+
+// 对CALL/TAILCALL引用的函数按引用顺序接在已有代码之后（新接上的函数里的
+// 调用也照此处理），操作数由符号下标改为函数入口，返回0成功
+int link_functions() {
+    int linked = 0;
+    for (int i = 0; i < codesIndex; i++) {
+        if (strcmp(codes[i].opt, "CALL") != 0 && strcmp(codes[i].opt, "TAILCALL") != 0) continue;
+        FuncInfo *f = func_of_symbol(codes[i].operand);
+        if (!f || f->len == 0) {
+            report_error(99, "调用的函数没有代码");
+            return 99;
+        }
+        SymbolEntry *s = &symbol[f->symbol];
+        if (s->address < 0) {
+            if (codesIndex + f->len > MAX_CODES) {
+                report_error(99, "中间代码表已满");
+                return 99;
+            }
+            s->address = codesIndex;
+            for (int k = 0; k < f->len; k++) {
+                Code c = func_codes[f->start + k];
+                if (is_branch_op(c.opt)) c.operand += s->address;
+                codes[codesIndex++] = c;
+            }
+            linked++;
+        }
+        codes[i].operand = s->address;
+    }
+    lines_filled = codesIndex;
+    if (linked > 0) {
+        thread_jumps(codes, codesIndex);
+        trace("链接函数 %d 个，代码共 %d 条\n", linked, codesIndex);
+    }
+    return 0;
+}
+
+// 输出函数表："函数 名字 = 入口 (形参类型, ...) 返回 类型"，只列出链接进来的函数
+void print_func_table(FILE *out) {
+    int n = 0;
+    for (int i = 0; i < funcCount; i++) {
+        if (funcs[i].symbol >= 0 && symbol[funcs[i].symbol].address > 0) n++;
+    }
+    if (n == 0) return;
+    fprintf(out, "\n函数表: %d 个\n", n);
+    for (int i = 0; i < funcCount; i++) {
+        FuncInfo *f = &funcs[i];
+        if (f->symbol < 0 || symbol[f->symbol].address <= 0) continue;
+        fprintf(out, "函数 %s = %d (", symbol[f->symbol].name, symbol[f->symbol].address);
+        for (int k = 0; k < f->nparams; k++) fprintf(out, "%s%s", k ? ", " : "", type_to_string(f->param_type[k]));
+        fprintf(out, ") 返回 %s\n", type_to_string(f->ret_type));
+    }
+}
+
+// ===================== 语义分析函数 =====================
+
+const char* type_to_string(enum DataType type) {
+    switch (type) {
+        case TYPE_INT: return "int";
+        case TYPE_FLOAT: return "float";
+        case TYPE_DOUBLE: return "double";
+        case TYPE_CHAR: return "char";
+        case TYPE_STRING: return "string";
+        case TYPE_BOOL: return "bool";
+        case TYPE_VOID: return "void";
+        case TYPE_ARRAY: return "array";
+        default: return "unknown";
+    }
+}
+
+// 增强的类型兼容性检查
+int check_type_compatible(enum DataType t1, enum DataType t2, const char *context) {
+    if (t1 == TYPE_UNKNOWN || t2 == TYPE_UNKNOWN) {
+        return 1;
+    }
+
+    if (t1 == t2) return 1;
+
+    // 数组类型检查
+    if (t1 == TYPE_ARRAY || t2 == TYPE_ARRAY) {
+        report_error(50, "%s: 数组类型不能与其他类型混合运算", context);
+        return 0;
+    }
+
+    // 字符串类型特殊处理
+    if (t1 == TYPE_STRING || t2 == TYPE_STRING) {
+        if (t1 != t2) {
+            report_error(50, "%s: 字符串类型只能与字符串类型运算", context);
+            return 0;
+        }
+        return 1;
+    }
+
+    // 布尔类型检查
+    if (t1 == TYPE_BOOL || t2 == TYPE_BOOL) {
+        if (t1 != t2) {
+            report_error(50, "%s: 布尔类型只能与布尔类型运算", context);
+            return 0;
+        }
+        return 1;
+    }
+
+    // 允许的隐式数值类型转换
+    if ((t1 == TYPE_INT && (t2 == TYPE_FLOAT || t2 == TYPE_DOUBLE)) ||
+        (t1 == TYPE_FLOAT && t2 == TYPE_DOUBLE) ||
+        (t1 == TYPE_CHAR && (t2 == TYPE_INT || t2 == TYPE_FLOAT || t2 == TYPE_DOUBLE))) {
+        report_warning("%s: 从 %s 到 %s 的隐式类型转换",
+                      context, type_to_string(t2), type_to_string(t1));
+        return 1;
+    }
+
+    // 反向转换
+    if ((t1 == TYPE_FLOAT && t2 == TYPE_INT) ||
+        (t1 == TYPE_DOUBLE && (t2 == TYPE_INT || t2 == TYPE_FLOAT)) ||
+        (t1 == TYPE_INT && t2 == TYPE_CHAR)) {
+        report_warning("%s: 从 %s 到 %s 的隐式类型转换",
+                      context, type_to_string(t2), type_to_string(t1));
+        return 1;
+    }
+
+    report_error(50, "%s: 类型不匹配 (%s 和 %s)",
+                context, type_to_string(t1), type_to_string(t2));
+    return 0;
+}
+
+// 能取值、赋值的符号：变量和形参
+int is_value_symbol(int pos) {
+    return symbol[pos].kind == variable || symbol[pos].kind == parameter;
+}
+
+int check_variable_initialized(char *name) {
+    int pos;
+    if (lookup_current_scope(name, &pos) == 0 && is_value_symbol(pos)) {
+        return symbol[pos].initialized;
+    }
+    return 1;
+}
+
+void mark_variable_initialized(char *name) {
+    int pos;
+    if (lookup_current_scope(name, &pos) == 0 && is_value_symbol(pos)) {
+        symbol[pos].initialized = 1;
+    }
+}
+
+enum DataType get_variable_type(char *name) {
+    int pos;
+    if (lookup_current_scope(name, &pos) == 0) {
+        return symbol[pos].type;
+    }
+    return TYPE_UNKNOWN;
+}
+
+// 控制流检查：检查是否在循环内
+void check_in_loop(const char *statement) {
+    if (in_loop == 0) {
+        report_error(61, "%s 语句不在循环内部", statement);
+    }
+}
+
+// ===================== 符号表函数（增强） =====================
+
+int lookup_current_scope(char *name, int *pPosition) {
+    int i;
+    STAT_INC(STAT_SYMBOL_LOOKUPS);
+    for (i = symbolIndex - 1; i >= 0; i--) {
+        if (!symbol[i].scope_closed && symbol[i].scope_level <= current_scope_level &&
+            strcmp(symbol[i].name, name) == 0) {
+            *pPosition = i;
+            return 0;
+            }
+    }
+
+    // 只返回错误码，不自动报告错误
+    // 让调用者决定是否报告错误
+    return 23;  // 23表示未找到
+}
+
+// 全局查找符号
+int lookup_global(char *name, int *pPosition) {
+    int i;
+    STAT_INC(STAT_SYMBOL_LOOKUPS);
+    for (i = symbolIndex - 1; i >= 0; i--) {
+        if (strcmp(symbol[i].name, name) == 0) {
+            *pPosition = i;
+            return 0;
+        }
+    }
+    return 23;
+}
+
+// 插入符号到符号表
+int insert_Symbol(enum Category_symbol category, const char *name, enum DataType type,
+                  int is_array, int array_dim, int *array_sizes, int is_param) {
+    int i, es = 0;
+
+    if (symbolIndex >= maxsymbolIndex) {
+        report_error(21, "符号表已满");
+        return 21;
+    }
+
+    // 检查当前作用域重复定义
+    for (i = symbolIndex - 1; i >= 0; i--) {
+        if (!symbol[i].scope_closed && symbol[i].scope_level == current_scope_level &&
+            strcmp(symbol[i].name, name) == 0) {
+            if (symbol[i].kind == category) {
+                if (category == function) {
+                    report_error(32, "函数名 %s 重复定义", name);
+                    es = 32;
+                } else {
+                    report_error(22, "变量名 %s 重复定义", name);
+                    es = 22;
+                }
+            } else {
+                report_error(22, "%s 名称冲突", name);
+                es = 22;
+            }
+            break;
+        }
+    }
+
+    if (es > 0) return es;
+
+    // 插入新符号
+    symbol[symbolIndex].kind = category;
+    symbol[symbolIndex].type = type;
+    symbol[symbolIndex].scope_level = current_scope_level;
+    symbol[symbolIndex].line_declared = current_line;
+    symbol[symbolIndex].is_param = is_param;
+    symbol[symbolIndex].scope_closed = 0;
+
+    if (category == function) {
+        symbol[symbolIndex].initialized = 1;
+    } else {
+        symbol[symbolIndex].initialized = 0;
+        if (!is_param) {
+            symbol[symbolIndex].address = offset;
+            offset++;
+            if (offset > frame_size) frame_size = offset;
+        }
+    }
+
+    // 处理数组信息
+    if (is_array && array_dim > 0) {
+        symbol[symbolIndex].type = TYPE_ARRAY;
+        symbol[symbolIndex].array_info.dimensions = array_dim;
+        for (i = 0; i < array_dim && i < 5; i++) {
+            symbol[symbolIndex].array_info.size[i] = array_sizes[i];
+        }
+    }
+
+    strncpy(symbol[symbolIndex].name, name, sizeof(symbol[symbolIndex].name) - 1);
+    symbol[symbolIndex].name[sizeof(symbol[symbolIndex].name) - 1] = '\0';
+    symbolIndex++;
+    STAT_INC(STAT_SYMBOLS_INSERTED);
+
+    trace("插入符号: %s, 类型: %s, 作用域: %d\n",
+           name, type_to_string(type), current_scope_level);
+    return 0;
+}
+
+// ===================== Token读取函数 =====================
+
+int read_next_token() {
+    char line[512];
+    if (fgets(line, sizeof(line), fpTokenin) == NULL) {
+        token[0] = '\0';
+        token1[0] = '\0';
+        return 0;
+    }
+    line[strcspn(line, "\n")] = '\0';
+
+    char *token_end = line;
+    while (*token_end != ' ' && *token_end != '\t' && *token_end != '\0') {
+        token_end++;
+    }
+
+    int type_len = token_end - line;
+    if (type_len > 63) type_len = 63;
     strncpy(token, line, type_len);
     token[type_len] = '\0';
 
@@ -791,13 +3593,74 @@ int read_next_token() {
         token1[0] = '\0';
     }
 
-    printf("ȡtoken[%d]: type='%s' value='%s'\n", current_line, token, token1);
+    // 词法分析器输出的行尾带有 (行,列)，不属于单词的值
+    char *pos = strrchr(token1, '(');
+    int pos_line, pos_col, pos_len = 0;
+    fill_code_lines();
+    consumed_pos = token_pos;
+    token_pos.line = token_pos.col = 0;
+    if (pos && pos != token1 &&
+        sscanf(pos, "(%d ,%d )%n", &pos_line, &pos_col, &pos_len) == 2 && pos[pos_len] == '\0') {
+        while (pos > token1 && (pos[-1] == ' ' || pos[-1] == '\t')) pos--;
+        *pos = '\0';
+        token_pos.line = pos_line;
+        token_pos.col = pos_col;
+    }
+    // 报错和符号表用的行号：单词流带位置时就是源程序行，否则只能数单词行
+    if (token_pos.line) current_line = token_pos.line;
+    else if (line[0] != '\0') current_line++;
+
+    STAT_INC(STAT_TOKENS);
+    trace("读取token[行%d]: type='%s' value='%s'\n", current_line, token, token1);
     return 1;
 }
 
-// ===================== ָ =====================
+// 预读下一个单词的类型，不移动读取位置
+int peek_token_type(char *type, int size) {
+    char line[512];
+    long pos = ftell(fpTokenin);
+    if (pos < 0 || fgets(line, sizeof(line), fpTokenin) == NULL) {
+        type[0] = '\0';
+        if (pos >= 0) fseek(fpTokenin, pos, SEEK_SET);
+        return 0;
+    }
+    fseek(fpTokenin, pos, SEEK_SET);
+
+    int len = strcspn(line, " \t\r\n");
+    if (len > size - 1) len = size - 1;
+    strncpy(type, line, len);
+    type[len] = '\0';
+    return 1;
+}
+
+// 当前单词是"("时预读到配对的")"，看括号内（不含更深层）有没有&&或||，
+// 有则这对括号是条件分组，按跳转上下文分析
+int paren_has_logic() {
+    char line[512];
+    int depth = 1, found = 0;
+    long pos = ftell(fpTokenin);
+    if (pos < 0) return 0;
+
+    while (depth > 0 && !found && fgets(line, sizeof(line), fpTokenin) != NULL) {
+        char type[8];
+        int len = strcspn(line, " \t\r\n");
+        if (len > 7) len = 7;
+        strncpy(type, line, len);
+        type[len] = '\0';
+
+        if (strcmp(type, "(") == 0) depth++;
+        else if (strcmp(type, ")") == 0) depth--;
+        else if (depth == 1 && (strcmp(type, "&&") == 0 || strcmp(type, "||") == 0)) found = 1;
+        else if (strcmp(type, ";") == 0 || strcmp(type, "{") == 0) break;
+    }
+    fseek(fpTokenin, pos, SEEK_SET);
+    return found;
+}
 
-void skip_to_sync_point() {
+// ===================== 错误恢复函数 =====================
+
+// 返回跳过的token数
+int skip_to_sync_point() {
     int skipped = 0;
 
     while (1) {
@@ -821,120 +3684,495 @@ void skip_to_sync_point() {
     }
 
     if (skipped > 0) {
-        printf(" %d tokenͬ\n", skipped);
+        printf("跳过 %d 个token到同步点\n", skipped);
+    }
+    return skipped;
+}
+
+
+
+// ===================== 编译缓存 =====================
+// 以输入文件内容、编译器版本和编译选项的散列为键，把一次编译要求输出的
+// 全部产物（单词流、语法树、符号表、代码表、二进制模块）打包成缓存目录中的一个条目，
+// 命中时直接还原产物，语法、语义分析和代码生成全部跳过。
+// 条目先写临时文件再rename，多个编译进程共用一个目录也不会读到半个条目；
+// 目录总大小超过上限时按最近使用时间淘汰。只缓存没有任何错误和警告的编译，
+// 命中时才不会漏报诊断。目录由环境变量 CJ_CACHE_DIR 指定，设为 off 关闭缓存。
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_COMPILE_CACHE 1
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#define COMPILER_VERSION "cj 1.0"
+#define CACHE_DEFAULT_DIR ".cjcache"
+#define CACHE_MAX_BYTES (64L * 1024 * 1024)    // 环境变量 CJ_CACHE_MAX 可改（字节）
+#define CACHE_MAGIC "CJCE"
+#define CACHE_MAX_ENTRIES 4096                 // 淘汰时一次最多考察的条目数
+
+const char *cache_suffixes[] = { ".tok", ".ast.txt", ".symbols.txt", ".codes.txt", ".cjm" };
+const int cache_emit_bits[] = { EMIT_TOKENS, EMIT_AST, EMIT_SYMBOLS, EMIT_CODES, EMIT_MODULE };
+#define CACHE_ARTIFACTS ((int)(sizeof(cache_suffixes) / sizeof(cache_suffixes[0])))
+
+char cache_dir[260];
+char cache_key[40];         // 128位散列的十六进制
+int cache_enabled = 0;
+
+// 缓存统计，存在缓存目录的 stats 文件里，加锁后读改写
+enum { CACHE_HIT, CACHE_MISS, CACHE_STORE, CACHE_EVICT, CACHE_COUNTERS };
+
+void hash_bytes(unsigned long long *h, const void *data, size_t n) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < n; i++) {
+        *h ^= p[i];
+        *h *= 0x100000001b3ULL;
+    }
+}
+
+#ifdef HAVE_COMPILE_CACHE
+
+void cache_init(int enabled) {
+    const char *dir = getenv("CJ_CACHE_DIR");
+    cache_enabled = 0;
+    if (!enabled || (dir && strcmp(dir, "off") == 0)) return;
+    snprintf(cache_dir, sizeof(cache_dir), "%s", dir && dir[0] ? dir : CACHE_DEFAULT_DIR);
+    if (mkdir(cache_dir, 0777) != 0 && errno != EEXIST) {
+        printf("无法创建编译缓存目录 %s，本次不使用缓存\n", cache_dir);
+        return;
+    }
+    cache_enabled = 1;
+}
+
+// 键 = 编译器版本 + 影响产物的编译选项 + 单词流文件的全部字节。
+// 编译时间也算进版本里，重新编译过的编译器不会用到旧条目。
+int cache_make_key(FILE *src) {
+    unsigned long long h1 = 0xcbf29ce484222325ULL, h2 = 0x84222325cbf29ce4ULL;
+    char opts[128], buf[4096];
+    size_t n;
+
+    snprintf(opts, sizeof(opts), "%s|%s %s|O%d|U%d|M%d|E%d", COMPILER_VERSION,
+             __DATE__, __TIME__, OPT_LEVEL, UNROLL_FACTOR, MODULE_VERSION, emit_mask);
+    hash_bytes(&h1, opts, strlen(opts) + 1);
+    hash_bytes(&h2, opts, strlen(opts) + 1);
+    // 剖析数据影响优化结果，内容也算进键里
+    FILE *prof = pgo_file[0] ? fopen(pgo_file, "rb") : NULL;
+    if (pgo_file[0] && !prof) return 1;
+    while (prof && (n = fread(buf, 1, sizeof(buf), prof)) > 0) {
+        hash_bytes(&h1, buf, n);
+        hash_bytes(&h2, buf, n);
+    }
+    if (prof) fclose(prof);
+    while ((n = fread(buf, 1, sizeof(buf), src)) > 0) {
+        hash_bytes(&h1, buf, n);
+        hash_bytes(&h2, buf, n);
+        h2 ^= h2 >> 29;     // 两路用不同的初值和混合，组成128位键
+    }
+    if (ferror(src)) return 1;
+    rewind(src);
+    snprintf(cache_key, sizeof(cache_key), "%016llx%016llx", h1, h2);
+    return 0;
+}
+
+void cache_count(int counter, long delta) {
+    char path[512], buf[256];
+    long value[CACHE_COUNTERS] = {0};
+
+    snprintf(path, sizeof(path), "%s/stats", cache_dir);
+    int fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) return;
+    if (flock(fd, LOCK_EX) == 0) {
+        ssize_t len = read(fd, buf, sizeof(buf) - 1);
+        buf[len > 0 ? len : 0] = '\0';
+        sscanf(buf, "hits=%ld misses=%ld stores=%ld evictions=%ld",
+               &value[0], &value[1], &value[2], &value[3]);
+        value[counter] += delta;
+        len = snprintf(buf, sizeof(buf), "hits=%ld misses=%ld stores=%ld evictions=%ld\n",
+                       value[0], value[1], value[2], value[3]);
+        if (lseek(fd, 0, SEEK_SET) == 0 && ftruncate(fd, 0) == 0 && write(fd, buf, len) != len) {
+            printf("编译缓存统计写入失败\n");
+        }
+        flock(fd, LOCK_UN);
+    }
+    close(fd);
+}
+
+// 条目格式：CACHE_MAGIC、产物个数，然后每个产物一段：后缀（16字节）、长度、内容
+int cache_lookup() {
+    char path[512], out[512], suffix[16];
+    unsigned int count, size;
+    static char data[1 << 20];
+
+    snprintf(path, sizeof(path), "%s/%s.cje", cache_dir, cache_key);
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    int ok = fread(suffix, 1, 4, f) == 4 && memcmp(suffix, CACHE_MAGIC, 4) == 0 &&
+             fread(&count, sizeof(count), 1, f) == 1 && count <= (unsigned)CACHE_ARTIFACTS;
+    for (unsigned int i = 0; ok && i < count; i++) {
+        ok = fread(suffix, 1, sizeof(suffix), f) == sizeof(suffix) &&
+             fread(&size, sizeof(size), 1, f) == 1 && size <= sizeof(data) &&
+             fread(data, 1, size, f) == size;
+        if (!ok) break;
+        suffix[sizeof(suffix) - 1] = '\0';
+        snprintf(out, sizeof(out), "%s%s", outbase, suffix);
+        FILE *fo = fopen(out, "wb");
+        ok = fo && fwrite(data, 1, size, fo) == size;
+        if (fo && fclose(fo) != 0) ok = 0;
+    }
+    fclose(f);
+    if (!ok) return 0;          // 坏条目按未命中处理，重新编译后会被覆盖
+    utime(path, NULL);          // 更新修改时间，作为LRU的最近使用时间
+    return 1;
+}
+
+// 命中时还原产物并计数，未命中只计数
+int cache_restore() {
+    if (cache_lookup()) {
+        cache_count(CACHE_HIT, 1);
+        printf("编译缓存命中 %s，产物已还原到 %s.*\n", cache_key, outbase);
+        return 1;
+    }
+    cache_count(CACHE_MISS, 1);
+    return 0;
+}
+
+struct CacheFile {
+    char name[48];
+    long size;
+    time_t used;
+};
+
+int cache_file_older(const void *a, const void *b) {
+    const struct CacheFile *x = (const struct CacheFile *)a, *y = (const struct CacheFile *)b;
+    return x->used < y->used ? -1 : x->used > y->used;
+}
+
+void cache_evict() {
+    static struct CacheFile files[CACHE_MAX_ENTRIES];
+    const char *env = getenv("CJ_CACHE_MAX");
+    long limit = env ? atol(env) : CACHE_MAX_BYTES;
+    long total = 0, self_size = 0;
+    int n = 0, evicted = 0;
+    char path[sizeof(cache_dir) + 1 + sizeof(files[0].name)];    // 目录/条目名，条目名比name短
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s.cje", cache_dir, cache_key);
+    if (stat(path, &st) == 0) self_size = st.st_size;
+
+    DIR *d = opendir(cache_dir);
+    if (!d) return;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL && n < CACHE_MAX_ENTRIES) {
+        size_t len = strlen(e->d_name);
+        if (len < 4 || len >= sizeof(files[n].name) || strcmp(e->d_name + len - 4, ".cje") != 0) continue;
+        if (strncmp(e->d_name, cache_key, strlen(cache_key)) == 0) continue;    // 刚写入的条目保留
+        if (snprintf(path, sizeof(path), "%s/%s", cache_dir, e->d_name) >= (int)sizeof(path) ||
+            stat(path, &st) != 0) continue;
+        strcpy(files[n].name, e->d_name);
+        files[n].size = st.st_size;
+        files[n].used = st.st_mtime;
+        total += st.st_size;
+        n++;
+    }
+    closedir(d);
+
+    qsort(files, n, sizeof(files[0]), cache_file_older);
+    total += self_size;
+    for (int i = 0; i < n && total > limit; i++) {
+        if (snprintf(path, sizeof(path), "%s/%s", cache_dir, files[i].name) >= (int)sizeof(path)) continue;
+        if (unlink(path) == 0) {        // 别的进程可能已经删了，只统计自己删掉的
+            total -= files[i].size;
+            evicted++;
+        }
     }
+    if (evicted > 0) cache_count(CACHE_EVICT, evicted);
 }
 
+void cache_store() {
+    char path[512], tmp[512], in[512], suffix[16];
+    static char data[1 << 20];
+    unsigned int count = 0;
+
+    snprintf(path, sizeof(path), "%s/%s.cje", cache_dir, cache_key);
+    snprintf(tmp, sizeof(tmp), "%s/%s.tmp.%d", cache_dir, cache_key, (int)getpid());
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return;
+
+    int ok = fwrite(CACHE_MAGIC, 1, 4, f) == 4 && fwrite(&count, sizeof(count), 1, f) == 1;
+    for (int i = 0; ok && i < CACHE_ARTIFACTS; i++) {
+        if (!(emit_mask & cache_emit_bits[i])) continue;   // 旧的产物文件不能混进条目
+        snprintf(in, sizeof(in), "%s%s", outbase, cache_suffixes[i]);
+        FILE *fi = fopen(in, "rb");
+        if (!fi) continue;      // 没生成的产物（如空符号表）就不存
+        unsigned int size = fread(data, 1, sizeof(data), fi);
+        ok = !ferror(fi) && feof(fi);
+        fclose(fi);
+        memset(suffix, 0, sizeof(suffix));
+        strncpy(suffix, cache_suffixes[i], sizeof(suffix) - 1);
+        ok = ok && fwrite(suffix, 1, sizeof(suffix), f) == sizeof(suffix) &&
+             fwrite(&size, sizeof(size), 1, f) == 1 && fwrite(data, 1, size, f) == size;
+        count++;
+    }
+    ok = ok && fseek(f, 4, SEEK_SET) == 0 && fwrite(&count, sizeof(count), 1, f) == 1;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return;
+    }
+    cache_count(CACHE_STORE, 1);
+    cache_evict();
+}
+
+int cache_print_stats() {
+    char path[sizeof(cache_dir) + 256], buf[256];
+    long value[CACHE_COUNTERS] = {0};
+    long total = 0;
+    int entries = 0;
+    struct stat st;
+
+    cache_init(1);
+    if (!cache_enabled) {
+        printf("编译缓存已关闭\n");
+        return 0;
+    }
+    snprintf(path, sizeof(path), "%s/stats", cache_dir);
+    FILE *f = fopen(path, "r");
+    if (f) {
+        if (fgets(buf, sizeof(buf), f)) {
+            sscanf(buf, "hits=%ld misses=%ld stores=%ld evictions=%ld",
+                   &value[0], &value[1], &value[2], &value[3]);
+        }
+        fclose(f);
+    }
+    DIR *d = opendir(cache_dir);
+    if (d) {
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            size_t len = strlen(e->d_name);
+            if (len < 4 || strcmp(e->d_name + len - 4, ".cje") != 0) continue;
+            snprintf(path, sizeof(path), "%s/%s", cache_dir, e->d_name);
+            if (stat(path, &st) == 0) {
+                total += st.st_size;
+                entries++;
+            }
+        }
+        closedir(d);
+    }
+
+    long lookups = value[CACHE_HIT] + value[CACHE_MISS];
+    printf("编译缓存目录: %s\n", cache_dir);
+    printf("命中 %ld 次，未命中 %ld 次，命中率 %.1f%%\n", value[CACHE_HIT], value[CACHE_MISS],
+           lookups ? 100.0 * value[CACHE_HIT] / lookups : 0.0);
+    printf("写入 %ld 个条目，淘汰 %ld 个条目\n", value[CACHE_STORE], value[CACHE_EVICT]);
+    printf("现有 %d 个条目，共 %ld 字节\n", entries, total);
+    return 0;
+}
 
+#else
 
-// ===================== Ժ =====================
+void cache_init(int enabled) { cache_enabled = 0; }
+int cache_make_key(FILE *src) { return 1; }
+void cache_count(int counter, long delta) {}
+int cache_lookup() { return 0; }
+int cache_restore() { return 0; }
+void cache_store() {}
+int cache_print_stats() {
+    printf("此平台不支持编译缓存\n");
+    return 0;
+}
+
+#endif
+
+// ===================== 主测试函数 =====================
 int TESTparse() {
-    int es = 0;
-    printf("뵥ļ·");
-    if (scanf("%s", tokenfile) != 1) return 10;
+    char path[sizeof(tokenfile)];
+    printf("请输入单词流文件名（包括路径）：");
+    if (scanf("%259s", path) != 1) return 10;
+    return compile_file(path);
+}
+
+// 编译一个单词流文件，产物写在它旁边
+int compile_file(const char *path) {
+    snprintf(tokenfile, sizeof(tokenfile), "%s", path);
+    snprintf(outbase, sizeof(outbase), "%s", path);
     if ((fpTokenin = fopen(tokenfile, "r")) == NULL) {
-        printf("\n%s!\n", tokenfile);
+        printf("\n打开%s错误!\n", tokenfile);
         return 10;
     }
 
-    // ʼȫֱ
-    ast_init();
-    codesIndex = 0;
-    temp_var_count = 0;
-    label_count = 0;
-    symbolIndex = 0;
-    error_count = 0;
-    has_fatal_error = 0;
-    current_line = 0;
-    scope_top = -1;
-    current_scope_level = 0;
-    in_loop = 0;
-
-    // ȫ
-    enter_scope("global");
-
-    if (!read_next_token()) {
-        printf(": ļΪ\n");
+    // 内容没变的单词流直接取缓存的产物
+    stats_reset();
+    PHASE_BEGIN(PHASE_CACHE);
+    int hit = cache_enabled && cache_make_key(fpTokenin) == 0 && cache_restore();
+    PHASE_END(PHASE_CACHE);
+    int es = 0;
+    if (hit) {
         fclose(fpTokenin);
-        return 10;
+    } else {
+        es = compile_tokens();
     }
+    stats_finish(hit, es);
+    return es;
+}
+
+// 从已打开的fpTokenin编译，产物按outbase和emit_mask输出。所有全局状态
+// 在这里重新初始化，内联后代码表放不下时不内联再编译一遍。
+int compile_tokens() {
+    int es = 0;
+
+    PHASE_BEGIN(PHASE_PARSE);
+    inline_disabled = 0;
+    while (1) {
+        // 初始化所有全局变量
+        ast_init();
+        codesIndex = 0;
+        funcCodeCount = funcCount = 0;
+        cur_func = NULL;
+        inline_count = inline_growth = inline_overflow = 0;
+        temp_var_count = 0;
+        label_count = 0;
+        constCount = 0;
+        symbolIndex = 0;
+        frame_size = 0;
+        error_count = 0;
+        has_fatal_error = 0;
+        current_line = 0;
+        token_pos.line = token_pos.col = 0;
+        consumed_pos = token_pos;
+        lines_filled = 0;
+        scope_top = -1;
+        current_scope_level = 0;
+        in_loop = 0;
+        loop_top = 0;
+        pending_label[0] = '\0';
+
+        // 进入全局作用域
+        enter_scope("global");
+
+        if (!read_next_token()) {
+            printf("错误: 文件为空\n");
+            fclose(fpTokenin);
+            PHASE_END(PHASE_PARSE);
+            return 10;
+        }
 
-    es = program();
+        es = program();
+        if (inline_count > 0 && codesIndex + funcCodeCount > MAX_CODES) inline_overflow = 1;
+        // 内联展开后链接的代码表放不下：从头重新分析，这一遍不内联。
+        // 已经报了别的错就不必重来，照实报告代码表已满
+        if (!inline_overflow || inline_disabled) break;
+        if (error_count > 0) {
+            report_error(99, "中间代码表已满");
+            break;
+        }
+        trace("内联后代码表放不下，不内联重新编译\n");
+        inline_disabled = 1;
+        rewind(fpTokenin);
+    }
     fclose(fpTokenin);
+    fill_code_lines();
 
-    // ˳ȫ
+    // 退出全局作用域
     exit_scope();
+    PHASE_END(PHASE_PARSE);
 
-    printf("\n==================== ﷨ ====================\n");
+    trace("\n==================== 语法语义分析完成 ====================\n");
 
-    // 󱨸
+    // 输出错误报告
     print_all_errors();
 
+    // break/continue回填后常出现"跳到跳转"的链，先穿透一遍
+    PHASE_BEGIN(PHASE_OPTIMIZE);
+    if (!has_fatal_error) {
+        thread_jumps(codes, codesIndex);
+    }
 
+#if OPT_LEVEL > 0
+    optimize_codes();
+#endif
+    // main优化完再把要调用的函数接在后面
+    if (!has_fatal_error) link_functions();
+    PHASE_END(PHASE_OPTIMIZE);
 
-    // м
+    // 输出中间代码
+    PHASE_BEGIN(PHASE_OUTPUT);
     if (codesIndex > 0) {
-        print_intermediate_code();
+        if (trace_enabled) print_intermediate_code();
 
-        // м뵽ļ
+        // 输出中间代码到文件
         char codefile[512];
-        snprintf(codefile, sizeof(codefile), "%s.codes.txt", tokenfile);
-        FILE *fcode = fopen(codefile, "w");
+        snprintf(codefile, sizeof(codefile), "%s.codes.txt", outbase);
+        FILE *fcode = (emit_mask & EMIT_CODES) ? fopen(codefile, "w") : NULL;
         if (fcode) {
-            fprintf(fcode, "мб:\n");
-            fprintf(fcode, "%-6s %-10s %-10s\n", "", "", "");
+            fprintf(fcode, "中间代码列表:\n");
+            fprintf(fcode, "%-6s %-10s %-10s\n", "序号", "操作码", "操作数");
             fprintf(fcode, "--------------------------\n");
             for (int i = 0; i < codesIndex; i++) {
                 fprintf(fcode, "%-6d %-10s %-10d\n", i, codes[i].opt, codes[i].operand);
             }
-            fprintf(fcode, "\nܼ: %d м\n", codesIndex);
+            fprintf(fcode, "\n总计: %d 条中间代码\n", codesIndex);
+            print_const_pool(fcode);
+            print_line_table(fcode);
+            print_func_table(fcode);
             fclose(fcode);
-            printf("м %s\n", codefile);
+            printf("中间代码已输出到 %s\n", codefile);
+        }
+
+        // 二进制模块供虚拟机直接装载，文本代码表留作查看
+        char modfile[512];
+        snprintf(modfile, sizeof(modfile), "%s.cjm", outbase);
+        if ((emit_mask & EMIT_MODULE) && !has_fatal_error && write_module(modfile) == 0) {
+            printf("二进制模块已输出到 %s\n", modfile);
         }
     } else {
-        printf("\nδм\n");
+        printf("\n未生成中间代码\n");
     }
 
-    // ASTļ
+    // 输出AST到文件
     char astfile[512];
-    snprintf(astfile, sizeof(astfile), "%s.ast.txt", tokenfile);
-    FILE *fasta = fopen(astfile, "w");
+    snprintf(astfile, sizeof(astfile), "%s.ast.txt", outbase);
+    FILE *fasta = astText ? fopen(astfile, "w") : NULL;
     if (fasta) {
-        fprintf(fasta, "﷨ (AST):\n");
+        fprintf(fasta, "抽象语法树 (AST):\n");
         fprintf(fasta, "================\n\n");
         fputs(astText, fasta);
         fclose(fasta);
-        printf("﷨ %s\n", astfile);
+        printf("语法树已输出到 %s\n", astfile);
     }
 
-    // ų̋
-    if (symbolIndex > 0) {
-        printf("\n==================== ű ====================\n");
-        printf("                          ַ  ѳʼ  к\n");
+    // 输出符号表到控制台
+    if (symbolIndex > 0 && trace_enabled) {
+        printf("\n==================== 符号表 ====================\n");
+        printf("索引 名称             类别      类型      地址  已初始化 作用域 行号\n");
         printf("---------------------------------------------------------------------\n");
 
         for (int i = 0; i < symbolIndex; i++) {
-            // ַ
+            // 类别字符串
             char category_str[16];
             switch (symbol[i].kind) {
-                case variable: strcpy(category_str, ""); break;
-                case function: strcpy(category_str, ""); break;
-                case parameter: strcpy(category_str, ""); break;
-                default: strcpy(category_str, "δ֪"); break;
+                case variable: strcpy(category_str, "变量"); break;
+                case function: strcpy(category_str, "函数"); break;
+                case parameter: strcpy(category_str, "参数"); break;
+                default: strcpy(category_str, "未知"); break;
             }
 
-            // ַ飩
+            // 类型字符串（处理数组）
             char type_info[32];
             if (symbol[i].type == TYPE_ARRAY) {
-                snprintf(type_info, sizeof(type_info), "[%dά]",
+                snprintf(type_info, sizeof(type_info), "数组[%d维]",
                         symbol[i].array_info.dimensions);
             } else {
                 strcpy(type_info, type_to_string(symbol[i].type));
             }
 
-            // Ƿѳʼ
+            // 是否已初始化
             char init_str[8];
-            strcpy(init_str, symbol[i].initialized ? "" : "");
+            strcpy(init_str, symbol[i].initialized ? "是" : "否");
 
             printf("%-4d %-16s %-9s %-9s %-6d %-8s %-6d %-6d\n",
                    i,
@@ -946,30 +4184,31 @@ int TESTparse() {
                    symbol[i].scope_level,
                    symbol[i].line_declared);
         }
-        printf("\nܼ: %d \n", symbolIndex);
-
+        printf("\n总计: %d 个符号\n", symbolIndex);
+    }
 
-        // űļ
+    // 输出符号表到文件
+    if (symbolIndex > 0 && (emit_mask & EMIT_SYMBOLS)) {
         char symfile[512];
-        snprintf(symfile, sizeof(symfile), "%s.symbols.txt", tokenfile);
+        snprintf(symfile, sizeof(symfile), "%s.symbols.txt", outbase);
         FILE *fsym = fopen(symfile, "w");
         if (fsym) {
-            fprintf(fsym, "ű:\n");
-            fprintf(fsym, "                          ַ  ѳʼ  к\n");
+            fprintf(fsym, "符号表内容:\n");
+            fprintf(fsym, "索引 名称             类别      类型      地址  已初始化 作用域 行号\n");
             fprintf(fsym, "---------------------------------------------------------------------\n");
 
             for (int i = 0; i < symbolIndex; i++) {
                 char category_str[16];
                 switch (symbol[i].kind) {
-                    case variable: strcpy(category_str, ""); break;
-                    case function: strcpy(category_str, ""); break;
-                    case parameter: strcpy(category_str, ""); break;
-                    default: strcpy(category_str, "δ֪"); break;
+                    case variable: strcpy(category_str, "变量"); break;
+                    case function: strcpy(category_str, "函数"); break;
+                    case parameter: strcpy(category_str, "参数"); break;
+                    default: strcpy(category_str, "未知"); break;
                 }
 
                 char type_info[32];
                 if (symbol[i].type == TYPE_ARRAY) {
-                    snprintf(type_info, sizeof(type_info), "[%dά]",
+                    snprintf(type_info, sizeof(type_info), "数组[%d维]",
                             symbol[i].array_info.dimensions);
                 } else {
                     strcpy(type_info, type_to_string(symbol[i].type));
@@ -981,24 +4220,40 @@ int TESTparse() {
                        category_str,
                        type_info,
                        symbol[i].address,
-                       symbol[i].initialized ? "" : "",
+                       symbol[i].initialized ? "是" : "否",
                        symbol[i].scope_level,
                        symbol[i].line_declared);
             }
 
-            fprintf(fsym, "\nܼ: %d \n", symbolIndex);
+            fprintf(fsym, "\n总计: %d 个符号\n", symbolIndex);
             fclose(fsym);
-            printf("ű %s\n", symfile);
+            printf("符号表已输出到 %s\n", symfile);
         }
-    } else {
-        printf("\nűΪ\n");
     }
-    // ڴ
+    if (symbolIndex == 0) {
+        trace("\n符号表为空\n");
+    }
+
+    PHASE_END(PHASE_OUTPUT);
+
+    if (cache_enabled && error_count == 0 && codesIndex > 0) {
+        PHASE_BEGIN(PHASE_CACHE);
+        cache_store();
+        PHASE_END(PHASE_CACHE);
+    }
+    // 清理内存
     free(astText);
+    astText = NULL;
+
+    // 出错后分析会继续做恢复，es可能仍为0，以第一个错误的代码作为结果
+    for (int i = 0; i < error_count && es == 0; i++) {
+        if (!error_list[i].is_warning) es = error_list[i].error_code;
+    }
+    return es;
 }
-// ===================== ﷨ʵ =====================
+// ===================== 语法分析函数实现 =====================
 
-// ޸declaration_statеĴɣ
+// 修改declaration_stat函数中的代码生成：
 
 int declaration_stat() {
     int es = 0;
@@ -1008,7 +4263,7 @@ int declaration_stat() {
 
     if (!read_next_token()) return 10;
     if (strcmp(token, "ID") != 0 && strcmp(token1, "ID") != 0) {
-        report_error(3, "ʶõ: %s", token1);
+        report_error(3, "期望标识符，得到: %s", token1);
         es = 3;
         skip_to_sync_point();
         ast_end();
@@ -1027,7 +4282,7 @@ int declaration_stat() {
 
     if (!read_next_token()) return 10;
     if (strcmp(token, ":") != 0 && strcmp(token1, ":") != 0) {
-        report_error(4, ":õ: %s %s", token, token1);
+        report_error(4, "期望:，得到: %s %s", token, token1);
         es = 4;
         skip_to_sync_point();
         ast_end();
@@ -1056,7 +4311,7 @@ int declaration_stat() {
         var_type = TYPE_BOOL;
         ast_add_attr("kind", "bool");
     } else {
-        report_error(8, "͹ؼ֣õ: %s %s", token, token1);
+        report_error(8, "期望类型关键字，得到: %s %s", token, token1);
         es = 8;
         skip_to_sync_point();
         ast_end();
@@ -1066,6 +4321,7 @@ int declaration_stat() {
         return es;
     }
 
+    int fresh = frame_size;     // 此前没用过的槽位从这里起
     es = insert_Symbol(variable, var_name, var_type, 0, 0, NULL, 0);
     if (es > 0) {
         ast_end();
@@ -1075,12 +4331,13 @@ int declaration_stat() {
         return es;
     }
 
-    // DECLָΪ洢ռ
-    if (!has_fatal_error) {
-        // ջзռ
-        strcpy(codes[codesIndex].opt, "ALLOC");
-        codes[codesIndex].operand = 1;  // 1Ԫ
-        codesIndex++;
+    // 存储空间已在帧布局中分配，由函数入口的ENTER统一开辟。块作用域结束后
+    // 槽位归还给后面的声明，复用的槽位里还留着旧值，这里先清零
+    int addr = symbol[symbolIndex - 1].address;
+    if (addr < fresh && !has_fatal_error) {
+        if (is_float_type(var_type)) gen_code("LOADF", add_float_const(0.0));
+        else gen_code("LOADI", 0);
+        gen_code("STO", addr);
     }
 
     ast_end();
@@ -1092,84 +4349,278 @@ int declaration_stat() {
     return es;
 }
 
-// ޸main_declaration
+// 修改main_declaration函数：
 
 int main_declaration() {
-    int es = 0, cx1;
+    int es = 0, enter_cx = -1;
     ast_add_attr("ID", "main");
 
-    printf("mainǰtoken: %s %s\n", token, token1);
+    trace("解析main函数，当前token: %s %s\n", token, token1);
 
-    // 
+    // 检查左括号
     if (strcmp(token, "(") != 0 && strcmp(token1, "(") != 0) {
-        report_error(5, "(õ: %s %s", token, token1);
+        report_error(5, "期望(，得到: %s %s", token, token1);
         es = 5;
     } else {
-        // 
+        // 正常情况：有括号
         if (!read_next_token()) return 10;
     }
 
-    // 
+    // 检查右括号
     if (strcmp(token, ")") != 0 && strcmp(token1, ")") != 0) {
-        report_error(6, ")õ: %s %s", token, token1);
+        report_error(6, "期望)，得到: %s %s", token, token1);
         es = 6;
     } else {
         if (!read_next_token()) return 10;
     }
 
-    // 뺯
-    enter_scope("function");
+    // 进入函数作用域，局部变量从槽位1起分配
+    offset = 1;
+    frame_size = 1;
+    enter_scope("function");
+
+    // 帧大小要等函数体分析完才知道，先占位，结束时回填
+    if (!has_fatal_error) {
+        enter_cx = codesIndex;
+        gen_code("ENTER", 0);
+    }
+
+    // 检查左大括号
+    int has_compound = 0;
+    if (strcmp(token, "{") == 0 || strcmp(token1, "{") == 0) {
+        has_compound = 1;
+    } else {
+        report_error(11, "期望{，得到: %s %s", token, token1);
+        es = 11;
+    }
+
+    trace("准备解析main函数体，当前token: %s %s\n", token, token1);
+
+    ast_begin("MainBody");
+
+    if (has_compound) {
+        int func_es = function_body();
+        if (func_es > 0) {
+            es = func_es;
+        }
+    } else {
+        // 如果没有大括号，尝试解析单个语句作为函数体
+        int stmt_es = statement();
+        if (stmt_es > 0) {
+            es = stmt_es;
+        }
+    }
+
+    ast_end();
+
+    if (!has_fatal_error && enter_cx >= 0) {
+        codes[enter_cx].operand = frame_size;
+    }
+
+    exit_scope();
+
+    if (!has_fatal_error) {
+        gen_code("STOP", 0);
+    }
+
+    return es;
+}
+
+// 类型关键字对应的类型，当前单词不是类型关键字时为TYPE_UNKNOWN
+enum DataType keyword_type() {
+    static const struct { const char *name; enum DataType type; } types[] = {
+        { "int", TYPE_INT }, { "float", TYPE_FLOAT }, { "double", TYPE_DOUBLE },
+        { "char", TYPE_CHAR }, { "bool", TYPE_BOOL }, { "void", TYPE_VOID }
+    };
+    for (int i = 0; i < (int)(sizeof(types) / sizeof(types[0])); i++) {
+        if (strcmp(token, types[i].name) == 0 || strcmp(token1, types[i].name) == 0) return types[i].type;
+    }
+    return TYPE_UNKNOWN;
+}
+
+// 形参表：( [ID : 类型 {, ID : 类型}] )，当前单词是(。形参按顺序占槽位1..n
+int parameter_list(FuncInfo *f) {
+    if (!is_logic_token("(")) {
+        report_error(5, "期望(，得到: %s %s", token, token1);
+        return 5;
+    }
+    if (!read_next_token()) return 10;
+
+    ast_begin("Parameters");
+    while (strcmp(token, "ID") == 0) {
+        char name[64];
+        strncpy(name, token1, sizeof(name) - 1);
+        name[sizeof(name) - 1] = '\0';
+        if (!read_next_token()) return 10;
+        if (!is_logic_token(":")) {
+            report_error(4, "期望:，得到: %s %s", token, token1);
+            ast_end();
+            return 4;
+        }
+        if (!read_next_token()) return 10;
+        enum DataType type = keyword_type();
+        if (type == TYPE_UNKNOWN || type == TYPE_VOID) {
+            report_error(8, "期望类型关键字，得到: %s %s", token, token1);
+            ast_end();
+            return 8;
+        }
+        ast_add_attr(name, type_to_string(type));
+
+        if (f->nparams >= MAX_PARAMS) {
+            report_error(36, "形参超过 %d 个", MAX_PARAMS);
+        } else if (insert_Symbol(parameter, name, type, 0, 0, NULL, 1) == 0) {
+            SymbolEntry *p = &symbol[symbolIndex - 1];
+            p->address = new_scope_slot();
+            p->param_index = f->nparams;
+            p->initialized = 1;
+            f->param_type[f->nparams++] = type;
+        }
+
+        if (!read_next_token()) return 10;
+        if (!is_logic_token(",")) break;
+        if (!read_next_token()) return 10;
+    }
+    ast_end();
+
+    if (!is_logic_token(")")) {
+        report_error(6, "期望)，得到: %s %s", token, token1);
+        return 6;
+    }
+    if (!read_next_token()) return 10;
+    return 0;
+}
+
+// 函数体最后一条是RET/TAILCALL、且没有跳转跳过它时不必再补返回
+int ends_with_return(int start) {
+    if (codesIndex <= start) return 0;
+    const char *last = codes[codesIndex - 1].opt;
+    if (strcmp(last, "RET") != 0 && strcmp(last, "TAILCALL") != 0) return 0;
+    for (int i = start; i < codesIndex; i++) {
+        if (is_branch_op(codes[i].opt) && codes[i].operand == codesIndex) return 0;
+    }
+    return 1;
+}
+
+// 函数定义：名字(形参) [: 返回类型] { 声明 语句 }。代码生成后移出codes[]，
+// 保存起来供调用处内联或链接，见"函数与内联"
+int function_declaration() {
+    int es = 0, enter_cx = -1, start = codesIndex, sym;
+    char name[64];
 
-    if (!has_fatal_error) {
-        gen_code("ENTER", 0);
-    }
+    strncpy(name, token1, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    ast_begin("Function");
+    ast_add_attr("ID", name);
+    trace("解析函数 %s\n", name);
 
-    // 
-    int has_compound = 0;
-    if (strcmp(token, "{") == 0 || strcmp(token1, "{") == 0) {
-        has_compound = 1;
-    } else {
-        report_error(11, "{õ: %s %s", token, token1);
-        es = 11;
+    es = insert_Symbol(function, name, TYPE_VOID, 0, 0, NULL, 0);
+    if (es > 0 && es != 32) {
+        ast_end();
+        return es;
+    }
+    sym = es == 32 ? -1 : symbolIndex - 1;     // 重名的函数照常分析，但不保存
+    if (sym >= 0) symbol[sym].address = -1;     // 链接时才有入口
+    FuncInfo *f = func_begin(sym);
+    if (!f) {
+        ast_end();
+        return 99;
     }
 
-    printf("׼main壬ǰtoken: %s %s\n", token, token1);
+    if (!read_next_token()) return 10;
 
-    ast_begin("MainBody");
+    // 形参与函数体的局部变量同在函数作用域，从槽位1起分配
+    offset = 1;
+    frame_size = 1;
+    enter_scope("function");
+    int param_es = parameter_list(f);
+    if (param_es > 0) es = param_es;
+    f->local_from = symbolIndex;
 
-    if (has_compound) {
-        int func_es = function_body();
-        if (func_es > 0) {
-            es = func_es;
+    if (is_logic_token(":")) {
+        if (!read_next_token()) return 10;
+        f->ret_type = keyword_type();
+        if (f->ret_type == TYPE_UNKNOWN) {
+            report_error(8, "期望返回类型，得到: %s %s", token, token1);
+            es = 8;
+        } else if (!read_next_token()) {
+            return 10;
         }
-    } else {
-        // ûдţԽΪ
-        int stmt_es = statement();
-        if (stmt_es > 0) {
-            es = stmt_es;
+    }
+    if (sym >= 0) symbol[sym].type = f->ret_type;
+    ast_add_attr("return", type_to_string(f->ret_type));
+
+    cur_func = f;
+    if (!has_fatal_error) {
+        // 入口：开辟帧，实参从栈顶起逆序存入形参
+        enter_cx = codesIndex;
+        gen_code("ENTER", 0);
+        for (int i = symbolIndex - 1; i >= 0; i--) {
+            if (symbol[i].kind == parameter && !symbol[i].scope_closed &&
+                symbol[i].scope_level == current_scope_level)
+                gen_code("STO", symbol[i].address);
         }
     }
 
+    ast_begin("FunctionBody");
+    int body_es = function_body();
+    if (body_es > 0) es = body_es;
     ast_end();
 
+    // 执行到函数体末尾也要返回，有返回值的函数返回0
+    if (!has_fatal_error && !ends_with_return(enter_cx)) {
+        if (f->ret_type == TYPE_VOID) {
+            gen_code("RET", 0);
+        } else {
+            report_warning("函数 %s 末尾没有return，返回0", name);
+            if (is_float_type(f->ret_type)) gen_code("LOADF", add_float_const(0.0));
+            else gen_code("LOADI", 0);
+            gen_code("RET", 1);
+        }
+    }
+
+    if (!has_fatal_error && enter_cx >= 0) codes[enter_cx].operand = frame_size;
+    f->local_to = symbolIndex;
     exit_scope();
+    cur_func = NULL;
 
-    if (!has_fatal_error) {
-        gen_code("STOP", 0);
+    if (strcmp(token, "}") == 0 && !read_next_token()) {
+        report_error(13, "函数 %s 之后缺少main函数", name);
+        es = 13;
+    }
+    if (!has_fatal_error && sym >= 0) {
+        int frame = frame_size;
+#if OPT_LEVEL > 0
+        frame = optimize_function(f, start);
+#endif
+        int save_es = func_save(f, start, frame);
+        if (save_es > 0) es = save_es;
+    } else {
+        codesIndex = start;
+        if (sym < 0) funcCount--;
     }
 
+    ast_end();
     return es;
 }
 
-// ޸programеĴɣ
+// 修改program函数中的代码生成：
 
 int program() {
     int es = 0;
     ast_begin("Program");
 
-    // mainؼ
+    // main之前的函数定义
+    while (strcmp(token, "ID") == 0 && !has_fatal_error) {
+        es = function_declaration();
+        if (es > 0 && has_fatal_error) {
+            ast_end();
+            return es;
+        }
+    }
+
+    // 检查main关键字
     if (strcmp(token, "main") != 0 && strcmp(token1, "main") != 0) {
-        report_error(13, "ȱmainõ: %s %s", token, token1);
+        report_error(13, "缺少main函数，得到: %s %s", token, token1);
         es = 13;
         skip_to_sync_point();
         ast_end();
@@ -1178,13 +4629,14 @@ int program() {
 
     ast_begin("MainFunction");
 
-    // main
+    // 插入main函数符号
     int insert_es = insert_Symbol(function, "main", TYPE_INT, 0, 0, NULL, 0);
-    if (insert_es > 0 && insert_es != 22) {  // 22ظ󣬿Լ
+    if (insert_es > 0 && insert_es != 22) {  // 22是重复定义错误，可以继续
         ast_end();
         ast_end();
         return insert_es;
     }
+    if (insert_es == 0) symbol[symbolIndex - 1].address = 0;     // 程序入口
 
     if (!read_next_token()) {
         ast_end();
@@ -1192,7 +4644,7 @@ int program() {
         return 10;
     }
 
-    // main
+    // 解析main函数声明
     es = main_declaration();
     if (es > 0 && has_fatal_error) {
         ast_end();
@@ -1209,15 +4661,13 @@ int function_body() {
     ast_begin("Function_Body");
 
     if (strcmp(token, "{") != 0 && strcmp(token1, "{") != 0) {
-        report_error(11, "{õ: %s %s", token, token1);
+        report_error(11, "期望{，得到: %s %s", token, token1);
         es = 11;
         skip_to_sync_point();
         ast_end();
         return es;
     }
 
-    offset = 1;
-
     if (!read_next_token()) return 10;
     es = declaration_list();
     if (es > 0 && has_fatal_error) {
@@ -1232,7 +4682,7 @@ int function_body() {
     }
 
     if (strcmp(token, "}") != 0 && strcmp(token1, "}") != 0) {
-        report_error(12, "}õ: %s %s", token, token1);
+        report_error(12, "期望}，得到: %s %s", token, token1);
         es = 12;
         skip_to_sync_point();
     }
@@ -1271,13 +4721,13 @@ int statement_list() {
 
         loop_count++;
         if (loop_count > max_loops) {
-            report_error(99, "⵽ѭǿ˳б");
+            report_error(99, "检测到可能无限循环，强制退出语句列表解析");
             break;
         }
 
-        printf("䣬ǰtoken: %s %s\n", token, token1);
+        trace("解析语句，当前token: %s %s\n", token, token1);
 
-        // break/continue
+        // 检查break/continue语句
         if (strcmp(token, "break") == 0 || strcmp(token1, "break") == 0) {
             es = break_stat();
         } else if (strcmp(token, "continue") == 0 || strcmp(token1, "continue") == 0) {
@@ -1300,67 +4750,107 @@ int statement_list() {
     return es;
 }
 
-// break䴦
-int break_stat() {
-    ast_begin("BreakStatement");
-
-    // 飺ȷѭ
-    check_in_loop("break");
-
-    if (!has_fatal_error) {
-        // ת루ʵӦתѭ
-        // 򻯴BREAK
-        gen_code("BREAK", 0);
+// 把当前token作为循环标号复制到label（size字节），太长时报错并置为空串
+void copy_label(char *label, size_t size) {
+    size_t len = strlen(token1);
+    if (len >= size) {
+        report_error(68, "循环标号 %s 过长，最多 %d 个字符", token1, (int)size - 1);
+        label[0] = '\0';
+        return;
     }
+    memcpy(label, token1, len + 1);
+}
+
+// break/continue共用：可带标号跳出或继续外层循环，如 break outer;
+int loop_jump_stat(const char *keyword, int is_break) {
+    // 控制流检查：确保在循环内
+    check_in_loop(keyword);
 
     if (!read_next_token()) {
-        ast_end();
         return 10;
     }
 
+    char label[64] = "";
+    if (strcmp(token, "ID") == 0) {
+        copy_label(label, sizeof(label));
+        ast_add_attr("label", label);
+        if (!read_next_token()) {
+            return 10;
+        }
+    }
+
+    if (in_loop > 0 && !has_fatal_error) {
+        int li = find_loop(label);
+        if (li < 0) {
+            report_error(62, "%s 的目标循环 %s 不存在", keyword, label);
+        } else if (is_break) {
+            // 跳转到循环出口，循环结束时回填
+            gen_jump_to_list(&loop_stack[li].break_list);
+        } else {
+            // 跳转到条件判断（while）或增量部分（for），循环结束时回填
+            gen_jump_to_list(&loop_stack[li].continue_list);
+        }
+    }
+
     if (strcmp(token, ";") == 0 || strcmp(token1, ";") == 0) {
         if (!read_next_token()) {
-            ast_end();
             return 10;
         }
     }
 
-    ast_end();
     return 0;
 }
 
-// continue䴦
+// break语句处理
+int break_stat() {
+    ast_begin("BreakStatement");
+    int es = loop_jump_stat("break", 1);
+    ast_end();
+    return es;
+}
+
+// continue语句处理
 int continue_stat() {
     ast_begin("ContinueStatement");
+    int es = loop_jump_stat("continue", 0);
+    ast_end();
+    return es;
+}
 
-    // 飺ȷѭ
-    check_in_loop("continue");
+// 带标号的循环：outer: while (...) { ... break outer; }
+int labeled_stat() {
+    char label[64];
+    copy_label(label, sizeof(label));
+    ast_add_attr("label", label);
 
-    if (!has_fatal_error) {
-        // ת루ʵӦתѭʼ
-        // 򻯴CONTINUE
-        gen_code("CONTINUE", 0);
+    if (label[0] != '\0' && find_loop(label) >= 0) {
+        report_error(66, "循环标号 %s 与外层循环重名", label);
     }
 
-    if (!read_next_token()) {
-        ast_end();
-        return 10;
-    }
+    if (!read_next_token()) return 10;     // 跳过标号
+    if (!read_next_token()) return 10;     // 跳过冒号
 
-    if (strcmp(token, ";") == 0 || strcmp(token1, ";") == 0) {
-        if (!read_next_token()) {
-            ast_end();
-            return 10;
-        }
+    if (strcmp(token, "while") != 0 && strcmp(token, "for") != 0) {
+        report_error(67, "标号 %s 之后应为循环语句，得到: %s %s", label, token, token1);
+    } else {
+        strcpy(pending_label, label);
     }
 
-    ast_end();
-    return 0;
+    int es = statement();
+    pending_label[0] = '\0';
+    return es;
+}
+
+// 当前可见的同名符号是函数
+int is_function_name(char *name) {
+    int pos;
+    return lookup_current_scope(name, &pos) == 0 && symbol[pos].kind == function;
 }
 
 int statement() {
     int es = 0;
-    printf("statementǰtoken: %s %s\n", token, token1);
+    char next_type[64];
+    trace("解析statement，当前token: %s %s\n", token, token1);
 
     if (strcmp(token, "if") == 0 || strcmp(token1, "if") == 0) {
         ast_begin("IfStatement");
@@ -1376,15 +4866,20 @@ int statement() {
         ast_end();
     } else if (strcmp(token, "{") == 0 || strcmp(token1, "{") == 0) {
         ast_begin("CompoundStatement");
-        // 
+        // 进入块作用域
         enter_scope("block");
         es = compound_stat();
         exit_scope();
         ast_end();
-    } else if (strcmp(token, "call") == 0 || strcmp(token1, "call") == 0) {
+    } else if (strcmp(token, "call") == 0 || strcmp(token1, "call") == 0 ||
+               (strcmp(token, "ID") == 0 && is_function_name(token1))) {
         ast_begin("CallStatement");
         es = call_stat();
         ast_end();
+    } else if (strcmp(token, "return") == 0) {
+        ast_begin("ReturnStatement");
+        es = return_stat();
+        ast_end();
     } else if (strcmp(token, "read") == 0 || strcmp(token1, "read") == 0) {
         ast_begin("ReadStatement");
         es = read_stat();
@@ -1393,6 +4888,11 @@ int statement() {
         ast_begin("WriteStatement");
         es = write_stat();
         ast_end();
+    } else if (strcmp(token, "ID") == 0 && peek_token_type(next_type, sizeof(next_type)) &&
+               strcmp(next_type, ":") == 0) {
+        ast_begin("LabeledStatement");
+        es = labeled_stat();
+        ast_end();
     } else if (strcmp(token, "ID") == 0 || strcmp(token1, "ID") == 0) {
         ast_begin("AssignmentOrExpression");
         es = expression();
@@ -1412,9 +4912,11 @@ int statement() {
     } else if (strcmp(token, "var") == 0 || strcmp(token1, "var") == 0) {
         es = declaration_stat();
     } else {
-        report_error(9, "δ֪: %s %s", token, token1);
+        report_error(9, "未知语句类型: %s %s", token, token1);
         es = 9;
-        skip_to_sync_point();
+        // 停在 ) 或 else 这类不能开始语句的同步点上时跳过它，否则同一个
+        // token会被反复报错
+        if (skip_to_sync_point() == 0 && !read_next_token()) return 10;
     }
 
     return es;
@@ -1425,37 +4927,38 @@ int if_stat() {
     int has_error = 0;
     int missing_lparen = 0;
 
-    printf("if䣬ǰtoken: %s %s\n", token, token1);
+    trace("解析if语句，当前token: %s %s\n", token, token1);
 
     if (!read_next_token()) return 10;
 
-    // 
+    // 检查左括号
     if (strcmp(token, "(") != 0 && strcmp(token1, "(") != 0) {
-        report_error(5, "(õ: %s %s", token, token1);
+        report_error(5, "期望(，得到: %s %s", token, token1);
         es = 5;
         has_error = 1;
         missing_lparen = 1;
     } else {
-        // 
+        // 正常情况：有括号
         if (!read_next_token()) return 10;
     }
 
-    // Խʽ
-    int bool_es = bool_expr();
+    // 尝试解析条件表达式，条件为假的跳转串在false_list上
+    int false_list = -1;
+    int bool_es = cond_jump(&false_list, 0);
     if (bool_es > 0) {
         es = bool_es;
         has_error = 1;
     }
 
-    // 
+    // 检查右括号
     if (missing_lparen) {
         if (strcmp(token, ")") == 0 || strcmp(token1, ")") == 0) {
-            printf("ȱţţ\n");
+            printf("缺少左括号，但遇到右括号，消费它\n");
             if (!read_next_token()) return 10;
         }
     } else {
         if (strcmp(token, ")") != 0 && strcmp(token1, ")") != 0) {
-            report_error(6, ")õ: %s %s", token, token1);
+            report_error(6, "期望)，得到: %s %s", token, token1);
             es = 6;
             has_error = 1;
         } else {
@@ -1463,30 +4966,25 @@ int if_stat() {
         }
     }
 
-    // 
+    // 检查左大括号
     int has_compound = 0;
     if (strcmp(token, "{") == 0 || strcmp(token1, "{") == 0) {
         has_compound = 1;
     } else {
-        report_error(11, "{õ: %s %s", token, token1);
+        report_error(11, "期望{，得到: %s %s", token, token1);
         es = 11;
         has_error = 1;
-        // skip_to_sync_point()Խ
+        // 不调用skip_to_sync_point()，尝试解析单条语句
     }
 
-    // ֻûʽɹʱBRFָ
-    if (!has_fatal_error && !has_error) {
-        strcpy(codes[codesIndex].opt, "BRF");
-        cx1 = codesIndex++;
-    } else {
-        cx1 = -1;
-    }
+    // 只有没有致命错误且条件表达式解析成功时才回填假出口
+    cx1 = (!has_fatal_error && !has_error) ? false_list : -1;
 
-    // if֧
-    printf("if֧ǰtoken: %s %s\n", token, token1);
+    // 解析if分支
+    trace("解析if分支，当前token: %s %s\n", token, token1);
 
     if (has_compound) {
-        // 
+        // 进入块作用域
         enter_scope("block");
         int stmt_es = compound_stat();
         exit_scope();
@@ -1495,7 +4993,7 @@ int if_stat() {
             has_error = 1;
         }
     } else {
-        // 
+        // 解析单条语句
         int stmt_es = statement();
         if (stmt_es > 0) {
             es = stmt_es;
@@ -1503,34 +5001,34 @@ int if_stat() {
         }
     }
 
-    // ֻûдʱBRָ
+    // 只有没有错误时才生成BR指令
     if (!has_fatal_error && !has_error) {
         strcpy(codes[codesIndex].opt, "BR");
         cx2 = codesIndex++;
         if (cx1 != -1) {
-            codes[cx1].operand = codesIndex;
+            backpatch(cx1, codesIndex);
         }
     } else {
         cx2 = -1;
     }
 
-    // Ƿelse
+    // 检查是否有else
     if (strcmp(token, "else") == 0 || strcmp(token1, "else") == 0) {
         ast_add_attr("has_else", "true");
         if (!read_next_token()) return 10;
 
-        // else
+        // 检查else后的左大括号
         int else_has_compound = 0;
         if (strcmp(token, "{") == 0 || strcmp(token1, "{") == 0) {
             else_has_compound = 1;
         } else {
-            report_error(11, "{õ: %s %s", token, token1);
+            report_error(11, "期望{，得到: %s %s", token, token1);
             es = 11;
             has_error = 1;
         }
 
-        // else֧
-        printf("else֧ǰtoken: %s %s\n", token, token1);
+        // 解析else分支
+        trace("解析else分支，当前token: %s %s\n", token, token1);
 
         if (else_has_compound) {
             enter_scope("block");
@@ -1548,20 +5046,20 @@ int if_stat() {
             }
         }
 
-        // ֻûдʱתַ
+        // 只有没有错误时才设置跳转地址
         if (!has_fatal_error && !has_error && cx2 != -1) {
             codes[cx2].operand = codesIndex;
         }
     } else {
         ast_add_attr("has_else", "false");
 
-        // ֻûдʱΪʱתַ
+        // 只有没有错误时才设置条件为假时的跳转地址
         if (!has_fatal_error && !has_error && cx1 != -1) {
-            codes[cx1].operand = codesIndex;
+            backpatch(cx1, codesIndex);
         }
     }
 
-    // BRָתַ
+    // 设置BR指令的跳转地址
     if (!has_fatal_error && !has_error && cx2 != -1) {
         codes[cx2].operand = codesIndex;
     }
@@ -1571,52 +5069,47 @@ int if_stat() {
 int while_stat() {
     int es = 0, cx1;
 
-    printf("while䣬ǰtoken: %s %s\n", token, token1);
+    trace("解析while语句，当前token: %s %s\n", token, token1);
 
     if (!read_next_token()) return 10;
 
-    // 
+    // 检查左括号
     if (strcmp(token, "(") != 0 && strcmp(token1, "(") != 0) {
-        report_error(5, "(õ: %s %s", token, token1);
+        report_error(5, "期望(，得到: %s %s", token, token1);
         es = 5;
     } else {
-        // 
+        // 正常情况：有括号
         if (!read_next_token()) return 10;
     }
 
     int loop_start = codesIndex;
     enter_scope("loop");
 
-    // Խʽ
-    int bool_es = bool_expr();
+    // 尝试解析条件表达式，条件为假的跳转串在cx1链上
+    int bool_es = cond_jump(&cx1, 0);
     if (bool_es > 0) {
         es = bool_es;
     }
 
-    if (!has_fatal_error) {
-        strcpy(codes[codesIndex].opt, "BRF");
-        cx1 = codesIndex++;
-    }
-
-    // Ƿ
+    // 检查是否有右括号
     if (strcmp(token, ")") != 0 && strcmp(token1, ")") != 0) {
-        report_error(6, ")õ: %s %s", token, token1);
+        report_error(6, "期望)，得到: %s %s", token, token1);
         es = 6;
     } else {
         if (!read_next_token()) return 10;
     }
 
-    // 
+    // 检查左大括号
     int has_compound = 0;
     if (strcmp(token, "{") == 0 || strcmp(token1, "{") == 0) {
         has_compound = 1;
     } else {
-        report_error(11, "{õ: %s %s", token, token1);
+        report_error(11, "期望{，得到: %s %s", token, token1);
         es = 11;
     }
 
-    // ѭ
-    printf("׼whileѭ壬ǰtoken: %s %s\n", token, token1);
+    // 解析循环体
+    trace("准备解析while循环体，当前token: %s %s\n", token, token1);
 
     ast_begin("WhileBody");
 
@@ -1636,23 +5129,24 @@ int while_stat() {
 
     ast_end();
 
-    exit_scope();
-
     if (!has_fatal_error) {
         strcpy(codes[codesIndex].opt, "BR");
         codes[codesIndex].operand = loop_start;
         codesIndex++;
-        codes[cx1].operand = codesIndex;
+        backpatch(cx1, codesIndex);
+        loop_close(codesIndex, loop_start);
     }
 
+    exit_scope();
+
     return es;
 }
 int for_stat() {
-    int es = 0, cx1, cx2;
+    int es = 0, cx1 = -1, cx2 = -1;
 
     if (!read_next_token()) return 10;
     if (strcmp(token, "(") != 0 && strcmp(token1, "(") != 0) {
-        report_error(5, "(õ: %s %s", token, token1);
+        report_error(5, "期望(，得到: %s %s", token, token1);
         return 5;
     }
 
@@ -1666,18 +5160,18 @@ int for_stat() {
 
     int loop_start = codesIndex;
 
-    // ѭ
+    // 进入循环作用域
     enter_scope("loop");
 
     if (strcmp(token, ";") != 0 && strcmp(token1, ";") != 0) {
-        report_error(4, ";õ: %s %s", token, token1);
+        report_error(4, "期望;，得到: %s %s", token, token1);
         skip_to_sync_point();
     }
 
     if (!read_next_token()) return 10;
     if (strcmp(token, ";") != 0 && strcmp(token1, ";") != 0) {
         ast_begin("Condition");
-        es = bool_expr();
+        es = cond_jump(&cx1, 0);    // 省略条件时没有假出口
         ast_end();
         if (es > 0) {
             exit_scope();
@@ -1685,13 +5179,8 @@ int for_stat() {
         }
     }
 
-    if (!has_fatal_error) {
-        strcpy(codes[codesIndex].opt, "BRF");
-        cx1 = codesIndex++;
-    }
-
     if (strcmp(token, ";") != 0 && strcmp(token1, ";") != 0) {
-        report_error(4, ";õ: %s %s", token, token1);
+        report_error(4, "期望;，得到: %s %s", token, token1);
         skip_to_sync_point();
     }
 
@@ -1721,18 +5210,18 @@ int for_stat() {
     }
 
     if (strcmp(token, ")") != 0 && strcmp(token1, ")") != 0) {
-        report_error(6, ")õ: %s %s", token, token1);
+        report_error(6, "期望)，得到: %s %s", token, token1);
         skip_to_sync_point();
     }
 
     if (!read_next_token()) return 10;
 
-    // 
+    // 检查左大括号
     int has_compound = 0;
     if (strcmp(token, "{") == 0 || strcmp(token1, "{") == 0) {
         has_compound = 1;
     } else {
-        report_error(11, "{õ: %s %s", token, token1);
+        report_error(11, "期望{，得到: %s %s", token, token1);
         es = 11;
     }
 
@@ -1754,15 +5243,16 @@ int for_stat() {
 
     ast_end();
 
-    // ˳ѭ
-    exit_scope();
-
     if (!has_fatal_error) {
         strcpy(codes[codesIndex].opt, "BR");
         codes[codesIndex].operand = inc_start;
         codesIndex++;
-        codes[cx1].operand = codesIndex;
+        backpatch(cx1, codesIndex);
+        loop_close(codesIndex, inc_start);
     }
+
+    // 退出循环作用域
+    exit_scope();
     return es;
 }
 
@@ -1770,12 +5260,12 @@ int compound_stat() {
     int es = 0;
     ast_add_attr("start", "{");
 
-    // Ѿȷţ
+    // 已经确认有左大括号，消费它
     if (!read_next_token()) return 10;
 
-    // ǷΪո
+    // 检查是否为空复合语句
     if (strcmp(token, "}") == 0 || strcmp(token1, "}") == 0) {
-        // 
+        // 空语句块
         ast_add_attr("empty", "true");
     } else {
         es = statement_list();
@@ -1784,7 +5274,7 @@ int compound_stat() {
     if (es > 0) return es;
 
     if (strcmp(token, "}") != 0 && strcmp(token1, "}") != 0) {
-        report_error(12, "}õ: %s %s", token, token1);
+        report_error(12, "期望}，得到: %s %s", token, token1);
         es = 12;
         skip_to_sync_point();
     }
@@ -1795,55 +5285,165 @@ int compound_stat() {
     return es;
 }
 
+// call 函数名(实参, ...) ; 或省略call直接写 函数名(实参, ...)
+// 有返回值的函数作语句调用时，返回值存入一个匿名槽位丢弃
 int call_stat() {
     int es = 0;
     int symbolPos;
+    int has_keyword = strcmp(token1, "call") == 0;
 
-    if (!read_next_token()) return 10;
-    if (strcmp(token, "ID") != 0 && strcmp(token1, "ID") != 0) {
-        report_error(3, "ʶõ: %s %s", token, token1);
+    if (has_keyword && !read_next_token()) return 10;
+    if (strcmp(token, "ID") != 0 && strcmp(token, "main") != 0) {
+        report_error(3, "期望标识符，得到: %s %s", token, token1);
         return 3;
     }
 
     ast_add_attr("function_name", token1);
 
     if (lookup_global(token1, &symbolPos) != 0) {
-        report_error(23, " %s δ", token1);
+        report_error(23, "函数 %s 未声明", token1);
         return 23;
     }
     if (symbol[symbolPos].kind != function) {
-        report_error(35, "%s Ǻ", token1);
+        report_error(35, "%s 不是函数名", token1);
         return 35;
     }
 
-    // һԼ飺ͣ򻯣
-    // ʵӦüǷƥ
+    int inlined = 0;
+    es = call_function(symbolPos, 0, &inlined);
+    if (es > 0) return es;
+    if (expr_type != TYPE_VOID && expr_type != TYPE_UNKNOWN && !has_fatal_error && !inlined) {
+        int t = new_scope_slot();
+        offset--;
+        gen_code("STO", t);
+    }
 
-    if (!has_fatal_error) {
-        strcpy(codes[codesIndex].opt, "CALL");
-        codes[codesIndex].operand = symbolPos;
-        codesIndex++;
+    if (strcmp(token, ";") != 0 && strcmp(token1, ";") != 0) {
+        if (!has_keyword) return es;
+        report_error(4, "期望;，得到: %s %s", token, token1);
+        return 4;
     }
 
     if (!read_next_token()) return 10;
-    if (strcmp(token, "(") != 0 && strcmp(token1, "(") != 0) {
-        report_error(5, "(õ: %s %s", token, token1);
-        return 5;
+    return es;
+}
+
+// 函数调用 函数名(实参, ...)，当前单词是函数名。实参依次求值、按形参类型
+// 转换后留在栈上，能内联的展开函数体，否则生成CALL（操作数暂为符号下标，
+// 链接时改为函数入口）。want_value为1表示在表达式中，要用返回值。
+// inlined非NULL时带回这次调用是否内联（实参里的调用另算）。
+// 实参不含&&、||：跳转会在栈上还有别的实参时切开基本块
+int call_function(int sym, int want_value, int *inlined) {
+    int es = 0, nargs = 0;
+    char name[64];
+    FuncInfo *f = func_of_symbol(sym);
+    SrcPos call_pos = token_pos;        // CALL记在函数名的位置
+
+    strncpy(name, token1, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    ast_begin("CallExpression");
+    ast_add_attr("callee", name);
+    if (!f) {
+        report_error(38, "不能调用 %s", name);
+        es = 38;
+    } else if (want_value && f->ret_type == TYPE_VOID) {
+        report_error(37, "函数 %s 没有返回值，不能用在表达式中", name);
+        es = 37;
     }
 
     if (!read_next_token()) return 10;
-    if (strcmp(token, ")") != 0 && strcmp(token1, ")") != 0) {
-        report_error(6, ")õ: %s %s", token, token1);
+    if (!is_logic_token("(")) {
+        report_error(5, "期望(，得到: %s %s", token, token1);
+        ast_end();
+        return 5;
+    }
+    if (!read_next_token()) return 10;
+
+    while (!is_logic_token(")")) {
+        ast_begin("Argument");
+        int arg_es = bool_expr();
+        ast_end();
+        if (arg_es > 0) {
+            ast_end();
+            return arg_es;
+        }
+        if (f && nargs < f->nparams) {
+            enum DataType pt = f->param_type[nargs];
+            if (is_float_type(pt) != is_float_type(expr_type)) check_type_compatible(pt, expr_type, "参数传递");
+            if (!has_fatal_error) gen_convert(expr_type, pt);
+        }
+        nargs++;
+        if (!is_logic_token(",")) break;
+        if (!read_next_token()) return 10;
+    }
+    if (!is_logic_token(")")) {
+        report_error(6, "期望)，得到: %s %s", token, token1);
+        ast_end();
         return 6;
     }
+    if (f && nargs != f->nparams) {
+        report_error(36, "函数 %s 需要 %d 个参数，实际 %d 个", name, f->nparams, nargs);
+        es = 36;
+    }
 
-    if (!read_next_token()) return 10;
-    if (strcmp(token, ";") != 0 && strcmp(token1, ";") != 0) {
-        report_error(4, ";õ: %s %s", token, token1);
-        return 4;
+    if (f && cur_func == f) f->recursive = 1;
+    if (es == 0 && !has_fatal_error) {
+        if (can_inline(f, want_value)) {
+            ast_add_attr("inlined", "true");
+            inline_call(f, want_value);
+            if (inlined) *inlined = 1;
+        } else {
+            fill_code_lines();
+            gen_code("CALL", sym);
+            codes[codesIndex - 1].pos = call_pos;
+            lines_filled = codesIndex;
+        }
     }
+    expr_type = f ? f->ret_type : TYPE_UNKNOWN;
+    ast_end();
+
+    if (!read_next_token()) return 10;
+    return es;
+}
+
+// return [<bool_expr>] [;]：main中结束程序，函数中回到调用处，有返回值的函数
+// 把返回值留在栈顶。返回值正是一次函数调用的结果时，CALL改为TAILCALL
+int return_stat() {
+    int es = 0;
+    enum DataType ret_type = cur_func ? cur_func->ret_type : TYPE_VOID;
+    int line = current_line;
 
     if (!read_next_token()) return 10;
+    if (!cur_func) {
+        if (!has_fatal_error) gen_code("STOP", 0);
+    } else if (ret_type == TYPE_VOID) {
+        if (!has_fatal_error) gen_code("RET", 0);
+    } else {
+        ast_begin("ReturnValue");
+        es = logic_expr();
+        ast_end();
+        // 返回值出错时跳过这一行剩下的部分，不让残余的 ) * 之类再报成未知语句
+        if (es > 0) {
+            while (current_line == line && !is_logic_token(";") && !is_logic_token("}") &&
+                   token[0] != '\0' && !feof(fpTokenin)) {
+                if (!read_next_token()) return 10;
+            }
+            if (is_logic_token(";") && !read_next_token()) return 10;
+            return es;
+        }
+        if (is_float_type(ret_type) != is_float_type(expr_type)) check_type_compatible(ret_type, expr_type, "返回值");
+        if (!has_fatal_error) {
+            gen_convert(expr_type, ret_type);
+            if (strcmp(codes[codesIndex - 1].opt, "CALL") == 0) {
+                strcpy(codes[codesIndex - 1].opt, "TAILCALL");
+                cur_func->has_tailcall = 1;
+            } else {
+                gen_code("RET", 1);
+            }
+        }
+    }
+
+    if (is_logic_token(";") && !read_next_token()) return 10;
     return es;
 }
 
@@ -1853,26 +5453,26 @@ int read_stat() {
 
     if (!read_next_token()) return 10;
     if (strcmp(token, "ID") != 0 && strcmp(token1, "ID") != 0) {
-        report_error(3, "ʶõ: %s %s", token, token1);
+        report_error(3, "期望标识符，得到: %s %s", token, token1);
         return 3;
     }
 
     ast_add_attr("variable_name", token1);
 
-    // ޸ȼǷҵ
+    // 修改这里：先检查是否找到
     if (lookup_current_scope(token1, &pos) != 0) {
-        report_error(23, " %s δ", token1);
-        // ִУ
+        report_error(23, "变量 %s 未声明", token1);
+        // 继续执行，不立即返回
     } else {
-        // ҵˣ
-        if (symbol[pos].kind != variable) {
-            report_error(35, "%s Ǳ", token1);
+        // 找到了，继续正常检查
+        if (!is_value_symbol(pos)) {
+            report_error(35, "%s 不是变量名", token1);
             return 35;
         }
 
         if (!has_fatal_error) {
-            strcpy(codes[codesIndex].opt, "READ");
-            codes[codesIndex].operand = pos;
+            strcpy(codes[codesIndex].opt, is_float_type(symbol[pos].type) ? "READF" : "READ");
+            codes[codesIndex].operand = symbol[pos].address;
             codesIndex++;
         }
 
@@ -1889,31 +5489,31 @@ int write_stat() {
 
     if (!read_next_token()) return 10;
     if (strcmp(token, "ID") != 0 && strcmp(token1, "ID") != 0) {
-        report_error(3, "ʶõ: %s %s", token, token1);
+        report_error(3, "期望标识符，得到: %s %s", token, token1);
         return 3;
     }
 
     ast_add_attr("variable_name", token1);
 
-    // ͬ޸
+    // 同样的修改
     if (lookup_current_scope(token1, &pos) != 0) {
-        report_error(23, " %s δ", token1);
-        // ִ
+        report_error(23, "变量 %s 未声明", token1);
+        // 继续执行
     } else {
-        if (symbol[pos].kind != variable) {
-            report_error(35, "%s Ǳ", token1);
+        if (!is_value_symbol(pos)) {
+            report_error(35, "%s 不是变量名", token1);
             return 35;
         }
 
 
         enum DataType var_type = get_variable_type(token1);
         if (var_type == TYPE_ARRAY) {
-            report_error(63, "ֱ %s", token1);
+            report_error(63, "不能直接输出数组变量 %s", token1);
         }
 
         if (!has_fatal_error) {
-            strcpy(codes[codesIndex].opt, "WRITE");
-            codes[codesIndex].operand = pos;
+            strcpy(codes[codesIndex].opt, is_float_type(var_type) ? "WRITEF" : "WRITE");
+            codes[codesIndex].operand = symbol[pos].address;
             codesIndex++;
         }
     }
@@ -1941,34 +5541,34 @@ int expression_stat() {
     return es;
 }
 
-// <expression> ID = <bool_expr> | <bool_expr>
+// <expression>→ ID = <bool_expr> | <bool_expr>
 int expression() {
     int es = 0;
     ast_begin("Expression");
 
-    printf("expressionǰtoken: %s %s\n", token, token1);
+    trace("进入expression，当前token: %s %s\n", token, token1);
 
     if (strcmp(token, "ID") == 0 || strcmp(token1, "ID") == 0) {
         char var_name[256];
         strncpy(var_name, token1, sizeof(var_name) - 1);
         var_name[sizeof(var_name) - 1] = '\0';
 
-        int pos = -1;  // ʼΪ-1ʾδҵ
+        int pos = -1;  // 初始化为-1，表示未找到
         int lookup_result = lookup_current_scope(var_name, &pos);
 
         if (lookup_result != 0) {
-            // δ
-            report_error(23, " %s δ", var_name);
-            // أԷָ
+            // 变量未声明
+            report_error(23, "变量 %s 未声明", var_name);
+            // 不立即返回，继续解析以发现更多错误
         } else {
-            // ҵ˱ǷǱ
-            if (symbol[pos].kind != variable) {
-                report_error(35, "%s Ǳ", token1);
+            // 找到了变量，检查是否是变量类型
+            if (!is_value_symbol(pos)) {
+                report_error(35, "%s 不是变量名", token1);
                 es = 35;
             }
         }
 
-        // ȡͣҵˣ
+        // 获取变量类型（如果找到了）
         enum DataType left_type = TYPE_UNKNOWN;
         if (lookup_result == 0) {
             left_type = symbol[pos].type;
@@ -1984,7 +5584,7 @@ int expression() {
         }
 
         if (strcmp(token, "=") == 0 || strcmp(token1, "=") == 0) {
-            // ֵ
+            // 赋值语句
             ast_begin("LeftValue");
             ast_add_attr("variable", var_name);
             ast_end();
@@ -1996,81 +5596,90 @@ int expression() {
                 return 10;
             }
 
-            // ֵʼtokenͼ
+            // 保存右值开始的token用于类型检查
             char saved_token[64], saved_token1[256];
             strcpy(saved_token, token);
             strcpy(saved_token1, token1);
 
-            // ֵǷNUMSTRING
+            // 检查右值是否是立即数（NUM或STRING）
             int is_right_num = (strcmp(saved_token, "NUM") == 0 || strcmp(saved_token1, "NUM") == 0);
             int is_right_string = is_string_literal(saved_token1);
             int is_right_bool = (strcmp(saved_token, "true") == 0 || strcmp(saved_token1, "true") == 0 ||
                                 strcmp(saved_token, "false") == 0 || strcmp(saved_token1, "false") == 0);
 
             ast_begin("RightValue");
-            es = bool_expr();
+            es = logic_expr();
             ast_end();
 
-            // ϸͼ飨ֻڱǱʱ
-            if (lookup_result == 0 && symbol[pos].kind == variable) {
+            // 详细的类型检查（只在变量已声明且是变量类型时）
+            if (lookup_result == 0 && is_value_symbol(pos)) {
                 if (is_right_num) {
-                    // ֵ͸ֵ
+                    // 数值类型赋值检查
                     if (is_float_string(saved_token1)) {
                         if (left_type == TYPE_INT) {
-                            report_error(51, "ܽ %s ֵͱ %s",
+                            report_error(51, "不能将浮点数 %s 赋值给整型变量 %s",
                                         saved_token1, var_name);
                         } else if (left_type == TYPE_BOOL) {
-                            report_error(51, "ֵܽ %s ֵ %s",
+                            report_error(51, "不能将数值 %s 赋值给布尔变量 %s",
                                         saved_token1, var_name);
                         } else if (left_type == TYPE_STRING) {
-                            report_error(51, "ֵܽ %s ֵַ %s",
+                            report_error(51, "不能将数值 %s 赋值给字符串变量 %s",
                                         saved_token1, var_name);
                         }
-                        // ֵ
+                        // 浮点数赋值给浮点类型是允许的
                     } else {
-                        // ֵ
+                        // 整数常量赋值
                         if (left_type == TYPE_BOOL) {
-                            report_error(51, "ܽ %s ֵ %s",
+                            report_error(51, "不能将整数 %s 赋值给布尔变量 %s",
                                         saved_token1, var_name);
                         } else if (left_type == TYPE_STRING) {
-                            report_error(51, "ܽ %s ֵַ %s",
+                            report_error(51, "不能将整数 %s 赋值给字符串变量 %s",
                                         saved_token1, var_name);
                         }
                     }
                 } else if (is_right_string) {
-                    // ֵַ
+                    // 字符串赋值检查
                     if (left_type != TYPE_STRING) {
-                        report_error(51, "ֵַַܽ %s", var_name);
+                        report_error(51, "不能将字符串赋值给非字符串变量 %s", var_name);
                     }
                 } else if (is_right_bool) {
-                    // ֵֵ
+                    // 布尔值赋值检查
                     if (left_type != TYPE_BOOL) {
-                        report_error(51, "ֵֵܽǲ %s", var_name);
+                        report_error(51, "不能将布尔值赋值给非布尔变量 %s", var_name);
                     }
                 }
-                // ֵʽֵbool_exprнͼ
+                // 其他情况（如变量赋值、表达式结果赋值）会在bool_expr中进行类型检查
 
-                // 
+                // 检查数组类型
                 if (left_type == TYPE_ARRAY) {
-                    report_error(64, "ֱӸ %s ֵ", var_name);
+                    report_error(64, "不能直接给数组 %s 赋值", var_name);
                 }
 
 
-                // Ǳѳʼ
+                // 标记变量已初始化
                 mark_variable_initialized(var_name);
             }
 
-            // ɴ루ֻûұʱ
-            if (!has_fatal_error && lookup_result == 0 && symbol[pos].kind == variable) {
-                // STOָջֵ洢
+            // 整数与浮点之间赋值要转换（浮点常量赋给整型变量上面已报错）
+            enum DataType right_type = expr_type;
+            if (lookup_result == 0 && is_value_symbol(pos) &&
+                is_float_type(left_type) != is_float_type(right_type) &&
+                !(is_right_num && is_float_string(saved_token1))) {
+                check_type_compatible(left_type, right_type, "赋值");
+            }
+
+            // 生成代码（只在没有致命错误且变量已声明时）
+            if (!has_fatal_error && lookup_result == 0 && is_value_symbol(pos)) {
+                gen_convert(right_type, left_type);
+                // STO指令：将栈顶值存储到变量
                 strcpy(codes[codesIndex].opt, "STO");
-                codes[codesIndex].operand = pos;
+                codes[codesIndex].operand = symbol[pos].address;
                 codesIndex++;
             }
 
         } else if (strcmp(token, "++") == 0 || strcmp(token1, "++") == 0 ||
                    strcmp(token, "--") == 0 || strcmp(token1, "--") == 0) {
-            // /Լ
+            // 后置自增/自减
             char op[4];
             strncpy(op, token, sizeof(op) - 1);
             op[sizeof(op) - 1] = '\0';
@@ -2078,68 +5687,69 @@ int expression() {
             ast_add_attr("operator", op);
             ast_add_attr("position", "postfix");
 
-            // ʱļ
+            // 变量已声明时的检查
             if (lookup_result == 0) {
                 if (!check_variable_initialized(var_name)) {
-                    report_warning(" %s δʼ", var_name);
+                    report_warning("变量 %s 可能未初始化", var_name);
                 }
 
-                // ͼ飺Լֵֻ
+                // 类型检查：自增自减只能用于数值类型
                 if (left_type != TYPE_INT && left_type != TYPE_FLOAT && left_type != TYPE_DOUBLE) {
-                    report_error(65, "/Լ %s ͱ", type_to_string(left_type));
+                    report_error(65, "自增/自减操作不能用于 %s 类型变量", type_to_string(left_type));
                 }
 
-                // 
+                // 检查数组类型
                 if (left_type == TYPE_ARRAY) {
-                    report_error(64, "ܶ %s /Լ", var_name);
+                    report_error(64, "不能对数组 %s 进行自增/自减操作", var_name);
                 }
 
                 if (!has_fatal_error) {
-                    // /Լ
+                    int is_float = is_float_type(left_type);
+                    // 生成自增/自减代码
                     if (strcmp(op, "++") == 0) {
-                        // x++ ൱: LOAD x; LOADI 1; ADD; STO x
+                        // x++ 相当于: LOAD x; LOADI 1; ADD; STO x
                         strcpy(codes[codesIndex].opt, "LOAD");
-                        codes[codesIndex].operand = pos;
+                        codes[codesIndex].operand = symbol[pos].address;
                         codesIndex++;
 
                         if (codesIndex < MAX_CODES) {
-                            strcpy(codes[codesIndex].opt, "LOADI");
-                            codes[codesIndex].operand = 1;
+                            strcpy(codes[codesIndex].opt, is_float ? "LOADF" : "LOADI");
+                            codes[codesIndex].operand = is_float ? add_float_const(1.0) : 1;
                             codesIndex++;
                         }
 
                         if (codesIndex < MAX_CODES) {
-                            strcpy(codes[codesIndex].opt, "ADD");
+                            strcpy(codes[codesIndex].opt, is_float ? "ADDF" : "ADD");
                             codes[codesIndex].operand = 0;
                             codesIndex++;
                         }
 
                         if (codesIndex < MAX_CODES) {
                             strcpy(codes[codesIndex].opt, "STO");
-                            codes[codesIndex].operand = pos;
+                            codes[codesIndex].operand = symbol[pos].address;
                             codesIndex++;
                         }
                     } else {
-                        // x-- ൱: LOAD x; LOADI 1; SUB; STO x
+                        // x-- 相当于: LOAD x; LOADI 1; SUB; STO x
                         strcpy(codes[codesIndex].opt, "LOAD");
-                        codes[codesIndex].operand = pos;
+                        codes[codesIndex].operand = symbol[pos].address;
                         codesIndex++;
 
                         if (codesIndex < MAX_CODES) {
-                            strcpy(codes[codesIndex].opt, "LOADI");
-                            codes[codesIndex].operand = 1;
+                            strcpy(codes[codesIndex].opt, is_float ? "LOADF" : "LOADI");
+                            codes[codesIndex].operand = is_float ? add_float_const(1.0) : 1;
                             codesIndex++;
                         }
 
                         if (codesIndex < MAX_CODES) {
-                            strcpy(codes[codesIndex].opt, "SUB");
+                            strcpy(codes[codesIndex].opt, is_float ? "SUBF" : "SUB");
                             codes[codesIndex].operand = 0;
                             codesIndex++;
                         }
 
                         if (codesIndex < MAX_CODES) {
                             strcpy(codes[codesIndex].opt, "STO");
-                            codes[codesIndex].operand = pos;
+                            codes[codesIndex].operand = symbol[pos].address;
                             codesIndex++;
                         }
                     }
@@ -2155,42 +5765,42 @@ int expression() {
             ast_end();
             return 0;
         } else {
-            // ȡֵǸֵҲԼ
+            // 读取变量值（不是赋值也不是自增自减）
             strcpy(token, current_token);
             strcpy(token1, current_token1);
 
-            // ʱļ
+            // 变量已声明时的检查
             if (lookup_result == 0) {
                 if (!check_variable_initialized(var_name)) {
-                    report_warning(" %s δʼ", var_name);
+                    report_warning("变量 %s 可能未初始化", var_name);
                 }
 
-                // 
+                // 检查数组类型
                 if (left_type == TYPE_ARRAY) {
-                    report_error(64, " %s Ҫ±", var_name);
+                    report_error(64, "数组 %s 需要下标访问", var_name);
                 }
 
                 if (!has_fatal_error) {
-                    // LOADָֵѹջ
+                    // LOAD指令：将变量值压入栈
                     strcpy(codes[codesIndex].opt, "LOAD");
-                    codes[codesIndex].operand = pos;
+                    codes[codesIndex].operand = symbol[pos].address;
                     codesIndex++;
                 }
             } else {
-                // δȻLOADָַΪ0
+                // 变量未声明，但仍然生成LOAD指令（地址为0）
                 if (!has_fatal_error) {
                     strcpy(codes[codesIndex].opt, "LOAD");
-                    codes[codesIndex].operand = 0;  // Чַ
+                    codes[codesIndex].operand = 0;  // 无效地址
                     codesIndex++;
                 }
             }
 
-            // ܵıʽ x + 1
-            es = bool_expr();
+            // 继续解析可能的表达式（如 x + 1）
+            es = logic_expr();
         }
     } else if (strcmp(token, "++") == 0 || strcmp(token1, "++") == 0 ||
                strcmp(token, "--") == 0 || strcmp(token1, "--") == 0) {
-        // ǰ/Լ
+        // 前置自增/自减
         char op[4];
         strncpy(op, token, sizeof(op) - 1);
         op[sizeof(op) - 1] = '\0';
@@ -2203,7 +5813,7 @@ int expression() {
         }
 
         if (strcmp(token, "ID") != 0 && strcmp(token1, "ID") != 0) {
-            report_error(7, "ʶõ: %s %s", token, token1);
+            report_error(7, "期望标识符，得到: %s %s", token, token1);
             ast_end();
             return 7;
         }
@@ -2216,88 +5826,90 @@ int expression() {
         int lookup_result = lookup_current_scope(token1, &pos);
 
         if (lookup_result != 0) {
-            report_error(23, " %s δ", token1);
-            // ִ
+            report_error(23, "变量 %s 未声明", token1);
+            // 继续执行
         } else {
-            // ͼ
+            // 类型检查
             enum DataType var_type = get_variable_type(token1);
             if (var_type != TYPE_INT && var_type != TYPE_FLOAT && var_type != TYPE_DOUBLE) {
-                report_error(65, "/Լ %s ͱ", type_to_string(var_type));
+                report_error(65, "自增/自减操作不能用于 %s 类型变量", type_to_string(var_type));
             }
 
-            // 
+            // 检查数组类型
             if (var_type == TYPE_ARRAY) {
-                report_error(64, "ܶ %s /Լ", token1);
+                report_error(64, "不能对数组 %s 进行自增/自减操作", token1);
             }
 
             if (!check_variable_initialized(token1)) {
-                report_warning(" %s δʼ", token1);
+                report_warning("变量 %s 可能未初始化", token1);
             }
 
             if (!has_fatal_error) {
-                // ++x ൱: LOAD x; LOADI 1; ADD; STO x; LOAD x
+                int is_float = is_float_type(var_type);
+                // ++x 相当于: LOAD x; LOADI 1; ADD; STO x; LOAD x
                 if (op[0] == '+') {
-                    // ֵ
+                    // 计算新值
                     strcpy(codes[codesIndex].opt, "LOAD");
-                    codes[codesIndex].operand = pos;
+                    codes[codesIndex].operand = symbol[pos].address;
                     codesIndex++;
 
                     if (codesIndex < MAX_CODES) {
-                        strcpy(codes[codesIndex].opt, "LOADI");
-                        codes[codesIndex].operand = 1;
+                        strcpy(codes[codesIndex].opt, is_float ? "LOADF" : "LOADI");
+                        codes[codesIndex].operand = is_float ? add_float_const(1.0) : 1;
                         codesIndex++;
                     }
 
                     if (codesIndex < MAX_CODES) {
-                        strcpy(codes[codesIndex].opt, "ADD");
+                        strcpy(codes[codesIndex].opt, is_float ? "ADDF" : "ADD");
                         codes[codesIndex].operand = 0;
                         codesIndex++;
                     }
 
                     if (codesIndex < MAX_CODES) {
                         strcpy(codes[codesIndex].opt, "STO");
-                        codes[codesIndex].operand = pos;
+                        codes[codesIndex].operand = symbol[pos].address;
                         codesIndex++;
                     }
 
                     if (codesIndex < MAX_CODES) {
                         strcpy(codes[codesIndex].opt, "LOAD");
-                        codes[codesIndex].operand = pos;
+                        codes[codesIndex].operand = symbol[pos].address;
                         codesIndex++;
                     }
                 } else {
-                    // --x ൱: LOAD x; LOADI 1; SUB; STO x; LOAD x
+                    // --x 相当于: LOAD x; LOADI 1; SUB; STO x; LOAD x
                     strcpy(codes[codesIndex].opt, "LOAD");
-                    codes[codesIndex].operand = pos;
+                    codes[codesIndex].operand = symbol[pos].address;
                     codesIndex++;
 
                     if (codesIndex < MAX_CODES) {
-                        strcpy(codes[codesIndex].opt, "LOADI");
-                        codes[codesIndex].operand = 1;
+                        strcpy(codes[codesIndex].opt, is_float ? "LOADF" : "LOADI");
+                        codes[codesIndex].operand = is_float ? add_float_const(1.0) : 1;
                         codesIndex++;
                     }
 
                     if (codesIndex < MAX_CODES) {
-                        strcpy(codes[codesIndex].opt, "SUB");
+                        strcpy(codes[codesIndex].opt, is_float ? "SUBF" : "SUB");
                         codes[codesIndex].operand = 0;
                         codesIndex++;
                     }
 
                     if (codesIndex < MAX_CODES) {
                         strcpy(codes[codesIndex].opt, "STO");
-                        codes[codesIndex].operand = pos;
+                        codes[codesIndex].operand = symbol[pos].address;
                         codesIndex++;
                     }
 
                     if (codesIndex < MAX_CODES) {
                         strcpy(codes[codesIndex].opt, "LOAD");
-                        codes[codesIndex].operand = pos;
+                        codes[codesIndex].operand = symbol[pos].address;
                         codesIndex++;
                     }
                 }
             }
 
             mark_variable_initialized(token1);
+            expr_type = var_type;
         }
 
         ast_begin("Operand");
@@ -2311,20 +5923,21 @@ int expression() {
         ast_end();
         return 0;
     } else {
-        // ͨʽԱʶԼͷ
-        es = bool_expr();
+        // 普通表达式（不以标识符或自增自减开头）
+        es = logic_expr();
     }
 
     ast_end();
     return es;
 }
 
-// bool_expr()лָͼ
+// 在bool_expr()中恢复类型检查
 int bool_expr() {
     int es = 0;
 
     es = additive_expr();
     if (es > 0) return es;
+    enum DataType left_type = expr_type;
 
     if (strcmp(token, ">") == 0 || strcmp(token, ">=") == 0 ||
         strcmp(token, "<") == 0 || strcmp(token, "<=") == 0 ||
@@ -2342,7 +5955,7 @@ int bool_expr() {
         ast_begin("BinaryExpression");
         ast_add_attr("operator", op);
 
-        // ұߵtokenͼ
+        // 保存右边的token用于类型检查
         char saved_token[64], saved_token1[256];
         strcpy(saved_token, token);
         strcpy(saved_token1, token1);
@@ -2354,19 +5967,21 @@ int bool_expr() {
         }
 
 
-        // ֵͼ
-        if (!check_type_compatible(TYPE_INT, TYPE_INT, "Ƚ")) {
-            // ѱ
+        // 检查数值类型兼容性
+        enum DataType right_type = expr_type;
+        if (!check_operand_types(left_type, right_type, "比较运算")) {
+            // 错误已报告
         }
 
         if (!has_fatal_error) {
-            if (strcmp(op, ">") == 0) gen_code("GT", 0);
-            else if (strcmp(op, ">=") == 0) gen_code("GE", 0);
-            else if (strcmp(op, "<") == 0) gen_code("LT", 0);
-            else if (strcmp(op, "<=") == 0) gen_code("LE", 0);
-            else if (strcmp(op, "==") == 0) gen_code("EQ", 0);
-            else if (strcmp(op, "!=") == 0) gen_code("NE", 0);
+            if (strcmp(op, ">") == 0) gen_typed_binary("GT", left_type, right_type);
+            else if (strcmp(op, ">=") == 0) gen_typed_binary("GE", left_type, right_type);
+            else if (strcmp(op, "<") == 0) gen_typed_binary("LES", left_type, right_type);
+            else if (strcmp(op, "<=") == 0) gen_typed_binary("LE", left_type, right_type);
+            else if (strcmp(op, "==") == 0) gen_typed_binary("EQ", left_type, right_type);
+            else if (strcmp(op, "!=") == 0) gen_typed_binary("NOTEQ", left_type, right_type);
         }
+        expr_type = TYPE_INT;   // 比较结果是整数0/1
 
         ast_end();
     }
@@ -2374,12 +5989,174 @@ int bool_expr() {
     return es;
 }
 
-// arithmetic_exprлָͼ
+// 浮点值作条件时先与0.0比较，BRF只判断整数
+void gen_float_test() {
+    if (is_float_type(expr_type) && !has_fatal_error) {
+        gen_code("LOADF", add_float_const(0.0));
+        gen_code("NOTEQF", 0);
+    }
+    expr_type = TYPE_INT;
+}
+
+// 条件的一个操作数：<bool_expr>，结果留在栈顶
+int condition_expr() {
+    int es = bool_expr();
+    if (es > 0) return es;
+    gen_float_test();
+    return es;
+}
+
+// ===================== 短路求值 =====================
+// 条件在"跳转上下文"中生成：&&、|| 直接译成条件跳转，能确定结果时
+// 跳过右操作数，比较结果不再先组合成0/1再交给BRF判断。
+// 条件为假的BRF经操作数串成回填链（与break/continue相同），由调用者
+// 回填到假出口；条件为真时顺序执行。
+
+int is_logic_token(const char *op) {
+    return strcmp(token, op) == 0 || strcmp(token1, op) == 0;
+}
+
+// 比较取反：a<b 为假即 a>=b 为真
+const char *negate_compare(const char *op) {
+    static const char *pairs[][2] = {
+        {"GT", "LE"}, {"GE", "LES"}, {"EQ", "NOTEQ"},
+        {"GTF", "LEF"}, {"GEF", "LESF"}, {"EQF", "NOTEQF"},
+    };
+    for (int i = 0; i < (int)(sizeof(pairs) / sizeof(pairs[0])); i++) {
+        if (strcmp(op, pairs[i][0]) == 0) return pairs[i][1];
+        if (strcmp(op, pairs[i][1]) == 0) return pairs[i][0];
+    }
+    return NULL;
+}
+
+// 按栈顶的条件值生成跳转并加入回填链：when_true为0时条件假跳转，
+// 为1时条件真跳转。末尾的NOT去掉、跳转条件随之反过来；
+// 真跳转也只用BRF：栈顶是比较结果就把比较取反，否则补一条NOT
+void gen_cond_branch(int *list, int when_true) {
+    if (has_fatal_error || codesIndex == 0) return;
+
+    while (codesIndex > 0 && strcmp(codes[codesIndex - 1].opt, "NOT") == 0) {
+        codesIndex--;
+        when_true = !when_true;
+    }
+    if (when_true) {
+        Code *last = &codes[codesIndex - 1];
+        const char *neg = negate_compare(last->opt);
+        if (neg) strcpy(last->opt, neg);
+        else gen_code("NOT", 0);
+    }
+
+    int cx = codesIndex;
+    gen_code("BRF", *list);
+    if (codesIndex > cx) *list = cx;
+}
+
+// 把回填链b接到链a的末尾，返回合并后的链
+int merge_lists(int a, int b) {
+    if (a < 0) return b;
+    int tail = a;
+    while (codes[tail].operand >= 0 && codes[tail].operand < codesIndex) tail = codes[tail].operand;
+    codes[tail].operand = b;
+    return a;
+}
+
+// <condition> → <and_cond> { || <and_cond> }
+// <and_cond>  → <cond_operand> { && <cond_operand> }
+// <cond_operand> → ( <condition> ) | <condition_expr>
+// 条件为假时跳到*false_list链上的目标，为真时落到代码末尾。
+// first_parsed为1表示第一个操作数已经分析完、值在栈顶
+int cond_jump(int *false_list, int first_parsed) {
+    int es, true_list = -1, and_list = -1;
+
+    while (1) {
+        // 括号分组本身已是跳转形式：为真落下，为假跳到group_list
+        int is_group = 0, group_list = -1;
+        if (!first_parsed && is_logic_token("(") && paren_has_logic()) {
+            if (!read_next_token()) return 10;
+            es = cond_jump(&group_list, 0);
+            if (es > 0) return es;
+            if (!is_logic_token(")")) {
+                report_error(6, "期望)，得到: %s %s", token, token1);
+                return 6;
+            }
+            if (!read_next_token()) return 10;
+            is_group = 1;
+        } else if (!first_parsed) {
+            es = condition_expr();
+            if (es > 0) return es;
+        }
+        first_parsed = 0;
+
+        if (is_logic_token("||")) {
+            // 左边为真直接跳到真出口；左边某个&&操作数为假时去算右边
+            ast_add_attr("operator", "||");
+            if (is_group) {
+                if (!has_fatal_error) gen_jump_to_list(&true_list);
+                and_list = merge_lists(and_list, group_list);
+            } else {
+                gen_cond_branch(&true_list, 1);
+            }
+            if (!has_fatal_error) backpatch(and_list, codesIndex);
+            and_list = -1;
+        } else {
+            if (is_group) and_list = merge_lists(and_list, group_list);
+            else gen_cond_branch(&and_list, 0);
+            if (!is_logic_token("&&")) break;
+            ast_add_attr("operator", "&&");
+        }
+        if (!read_next_token()) return 10;
+    }
+
+    *false_list = and_list;
+    if (!has_fatal_error) backpatch(true_list, codesIndex);
+    expr_type = TYPE_INT;
+    return 0;
+}
+
+// 值上下文中的 && / ||：同样按跳转求值，真假两条路径分别把1/0
+// 存入匿名变量后汇合，基本块边界处操作数栈保持为空
+int logic_expr() {
+    int es, first_parsed = 0;
+
+    // 以条件分组开头时直接按跳转分析，否则先当普通表达式分析
+    if (!(is_logic_token("(") && paren_has_logic())) {
+        es = bool_expr();
+        if (es > 0 || (!is_logic_token("&&") && !is_logic_token("||"))) return es;
+        gen_float_test();
+        first_parsed = 1;
+    }
+
+    ast_begin("LogicalExpression");
+    int false_list = -1, end_list = -1;
+    es = cond_jump(&false_list, first_parsed);
+    if (es > 0) {
+        ast_end();
+        return es;
+    }
+
+    if (!has_fatal_error) {
+        int t = new_scope_slot();
+        gen_code("LOADI", 1);
+        gen_code("STO", t);
+        gen_jump_to_list(&end_list);
+        backpatch(false_list, codesIndex);
+        gen_code("LOADI", 0);
+        gen_code("STO", t);
+        backpatch(end_list, codesIndex);
+        gen_code("LOAD", t);
+    }
+    expr_type = TYPE_INT;
+    ast_end();
+    return 0;
+}
+
+// 在arithmetic_expr中恢复类型检查
 int additive_expr() {
     int es = 0;
 
     es = term();
     if (es > 0) return es;
+    enum DataType left_type = expr_type;
 
     while (strcmp(token, "+") == 0 || strcmp(token, "-") == 0 ||
            strcmp(token1, "+") == 0 || strcmp(token1, "-") == 0) {
@@ -2396,7 +6173,7 @@ int additive_expr() {
         ast_begin("BinaryExpression");
         ast_add_attr("operator", op);
 
-        // 
+        // 检查运算数类型
         char saved_token[64], saved_token1[256];
         strcpy(saved_token, token);
         strcpy(saved_token1, token1);
@@ -2407,30 +6184,25 @@ int additive_expr() {
             return es;
         }
 
-        // ͼ
+        // 算术运算的类型检查
         if (is_string_literal(saved_token1)) {
             if (op[0] == '+') {
-                report_warning("ַӲ: %s", saved_token1);
-                // ַ⴦
+                report_warning("字符串连接操作: %s", saved_token1);
+                // 字符串连接特殊处理
             } else {
-                report_error(50, ": ַܲˡ");
+                report_error(50, "算术运算: 字符串不能参与减、乘、除运算");
             }
         } else if (strcmp(saved_token, "true") == 0 || strcmp(saved_token1, "true") == 0 ||
                    strcmp(saved_token, "false") == 0 || strcmp(saved_token1, "false") == 0) {
-            report_error(50, ": ֵֵܲ");
-        }
-
-        if (!check_type_compatible(TYPE_INT, TYPE_INT, "")) {
-            // ѱ
+            report_error(50, "算术运算: 布尔值不能参与数值运算");
+        } else if (!check_operand_types(left_type, expr_type, "算术运算")) {
+            // 错误已报告
         }
 
         if (!has_fatal_error) {
-            if (op[0] == '+') {
-                gen_code("ADD", 0);
-            } else {
-                gen_code("SUB", 0);
-            }
+            gen_typed_binary(op[0] == '+' ? "ADD" : "SUB", left_type, expr_type);
         }
+        left_type = expr_type = arith_result_type(left_type, expr_type);
 
         ast_end();
     }
@@ -2438,12 +6210,13 @@ int additive_expr() {
     return es;
 }
 
-// ָͬterm()еͼ
+// 同样恢复term()中的类型检查
 int term() {
     int es = 0;
 
     es = factor();
     if (es > 0) return es;
+    enum DataType left_type = expr_type;
 
     while (strcmp(token, "*") == 0 || strcmp(token, "/") == 0 ||
            strcmp(token1, "*") == 0 || strcmp(token1, "/") == 0) {
@@ -2470,25 +6243,20 @@ int term() {
             return es;
         }
 
-        // ˳ͼ
+        // 乘除运算的类型检查
         if (is_string_literal(saved_token1)) {
-            report_error(50, ": ַܲˡ");
+            report_error(50, "算术运算: 字符串不能参与乘、除运算");
         } else if (strcmp(saved_token, "true") == 0 || strcmp(saved_token1, "true") == 0 ||
                    strcmp(saved_token, "false") == 0 || strcmp(saved_token1, "false") == 0) {
-            report_error(50, ": ֵֵܲ");
-        }
-
-        if (!check_type_compatible(TYPE_INT, TYPE_INT, "")) {
-            // ѱ
+            report_error(50, "算术运算: 布尔值不能参与数值运算");
+        } else if (!check_operand_types(left_type, expr_type, "算术运算")) {
+            // 错误已报告
         }
 
         if (!has_fatal_error) {
-            if (op[0] == '*') {
-                gen_code("MUL", 0);
-            } else {
-                gen_code("DIV", 0);
-            }
+            gen_typed_binary(op[0] == '*' ? "MULT" : "DIV", left_type, expr_type);
         }
+        left_type = expr_type = arith_result_type(left_type, expr_type);
 
         ast_end();
     }
@@ -2501,15 +6269,19 @@ int factor() {
     if (strcmp(token, "(") == 0 || strcmp(token1, "(") == 0) {
         if (!read_next_token()) return 10;
 
-        es = additive_expr();
+        es = bool_expr();     // 括号内可以是比较，如 !(a < b)
         if (es > 0) return es;
 
         if (strcmp(token, ")") != 0 && strcmp(token1, ")") != 0) {
-            report_error(6, ")õ: %s %s", token, token1);
+            report_error(6, "期望)，得到: %s %s", token, token1);
             return 6;
         }
 
         if (!read_next_token()) return 10;
+    } else if (strcmp(token, "ID") == 0 && is_function_name(token1)) {
+        int pos;
+        lookup_current_scope(token1, &pos);
+        es = call_function(pos, 1, NULL);
     } else if (strcmp(token, "ID") == 0 || strcmp(token1, "ID") == 0) {
         ast_begin("Identifier");
         ast_add_attr("name", token1);
@@ -2518,23 +6290,26 @@ int factor() {
         int pos;
         if (lookup_current_scope(token1, &pos) == 0) {
             if (!check_variable_initialized(token1)) {
-                report_warning(" %s δʼ", token1);
+                report_warning("变量 %s 可能未初始化", token1);
             }
 
-            // 
+            // 检查数组类型
             if (symbol[pos].type == TYPE_ARRAY) {
-                report_error(64, " %s Ҫ±", token1);
+                report_error(64, "数组 %s 需要下标访问", token1);
             }
 
             if (!has_fatal_error) {
                 strcpy(codes[codesIndex].opt, "LOAD");
-                codes[codesIndex].operand = pos;
+                codes[codesIndex].operand = symbol[pos].address;
                 codesIndex++;
             }
+            expr_type = symbol[pos].type;
+        } else {
+            expr_type = TYPE_UNKNOWN;
         }
         /*else {
-            // δ
-            report_error(23, " %s δ", token1);
+            // 变量未声明
+            report_error(23, "变量 %s 未声明", token1);
             return 23;
         }*/
 
@@ -2544,23 +6319,18 @@ int factor() {
         ast_add_attr("value", token1);
         ast_end();
 
-        if (is_float_string(token1)) {
-            report_warning(" %s ʧ", token1);
-        }
-
         if (!has_fatal_error) {
-            // LOADIָس
-            strcpy(codes[codesIndex].opt, "LOADI");
-
+            // 整数常量用LOADI直接携带，浮点常量放入常量池用LOADF取
             if (is_float_string(token1)) {
-                double float_val = atof(token1);
-                codes[codesIndex].operand = (int)float_val;
-                report_warning(" %s ضΪ %d", token1, (int)float_val);
+                strcpy(codes[codesIndex].opt, "LOADF");
+                codes[codesIndex].operand = add_float_const(atof(token1));
             } else {
+                strcpy(codes[codesIndex].opt, "LOADI");
                 codes[codesIndex].operand = atoi(token1);
             }
             codesIndex++;
         }
+        expr_type = is_float_string(token1) ? TYPE_DOUBLE : TYPE_INT;
 
         if (!read_next_token()) return 10;
     } else if (strcmp(token, "STRING") == 0 || strcmp(token1, "STRING") == 0 ||
@@ -2569,8 +6339,9 @@ int factor() {
         ast_add_attr("value", token1);
         ast_end();
 
-        // ֵַ֧
-        report_error(50, "ַ %s ֵܲ", token1);
+        // 字符串常量不支持数值运算
+        report_error(50, "字符串常量 %s 不能参与数值运算", token1);
+        expr_type = TYPE_STRING;
 
         if (!read_next_token()) return 10;
     } else if (strcmp(token, "true") == 0 || strcmp(token1, "true") == 0 ||
@@ -2584,16 +6355,50 @@ int factor() {
             codes[codesIndex].operand = (strcmp(token1, "true") == 0) ? 1 : 0;
             codesIndex++;
         }
+        expr_type = TYPE_BOOL;
+
+        if (!read_next_token()) return 10;
+    } else if (strcmp(token, "!") == 0 || strcmp(token1, "!") == 0) {
+        ast_begin("UnaryExpression");
+        ast_add_attr("operator", "!");
 
         if (!read_next_token()) return 10;
+        es = factor();
+        ast_end();
+        if (es > 0) return es;
+
+        gen_float_test();
+        if (!has_fatal_error) gen_code("NOT", 0);
     } else {
-        report_error(7, "ӣõ: %s %s", token, token1);
+        report_error(7, "期望因子，得到: %s %s", token, token1);
         return 7;
     }
 
     return es;
 }
-// =====================  =====================
-int main() {
-    return TESTparse();
-}
\ No newline at end of file
+// ===================== 主函数 =====================
+// 用法: yuyifenxi [--no-cache] [--stats=文件] [文件]
+//                                                编译（不给文件名时交互输入）
+//       yuyifenxi --cache-stats                  查看编译缓存命中统计
+// 常驻编译服务在cj驱动程序里，见cj.cpp
+int main(int argc, char *argv[]) {
+    int use_cache = 1;
+    const char *file = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        } else if (strcmp(argv[i], "--cache-stats") == 0) {
+            return cache_print_stats();
+        } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+            if (stats_open(argv[i] + 8)) return 1;
+        } else if (argv[i][0] != '-' && !file) {
+            file = argv[i];
+        } else {
+            printf("未知选项 %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    cache_init(use_cache);
+    return file ? compile_file(file) : TESTparse();
+}